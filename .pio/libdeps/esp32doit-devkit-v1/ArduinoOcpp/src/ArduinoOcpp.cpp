@@ -33,7 +33,7 @@ namespace ArduinoOcpp
 #endif
 
         OcppEngine *ocppEngine{nullptr};
-        FilesystemOpt fileSystemOpt{};
+        std::shared_ptr<FilesystemAdapter> filesystem;
         float voltage_eff{230.f};
 
 #define OCPP_NUMCONNECTORS 2
@@ -89,10 +89,21 @@ void OCPP_initialize(OcppSocket &ocppSocket, float V_eff, ArduinoOcpp::Filesyste
         return;
     }
 
+    OCPP_initialize(ocppSocket, V_eff, makeDefaultFilesystemAdapter(fsOpt), system_time);
+}
+
+void OCPP_initialize(OcppSocket &ocppSocket, float V_eff, std::shared_ptr<ArduinoOcpp::FilesystemAdapter> fs, ArduinoOcpp::OcppClock system_time)
+{
+    if (ocppEngine)
+    {
+        AO_DBG_WARN("Can't be called two times. To change the credentials, either restart ESP, or call OCPP_deinitialize() before");
+        return;
+    }
+
     voltage_eff = V_eff;
-    fileSystemOpt = fsOpt;
+    filesystem = fs;
 
-    configuration_init(fileSystemOpt); // call before each other library call
+    configuration_init(filesystem); // call before each other library call
 
     ocppEngine = new OcppEngine(ocppSocket, system_time);
     auto &model = ocppEngine->getOcppModel();
@@ -137,7 +148,9 @@ void OCPP_deinitialize()
 
     simpleOcppFactory_deinitialize();
 
-    fileSystemOpt = FilesystemOpt();
+    configuration_deinit();
+
+    filesystem.reset();
     voltage_eff = 230.f;
 
     OCPP_booted = false;
@@ -183,7 +196,7 @@ void setPowerActiveImportSampler(std::function<float()> power)
     if (!model.getMeteringService())
     {
         model.setMeteringSerivce(std::unique_ptr<MeteringService>(
-            new MeteringService(*ocppEngine, OCPP_NUMCONNECTORS)));
+            new MeteringService(*ocppEngine, OCPP_NUMCONNECTORS, filesystem)));
     }
     model.getMeteringService()->setPowerSampler(OCPP_ID_OF_CONNECTOR, power); // connectorId=1
 }
@@ -199,11 +212,75 @@ void setEnergyActiveImportSampler(std::function<float()> energy)
     if (!model.getMeteringService())
     {
         model.setMeteringSerivce(std::unique_ptr<MeteringService>(
-            new MeteringService(*ocppEngine, OCPP_NUMCONNECTORS)));
+            new MeteringService(*ocppEngine, OCPP_NUMCONNECTORS, filesystem)));
     }
     model.getMeteringService()->setEnergySampler(OCPP_ID_OF_CONNECTOR, energy); // connectorId=1
 }
 
+void setIntegratedEnergyActiveImportSampler(std::function<float()> power, unsigned long samplePeriodMs)
+{
+    if (!ocppEngine)
+    {
+        AO_DBG_ERR("Please call OCPP_initialize before");
+        return;
+    }
+    auto &model = ocppEngine->getOcppModel();
+    if (!model.getMeteringService())
+    {
+        model.setMeteringSerivce(std::unique_ptr<MeteringService>(
+            new MeteringService(*ocppEngine, OCPP_NUMCONNECTORS, filesystem)));
+    }
+    model.getMeteringService()->setIntegratedEnergySampler(OCPP_ID_OF_CONNECTOR, power, samplePeriodMs); // connectorId=1
+}
+
+void setBatchMeterSampler(const ArduinoOcpp::MeterChannel *channels, size_t numChannels, ArduinoOcpp::BatchMeterSampler sampler)
+{
+    if (!ocppEngine)
+    {
+        AO_DBG_ERR("Please call OCPP_initialize before");
+        return;
+    }
+    auto &model = ocppEngine->getOcppModel();
+    if (!model.getMeteringService())
+    {
+        model.setMeteringSerivce(std::unique_ptr<MeteringService>(
+            new MeteringService(*ocppEngine, OCPP_NUMCONNECTORS, filesystem)));
+    }
+    model.getMeteringService()->setBatchSampler(channels, numChannels, sampler);
+}
+
+void addMeterValueSampler(const char *measurand, const char *unit, std::function<float()> sampler, const char *phase, const char *location)
+{
+    if (!ocppEngine)
+    {
+        AO_DBG_ERR("Please call OCPP_initialize before");
+        return;
+    }
+    auto &model = ocppEngine->getOcppModel();
+    if (!model.getMeteringService())
+    {
+        model.setMeteringSerivce(std::unique_ptr<MeteringService>(
+            new MeteringService(*ocppEngine, OCPP_NUMCONNECTORS, filesystem)));
+    }
+    model.getMeteringService()->addMeterValueSampler(OCPP_ID_OF_CONNECTOR, {measurand, unit, phase, location}, sampler); // connectorId=1
+}
+
+void addAsyncMeterValueSampler(const char *measurand, const char *unit, ArduinoOcpp::AsyncMeasurandSampler sampler, const char *phase, const char *location)
+{
+    if (!ocppEngine)
+    {
+        AO_DBG_ERR("Please call OCPP_initialize before");
+        return;
+    }
+    auto &model = ocppEngine->getOcppModel();
+    if (!model.getMeteringService())
+    {
+        model.setMeteringSerivce(std::unique_ptr<MeteringService>(
+            new MeteringService(*ocppEngine, OCPP_NUMCONNECTORS, filesystem)));
+    }
+    model.getMeteringService()->addAsyncMeterValueSampler(OCPP_ID_OF_CONNECTOR, {measurand, unit, phase, location}, sampler); // connectorId=1
+}
+
 void setEvRequestsEnergySampler(std::function<bool()> evRequestsEnergy)
 {
     if (!ocppEngine)
@@ -279,9 +356,42 @@ void setOnChargingRateLimitChange(std::function<void(float)> chargingRateChanged
     if (!model.getSmartChargingService())
     {
         model.setSmartChargingService(std::unique_ptr<SmartChargingService>(
-            new SmartChargingService(*ocppEngine, 11000.0f, voltage_eff, OCPP_NUMCONNECTORS, fileSystemOpt))); // default charging limit: 11kW
+            new SmartChargingService(*ocppEngine, 11000.0f, voltage_eff, OCPP_NUMCONNECTORS, filesystem))); // default charging limit: 11kW
+    }
+    model.getSmartChargingService()->setOnLimitChange(OCPP_ID_OF_CONNECTOR, chargingRateChanged); // connectorId=1
+}
+
+void setOnChargingLimitChange(std::function<void(const ArduinoOcpp::ChargingLimit&)> chargingLimitChanged)
+{
+    if (!ocppEngine)
+    {
+        AO_DBG_ERR("Please call OCPP_initialize before");
+        return;
+    }
+    auto &model = ocppEngine->getOcppModel();
+    if (!model.getSmartChargingService())
+    {
+        model.setSmartChargingService(std::unique_ptr<SmartChargingService>(
+            new SmartChargingService(*ocppEngine, 11000.0f, voltage_eff, OCPP_NUMCONNECTORS, filesystem))); // default charging limit: 11kW
+    }
+    model.getSmartChargingService()->setOnChargingLimitChange(OCPP_ID_OF_CONNECTOR, chargingLimitChanged); // connectorId=1
+}
+
+void setChargingSupplyPhases(int numberPhases, bool phaseSwitching)
+{
+    if (!ocppEngine)
+    {
+        AO_DBG_ERR("Please call OCPP_initialize before");
+        return;
+    }
+    auto &model = ocppEngine->getOcppModel();
+    if (!model.getSmartChargingService())
+    {
+        model.setSmartChargingService(std::unique_ptr<SmartChargingService>(
+            new SmartChargingService(*ocppEngine, 11000.0f, voltage_eff, OCPP_NUMCONNECTORS, filesystem))); // default charging limit: 11kW
     }
-    model.getSmartChargingService()->setOnLimitChange(chargingRateChanged);
+    model.getSmartChargingService()->setSupplyPhases(0, numberPhases); // grid connection of the station
+    model.getSmartChargingService()->setSupplyPhases(OCPP_ID_OF_CONNECTOR, numberPhases, phaseSwitching); // connectorId=1
 }
 
 void setOnUnlockConnector(std::function<bool()> unlockConnector)
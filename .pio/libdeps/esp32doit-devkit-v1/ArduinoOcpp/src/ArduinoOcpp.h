@@ -10,10 +10,15 @@
 #include <functional>
 
 #include <ArduinoOcpp/Core/ConfigurationOptions.h>
+#include <ArduinoOcpp/Core/FilesystemAdapter.h>
 #include <ArduinoOcpp/Core/OcppTime.h>
 #include <ArduinoOcpp/Core/OcppOperationCallbacks.h>
 #include <ArduinoOcpp/Core/OcppOperationTimeout.h>
 #include <ArduinoOcpp/Core/OcppSocket.h>
+#include <ArduinoOcpp/Tasks/Metering/EnergyIntegrator.h>
+#include <ArduinoOcpp/Tasks/Metering/MeterSnapshot.h>
+#include <ArduinoOcpp/Tasks/Metering/MeterReading.h>
+#include <ArduinoOcpp/Tasks/SmartCharging/SmartChargingModel.h>
 
 using ArduinoOcpp::OnAbortListener;
 using ArduinoOcpp::OnReceiveConfListener;
@@ -24,6 +29,12 @@ using ArduinoOcpp::OnTimeoutListener;
 
 using ArduinoOcpp::Timeout;
 
+/*
+ * system_time: your system clock in seconds. It is the long-term time base of the OCPP time, which keeps the
+ * millisecond resolution of ao_tick_ms() and is disciplined by the server time (see OcppTime.h). Pass a clock which
+ * keeps running in sleep modes (e.g. RTC) if ao_tick_ms() stops there
+ */
+
 #ifndef AO_CUSTOM_WS
 // uses links2004/WebSockets library
 void OCPP_initialize(const char *CS_hostname, uint16_t CS_port, const char *CS_url, float V_eff = 230.f /*German grid*/, ArduinoOcpp::FilesystemOpt fsOpt = ArduinoOcpp::FilesystemOpt::Use_Mount_FormatOnFail, ArduinoOcpp::OcppClock system_time = ArduinoOcpp::Clocks::DEFAULT_CLOCK);
@@ -36,6 +47,9 @@ void OCPP_initialize(const char *CS_hostname, uint16_t CS_port, const char *CS_u
 // Lets you use your own WebSocket implementation
 void OCPP_initialize(ArduinoOcpp::OcppSocket &ocppSocket, float V_eff = 230.f /*German grid*/, ArduinoOcpp::FilesystemOpt fsOpt = ArduinoOcpp::FilesystemOpt::Use_Mount_FormatOnFail, ArduinoOcpp::OcppClock system_time = ArduinoOcpp::Clocks::DEFAULT_CLOCK);
 
+// Like above, but persists all data on the given filesystem (e.g. POSIX or RAM for host builds). nullptr: no persistency
+void OCPP_initialize(ArduinoOcpp::OcppSocket &ocppSocket, float V_eff, std::shared_ptr<ArduinoOcpp::FilesystemAdapter> filesystem, ArduinoOcpp::OcppClock system_time = ArduinoOcpp::Clocks::DEFAULT_CLOCK);
+
 // experimental; More testing required (help needed: it would be awesome if you can you publish your evaluation results on the GitHub page)
 void OCPP_deinitialize();
 
@@ -55,6 +69,53 @@ void setPowerActiveImportSampler(std::function<float()> power);
 
 void setEnergyActiveImportSampler(std::function<float()> energy);
 
+/*
+ * Alternative to setEnergyActiveImportSampler() for EVSEs without energy register: sets power as
+ * Power.Active.Import sampler and integrates it to the Energy.Active.Import.Register. The power is sampled every
+ * samplePeriodMs, as long as OCPP_loop() is called often enough. The register is checkpointed to the flash and
+ * continues from its last value after a reboot
+ */
+void setIntegratedEnergyActiveImportSampler(std::function<float()> power, unsigned long samplePeriodMs = AO_ENERGY_INTEGRATION_PERIOD_MS);
+
+/*
+ * Alternative to the single samplers for meters which are read over a slow bus (e.g. Modbus): the sampler reads
+ * all channels in one go and stores them with snapshot.set(channelIndex, value). The channels may belong to
+ * different connectors. Example:
+ *
+ *     const ArduinoOcpp::MeterChannel channels [] = {
+ *         {1, {"Energy.Active.Import.Register", "Wh", nullptr, nullptr}},
+ *         {1, {"Current.Import", "A", "L1", nullptr}}};
+ *     setBatchMeterSampler(channels, 2, [] (ArduinoOcpp::MeterSnapshot& snapshot) {
+ *         ... //read registers from meter
+ *         snapshot.set(0, energy);
+ *         snapshot.set(1, currentL1);
+ *         return true;
+ *     });
+ */
+void setBatchMeterSampler(const ArduinoOcpp::MeterChannel *channels, size_t numChannels, ArduinoOcpp::BatchMeterSampler sampler);
+
+/*
+ * Add a sampler for any other measurand, e.g. addMeterValueSampler("Current.Import", "A", readCurrentL1, "L1").
+ * Which measurands are reported is selected by the OCPP configuration key MeterValuesSampledData. All strings
+ * must be string literals or have static storage duration
+ */
+void addMeterValueSampler(const char *measurand, const char *unit, std::function<float()> sampler, const char *phase = nullptr, const char *location = nullptr);
+
+/*
+ * Like addMeterValueSampler, but for meters which are too slow to be read within OCPP_loop(). The sampler starts
+ * the read, returns a MeterReading and calls MeterReading::complete(value) as soon as the value is available:
+ *
+ *     addAsyncMeterValueSampler("Energy.Active.Import.Register", "Wh", [] () {
+ *         auto reading = std::make_shared<ArduinoOcpp::MeterReading>();
+ *         myBusDriver.requestEnergy([reading] (float energy) {reading->complete(energy);});
+ *         return reading;
+ *     });
+ *
+ * The samples of MeterValues are timestamped when the read starts. Functions which need a value immediately (e.g.
+ * meterStop of StopTransaction) use the most recent completed read
+ */
+void addAsyncMeterValueSampler(const char *measurand, const char *unit, ArduinoOcpp::AsyncMeasurandSampler sampler, const char *phase = nullptr, const char *location = nullptr);
+
 void setEvRequestsEnergySampler(std::function<bool()> evRequestsEnergy);
 
 void setConnectorEnergizedSampler(std::function<bool()> connectorEnergized);
@@ -77,6 +138,16 @@ void addConnectorErrorCodeSampler(std::function<const char *()> connectorErrorCo
 
 void setOnChargingRateLimitChange(std::function<void(float)> chargingRateChanged);
 
+/*
+ * Like setOnChargingRateLimitChange(), but passes the limit as power in W, current in A per phase and the number
+ * of phases to use. The limits are converted with the phase voltage V_eff of OCPP_initialize(). Set the phases
+ * which the EVSE is wired with by setChargingSupplyPhases()
+ */
+void setOnChargingLimitChange(std::function<void(const ArduinoOcpp::ChargingLimit&)> chargingLimitChanged);
+
+// numberPhases: 1 (default) or 3. phaseSwitching: the EVSE can switch to 1 phase if the current is too low for 3
+void setChargingSupplyPhases(int numberPhases, bool phaseSwitching = false);
+
 void setOnUnlockConnector(std::function<bool()> unlockConnector); // true: success, false: failure
 
 /*
@@ -0,0 +1,27 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Core/Checksum.h>
+
+namespace ArduinoOcpp {
+
+namespace Crc32 {
+//nibble-wise lookup table: 64 bytes of flash instead of 1k for the byte-wise table
+const uint32_t TABLE [16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+}
+
+uint32_t crc32(const uint8_t *data, size_t len, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = Crc32::TABLE[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+        crc = Crc32::TABLE[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+} //end namespace ArduinoOcpp
@@ -0,0 +1,20 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ArduinoOcpp {
+
+/*
+ * CRC-32 (IEEE 802.3, reflected). Pass the result of a previous call as crc to checksum data in chunks
+ */
+uint32_t crc32(const uint8_t *data, size_t len, uint32_t crc = 0);
+
+} //end namespace ArduinoOcpp
+
+#endif
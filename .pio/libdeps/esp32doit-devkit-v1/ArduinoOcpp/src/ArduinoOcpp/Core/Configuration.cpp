@@ -9,17 +9,9 @@
 #include <vector>
 #include <ArduinoJson.h>
 
-#if defined(ESP32) && !defined(AO_DEACTIVATE_FLASH)
-#include <LITTLEFS.h>
-#define USE_FS LITTLEFS
-#else
-#include <FS.h>
-#define USE_FS SPIFFS
-#endif
-
 namespace ArduinoOcpp {
 
-FilesystemOpt configurationFilesystemOpt = FilesystemOpt::Use_Mount_FormatOnFail;
+std::shared_ptr<FilesystemAdapter> configurationFilesystem;
 
 template<class T>
 std::shared_ptr<Configuration<T>> createConfiguration(const char *key, T value) {
@@ -55,14 +47,14 @@ std::shared_ptr<Configuration<const char *>> createConfiguration(const char *key
 
 std::shared_ptr<ConfigurationContainer> createConfigurationContainer(const char *filename) {
     //create non-persistent Configuration store (i.e. lives only in RAM) if
-    //     - Flash FS usage is switched off OR
+    //     - there is no FS (switched off or configuration_init() not called yet) OR
     //     - Filename starts with "/volatile"
-    if (!configurationFilesystemOpt.accessAllowed() ||
+    if (!configurationFilesystem ||
                  !strncmp(filename, CONFIGURATION_VOLATILE, strlen(CONFIGURATION_VOLATILE))) {
         return std::static_pointer_cast<ConfigurationContainer>(std::make_shared<ConfigurationContainerVolatile>(filename));
     } else {
         //create persistent Configuration store. This is the normal case
-        return std::static_pointer_cast<ConfigurationContainer>(std::make_shared<ConfigurationContainerFlash>(filename));
+        return std::static_pointer_cast<ConfigurationContainer>(std::make_shared<ConfigurationContainerFlash>(configurationFilesystem, filename));
     }
 }
 
@@ -93,10 +85,7 @@ std::shared_ptr<ConfigurationContainer> getContainer(const char *filename) {
     }
 }
 
-template<class T>
-std::shared_ptr<Configuration<T>> declareConfiguration(const char *key, T defaultValue, const char *filename, bool remotePeerCanWrite, bool remotePeerCanRead, bool localClientCanWrite, bool rebootRequiredWhenChanged) {
-    //already existent? --> stored in last session --> do set default content, but set writepermission flag
-    
+std::shared_ptr<ConfigurationContainer> getOrLoadContainer(const char *filename) {
     std::shared_ptr<ConfigurationContainer> container = getContainer(filename);
     
     if (!container) {
@@ -110,6 +99,26 @@ std::shared_ptr<Configuration<T>> declareConfiguration(const char *key, T defaul
         }
     }
 
+    return container;
+}
+
+void applyPermissions(AbstractConfiguration& configuration, bool remotePeerCanWrite, bool remotePeerCanRead, bool localClientCanWrite, bool rebootRequiredWhenChanged) {
+    if (!remotePeerCanWrite)
+        configuration.revokePermissionRemotePeerCanWrite();
+    if (!remotePeerCanRead)
+        configuration.revokePermissionRemotePeerCanRead();
+    if (!localClientCanWrite)
+        configuration.revokePermissionLocalClientCanWrite();
+    if (rebootRequiredWhenChanged)
+        configuration.requireRebootWhenChanged();
+}
+
+template<class T>
+std::shared_ptr<Configuration<T>> declareConfiguration(const char *key, T defaultValue, const char *filename, bool remotePeerCanWrite, bool remotePeerCanRead, bool localClientCanWrite, bool rebootRequiredWhenChanged) {
+    //already existent? --> stored in last session --> do set default content, but set writepermission flag
+    
+    std::shared_ptr<ConfigurationContainer> container = getOrLoadContainer(filename);
+
     std::shared_ptr<AbstractConfiguration> configuration = container->getConfiguration(key);
 
     if (configuration && strcmp(configuration->getSerializedType(), SerializedType<T>::get())) {
@@ -136,18 +145,46 @@ std::shared_ptr<Configuration<T>> declareConfiguration(const char *key, T defaul
         container->addConfiguration(configuration);
     }
 
-    if (!remotePeerCanWrite)
-        configuration->revokePermissionRemotePeerCanWrite();
-    if (!remotePeerCanRead)
-        configuration->revokePermissionRemotePeerCanRead();
-    if (!localClientCanWrite)
-        configuration->revokePermissionLocalClientCanWrite();
-    if (rebootRequiredWhenChanged)
-        configuration->requireRebootWhenChanged();
+    applyPermissions(*configuration, remotePeerCanWrite, remotePeerCanRead, localClientCanWrite, rebootRequiredWhenChanged);
 
     return configurationConcrete;
 }
 
+Configuration<int> *declareConfiguration(StandardIntKey key) {
+    const StandardKey<int>& standardKey = getStandardKey(key);
+
+    std::shared_ptr<ConfigurationContainer> container = getOrLoadContainer(standardKey.filename);
+
+    std::shared_ptr<Configuration<int>> configuration = getStandardConfiguration(key);
+    if (!configuration) {
+        AO_DBG_ERR("Cannot bind standard configuration %s", standardKey.key);
+        return nullptr;
+    }
+
+    std::shared_ptr<AbstractConfiguration> stored = container->getConfiguration(standardKey.key);
+
+    if (stored != configuration) {
+        //not loaded into static storage yet: either adopt the value from the stored object or initialize with default
+        if (stored && !stored->toBeRemoved() && !strcmp(stored->getSerializedType(), SerializedType<int>::get())) {
+            *configuration = (int) *std::static_pointer_cast<Configuration<int>>(stored);
+        } else {
+            *configuration = standardKey.defaultValue;
+        }
+
+        if (stored) {
+            container->replaceConfiguration(stored, configuration);
+        } else {
+            container->addConfiguration(configuration);
+        }
+    } else if (configuration->toBeRemoved()) {
+        *configuration = standardKey.defaultValue;
+    }
+
+    applyPermissions(*configuration, standardKey.remotePeerCanWrite, standardKey.remotePeerCanRead, standardKey.localClientCanWrite, standardKey.rebootRequiredWhenChanged);
+
+    return configuration.get();
+}
+
 namespace Ocpp16 {
 
 std::shared_ptr<AbstractConfiguration> getConfiguration(const char *key) {
@@ -180,32 +217,29 @@ std::shared_ptr<std::vector<std::shared_ptr<AbstractConfiguration>>> getAllConfi
 bool configuration_inited = false;
 
 bool configuration_init(FilesystemOpt fsOpt) {
+    if (configuration_inited)
+        return true; //already initialized; don't mount again
+
+    auto filesystem = makeDefaultFilesystemAdapter(fsOpt);
+
+    bool mountSuccessful = true;
+#if AO_USE_FILEAPI != DISABLE_FS
+    if (fsOpt.mustMount() && !filesystem) {
+        mountSuccessful = false; //continue without filesystem, but report the failure like a failed load
+    }
+#endif
+
+    bool loadRoutineSuccessful = configuration_init(filesystem);
+    return loadRoutineSuccessful && mountSuccessful;
+}
+
+bool configuration_init(std::shared_ptr<FilesystemAdapter> filesystem) {
     if (configuration_inited)
         return true; //configuration_init() already called; tolerate multiple calls so user can use this store for
                      //credentials outside ArduinoOcpp which need to be loaded before OCPP_initialize()
     bool loadRoutineSuccessful = true;
-#ifndef AO_DEACTIVATE_FLASH
 
-    configurationFilesystemOpt = fsOpt;
-
-    if (fsOpt.mustMount()) { 
-#if defined(ESP32)
-        if(!LITTLEFS.begin(fsOpt.formatOnFail())) {
-            AO_DBG_ERR("Error while mounting LITTLEFS");
-            loadRoutineSuccessful = false;
-        }
-#else
-        //ESP8266
-        SPIFFSConfig cfg;
-        cfg.setAutoFormat(fsOpt.formatOnFail());
-        SPIFFS.setConfig(cfg);
-
-        if (!SPIFFS.begin()) {
-            AO_DBG_ERR("Unable to initialize: unable to mount SPIFFS");
-            loadRoutineSuccessful = false;
-        }
-#endif
-    } //end fs mount
+    configurationFilesystem = filesystem;
 
     std::shared_ptr<ConfigurationContainer> containerDefault = nullptr;
     for (auto container = configurationContainers.begin(); container != configurationContainers.end(); container++) {
@@ -228,16 +262,12 @@ bool configuration_init(FilesystemOpt fsOpt) {
         configurationContainers.push_back(containerDefault);
     }
 
-
-#endif //ndef AO_DEACTIVATE_FLASH
     configuration_inited = loadRoutineSuccessful;
     return loadRoutineSuccessful;
 }
 
 bool configuration_save() {
     bool success = true;
-#ifndef AO_DEACTIVATE_FLASH
-
 
     for (auto container = configurationContainers.begin(); container != configurationContainers.end(); container++) {
         if (!(*container)->save()) {
@@ -245,10 +275,16 @@ bool configuration_save() {
         }
     }
 
-#endif //ndef AO_DEACTIVATE_FLASH
     return success;
 }
 
+void configuration_deinit() {
+    configurationContainers.clear();
+    configurationFilesystem.reset();
+    resetStandardConfigurations();
+    configuration_inited = false;
+}
+
 template std::shared_ptr<Configuration<int>> createConfiguration(const char *key, int value);
 template std::shared_ptr<Configuration<float>> createConfiguration(const char *key, float value);
 template std::shared_ptr<Configuration<const char *>> createConfiguration(const char *key, const char * value);
@@ -8,6 +8,7 @@
 #include <ArduinoOcpp/Core/ConfigurationKeyValue.h>
 #include <ArduinoOcpp/Core/ConfigurationOptions.h>
 #include <ArduinoOcpp/Core/ConfigurationContainerFlash.h>
+#include <ArduinoOcpp/Core/StandardConfiguration.h>
 
 #include <memory>
 #include <vector>
@@ -20,6 +21,12 @@ namespace ArduinoOcpp {
 template <class T>
 std::shared_ptr<Configuration<T>> declareConfiguration(const char *key, T defaultValue, const char *filename = CONFIGURATION_FN, bool remotePeerCanWrite = true, bool remotePeerCanRead = true, bool localClientCanWrite = true, bool rebootRequiredWhenChanged = false);
 
+/*
+ * Declares a standard key from the compile-time registry (see StandardConfiguration.h). The returned object is in
+ * static storage and valid for the whole program runtime
+ */
+Configuration<int> *declareConfiguration(StandardIntKey key);
+
 void addConfigurationContainer(std::shared_ptr<ConfigurationContainer> container);
 std::vector<std::shared_ptr<ConfigurationContainer>>::iterator getConfigurationContainersBegin();
 std::vector<std::shared_ptr<ConfigurationContainer>>::iterator getConfigurationContainersEnd();
@@ -32,7 +39,19 @@ namespace Ocpp16 {
 }
 
 bool configuration_init(FilesystemOpt fsOpt = FilesystemOpt::Use_Mount_FormatOnFail);
+
+/*
+ * Like above, but stores the configurations on the given filesystem (e.g. a RamFilesystemAdapter for host tests).
+ * filesystem == nullptr keeps all configurations in RAM
+ */
+bool configuration_init(std::shared_ptr<FilesystemAdapter> filesystem);
 bool configuration_save();
 
+/*
+ * Releases all containers and the filesystem, so that configuration_init() loads them again. The Configurations
+ * which are still referenced from outside are detached from the store. The standard keys are reset
+ */
+void configuration_deinit();
+
 } //end namespace ArduinoOcpp
 #endif
@@ -38,6 +38,16 @@ void ConfigurationContainer::addConfiguration(std::shared_ptr<AbstractConfigurat
     configurations.push_back(configuration);
 }
 
+bool ConfigurationContainer::replaceConfiguration(std::shared_ptr<AbstractConfiguration> configuration, std::shared_ptr<AbstractConfiguration> replacement) {
+    for (auto config = configurations.begin(); config != configurations.end(); config++) {
+        if ((*config) == configuration) {
+            (*config) = replacement;
+            return true;
+        }
+    }
+    return false;
+}
+
 bool ConfigurationContainer::configurationsUpdated() {
     bool updated = false;
 
@@ -38,6 +38,7 @@ public:
     std::vector<std::shared_ptr<AbstractConfiguration>>::iterator configurationsIteratorEnd() {return configurations.end();}
     bool removeConfiguration(std::shared_ptr<AbstractConfiguration> configuration);
     void addConfiguration(std::shared_ptr<AbstractConfiguration> configuration);
+    bool replaceConfiguration(std::shared_ptr<AbstractConfiguration> configuration, std::shared_ptr<AbstractConfiguration> replacement); //keeps position in container
 };
 
 class ConfigurationContainerVolatile : public ConfigurationContainer {
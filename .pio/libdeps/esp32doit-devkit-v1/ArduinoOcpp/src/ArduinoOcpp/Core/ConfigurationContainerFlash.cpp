@@ -3,96 +3,374 @@
 // MIT License
 
 #include <ArduinoOcpp/Core/ConfigurationContainerFlash.h>
+#include <ArduinoOcpp/Core/StandardConfiguration.h>
+#include <ArduinoOcpp/Core/Checksum.h>
 #include <ArduinoOcpp/Debug.h>
 
-#if defined(ESP32)
-#define USE_FS LITTLEFS
-#else
-#define USE_FS SPIFFS
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef AO_CONFIG_MAX_FILE_SIZE
+#define AO_CONFIG_MAX_FILE_SIZE 4000
 #endif
 
-#if USE_FS == LITTLEFS
-#include <LITTLEFS.h>
-#elif USE_FS == SPIFFS
-#include <FS.h>
-#else
-#error "FS not supported"
+#ifndef AO_CONFIG_MAX_CONFIGURATIONS
+#define AO_CONFIG_MAX_CONFIGURATIONS 50
 #endif
 
-#define MAX_FILE_SIZE 4000
-#define MAX_CONFIGURATIONS 50
+#define MAX_FILE_SIZE AO_CONFIG_MAX_FILE_SIZE
+#define MAX_CONFIGURATIONS AO_CONFIG_MAX_CONFIGURATIONS
+
+#define BINARY_MAGIC "AOCF"
+#define BINARY_VERSION 2
+#define BINARY_HEADER_SIZE 24
+#define BINARY_HEADER_SIZE_V1 16 //version 1: no generation counter and header checksum
+
+#define BINARY_TYPE_INT 1
+#define BINARY_TYPE_FLOAT 2
+#define BINARY_TYPE_STRING 3
+
+#define BINARY_MAX_KEY_SIZE 0xFF //key length field is 8 bit, including the terminating zero
+#define BINARY_MAX_STRING_SIZE 0xFFFF //string value length field is 16 bit, including the terminating zero
 
 namespace ArduinoOcpp {
 
+namespace BinaryFormat {
+
+void writeU16(std::vector<uint8_t>& out, uint16_t val) {
+    out.push_back((uint8_t) (val & 0xFF));
+    out.push_back((uint8_t) ((val >> 8) & 0xFF));
+}
+
+void writeU32(std::vector<uint8_t>& out, uint32_t val) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((uint8_t) ((val >> (8 * i)) & 0xFF));
+    }
+}
+
+uint16_t readU16(const uint8_t *buf) {
+    return (uint16_t) buf[0] | ((uint16_t) buf[1] << 8);
+}
+
+uint32_t readU32(const uint8_t *buf) {
+    return (uint32_t) buf[0] | ((uint32_t) buf[1] << 8) | ((uint32_t) buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
+
+struct SnapshotHeader {
+    uint32_t generation = 0;
+    size_t configurations_len = 0;
+    size_t payload_offset = 0;
+    size_t payload_size = 0;
+    uint32_t payload_crc = 0;
+};
+
+//reads and validates only the header of a slot. Returns false if the slot is missing, torn or in another format
+bool readSnapshotHeader(FilesystemAdapter& filesystem, const char *fn, SnapshotHeader& header) {
+    size_t file_size = 0;
+    if (!filesystem.stat(fn, &file_size)) {
+        return false;
+    }
+
+    auto file = filesystem.open(fn, "r");
+    if (!file) {
+        return false;
+    }
+
+    uint8_t buf [BINARY_HEADER_SIZE];
+    size_t read_size = file->read(buf, BINARY_HEADER_SIZE);
+    file.reset();
+
+    if (read_size < BINARY_HEADER_SIZE_V1 || memcmp(buf, BINARY_MAGIC, strlen(BINARY_MAGIC))) {
+        return false;
+    }
+
+    header.configurations_len = readU16(buf + 6);
+
+    if (buf[4] == 1) {
+        header.generation = 0;
+        header.payload_size = readU32(buf + 8);
+        header.payload_crc = readU32(buf + 12);
+        header.payload_offset = BINARY_HEADER_SIZE_V1;
+    } else if (buf[4] == BINARY_VERSION) {
+        if (read_size < BINARY_HEADER_SIZE || crc32(buf, BINARY_HEADER_SIZE - 4) != readU32(buf + 20)) {
+            AO_DBG_WARN("Header checksum mismatch in %s", fn);
+            return false;
+        }
+        header.generation = readU32(buf + 8);
+        header.payload_size = readU32(buf + 12);
+        header.payload_crc = readU32(buf + 16);
+        header.payload_offset = BINARY_HEADER_SIZE;
+    } else {
+        AO_DBG_ERR("Unsupported version %u in %s", buf[4], fn);
+        return false;
+    }
+
+    if (header.configurations_len > MAX_CONFIGURATIONS ||
+            header.payload_offset + header.payload_size != file_size ||
+            file_size > MAX_FILE_SIZE) {
+        AO_DBG_WARN("Incomplete or oversized snapshot %s", fn);
+        return false;
+    }
+
+    return true;
+}
+
+//reads until delim or the end of the file. The delimiter is consumed but not appended to token
+void readToken(FileAdapter& file, char delim, std::string& token) {
+    token.clear();
+    int c;
+    while ((c = file.read()) >= 0 && c != delim) {
+        token += (char) c;
+    }
+}
+
+} //end namespace BinaryFormat
+
+ConfigurationContainerFlash::ConfigurationContainerFlash(std::shared_ptr<FilesystemAdapter> filesystem, const char *filename)
+        : ConfigurationContainer(filename), filesystem(filesystem) {
+    filenameSlotB = filename;
+    filenameSlotB += ".b";
+}
+
+const char *ConfigurationContainerFlash::getSlotFilename(int slot) {
+    return slot == 0 ? getFilename() : filenameSlotB.c_str();
+}
+
 bool ConfigurationContainerFlash::load() {
-#ifndef AO_DEACTIVATE_FLASH
+    using namespace BinaryFormat;
 
     if (configurations.size() > 0) {
         AO_DBG_ERR("Error: declared configurations before calling container->load(). " \
                     "All previously declared values won't be written back");
     }
 
-    if (!USE_FS.exists(getFilename())) {
+    //fast path: only read the headers of both slots and load the newest valid one
+    SnapshotHeader headers [2];
+    bool headerValid [2];
+    for (int slot = 0; slot < 2; slot++) {
+        headerValid[slot] = readSnapshotHeader(*filesystem, getSlotFilename(slot), headers[slot]);
+    }
+
+    int newest = 0;
+    if (headerValid[0] && headerValid[1]) {
+        newest = (int32_t) (headers[1].generation - headers[0].generation) > 0 ? 1 : 0;
+    } else if (headerValid[1]) {
+        newest = 1;
+    }
+
+    for (int slot : {newest, 1 - newest}) {
+        if (!headerValid[slot]) {
+            continue;
+        }
+
+        if (loadSlot(slot, headers[slot].payload_offset, headers[slot].payload_size, headers[slot].payload_crc, headers[slot].configurations_len)) {
+            activeSlot = slot;
+            generation = headers[slot].generation;
+            configurationsUpdated();
+            AO_DBG_DEBUG("Initialization successful (slot %s, generation %u)", getSlotFilename(slot), (unsigned int) generation);
+            return true;
+        }
+
+        AO_DBG_WARN("Could not load %s. Fall back to previous snapshot", getSlotFilename(slot));
+    }
+
+    if (headerValid[0] || headerValid[1]) {
+        AO_DBG_ERR("Unable to initialize: no valid configuration snapshot");
+        return false;
+    }
+
+    //no binary snapshot. Try legacy JSON format and migrate
+    if (!filesystem->stat(getFilename())) {
         AO_DBG_DEBUG("Populate FS: create configuration file");
         return true;
     }
 
-    File file = USE_FS.open(getFilename(), "r");
+    if (!loadJson()) {
+        return false;
+    }
+
+    //the JSON file occupies slot A until the second save
+    activeSlot = 0;
+
+    AO_DBG_INFO("Migrate %s to binary format", getFilename());
+    return storeBinary();
+}
+
+bool ConfigurationContainerFlash::loadSlot(int slot, size_t payload_offset, size_t payload_size, uint32_t payload_crc, size_t configurations_len) {
+    auto file = filesystem->open(getSlotFilename(slot), "r");
 
     if (!file) {
+        AO_DBG_ERR("Unable to initialize: could not open configuration file %s", getSlotFilename(slot));
+        return false;
+    }
+
+    std::vector<uint8_t> payload (payload_size);
+
+    size_t read_size = 0;
+    if (file->seek(payload_offset)) {
+        read_size = file->read(payload.data(), payload_size);
+    }
+    file.reset();
+
+    if (read_size != payload_size) {
+        AO_DBG_ERR("Unable to initialize: could not read configuration file %s", getSlotFilename(slot));
+        return false;
+    }
+
+    if (crc32(payload.data(), payload_size) != payload_crc) {
+        AO_DBG_ERR("Unable to initialize: checksum mismatch in %s", getSlotFilename(slot));
+        return false;
+    }
+
+    if (!loadBinary(payload.data(), payload_size, configurations_len)) {
+        configurations.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool ConfigurationContainerFlash::loadBinary(const uint8_t *payload, size_t payload_size, size_t configurations_len) {
+    using namespace BinaryFormat;
+
+    size_t pos = 0;
+    for (size_t i = 0; i < configurations_len; i++) {
+        if (pos + 2 > payload_size) {
+            AO_DBG_ERR("Unable to initialize: unexpected end of file");
+            return false;
+        }
+
+        uint8_t type = payload[pos++];
+        size_t key_size = payload[pos++];
+
+        if (key_size < 2 || pos + key_size > payload_size || payload[pos + key_size - 1] != '\0') {
+            AO_DBG_ERR("Unable to initialize: corrupt key");
+            return false;
+        }
+
+        const char *key = (const char *) (payload + pos);
+        pos += key_size;
+
+        std::shared_ptr<AbstractConfiguration> configuration = nullptr;
+
+        if (type == BINARY_TYPE_INT || type == BINARY_TYPE_FLOAT) {
+            if (pos + 4 > payload_size) {
+                AO_DBG_ERR("Unable to initialize: unexpected end of file");
+                return false;
+            }
+            uint32_t raw = readU32(payload + pos);
+            pos += 4;
+
+            if (type == BINARY_TYPE_INT) {
+                auto config = findStandardConfiguration<int>(key, getFilename()); //use static storage for standard keys
+                if (config) {
+                    *config = (int) (int32_t) raw;
+                    configuration = config;
+                } else {
+                    config = std::make_shared<Configuration<int>>();
+                    if (config->setKey(key)) {
+                        *config = (int) (int32_t) raw;
+                        configuration = config;
+                    }
+                }
+            } else {
+                float value;
+                memcpy(&value, &raw, sizeof(float));
+                auto config = std::make_shared<Configuration<float>>();
+                if (config->setKey(key)) {
+                    *config = value;
+                    configuration = config;
+                }
+            }
+        } else if (type == BINARY_TYPE_STRING) {
+            if (pos + 2 > payload_size) {
+                AO_DBG_ERR("Unable to initialize: unexpected end of file");
+                return false;
+            }
+            size_t value_size = readU16(payload + pos);
+            pos += 2;
+
+            if (value_size < 1 || pos + value_size > payload_size || payload[pos + value_size - 1] != '\0') {
+                AO_DBG_ERR("Unable to initialize: corrupt string value");
+                return false;
+            }
+
+            auto config = std::make_shared<Configuration<const char *>>();
+            if (config->setKey(key) && config->setValue((const char *) (payload + pos), value_size)) {
+                configuration = config;
+            }
+            pos += value_size;
+        } else {
+            AO_DBG_ERR("Unable to initialize: unknown type tag %u", type);
+            return false;
+        }
+
+        if (configuration) {
+            configurations.push_back(configuration);
+        } else {
+            AO_DBG_ERR("Initialization fault: could not read key-value pair %s", key);
+        }
+    }
+
+    return true;
+}
+
+bool ConfigurationContainerFlash::loadJson() {
+    using namespace BinaryFormat;
+
+    size_t file_size = 0;
+    if (!filesystem->stat(getFilename(), &file_size)) {
         AO_DBG_ERR("Unable to initialize: could not open configuration file %s", getFilename());
         return false;
     }
 
-    if (!file.available()) {
+    if (file_size == 0) {
         AO_DBG_DEBUG("Populate FS: create configuration file");
-        file.close();
         return true;
     }
 
-    int file_size = file.size();
+    auto file = filesystem->open(getFilename(), "r");
+
+    if (!file) {
+        AO_DBG_ERR("Unable to initialize: could not open configuration file %s", getFilename());
+        return false;
+    }
 
     if (file_size < 2) {
         AO_DBG_ERR("Unable to initialize: too short for json");
-        file.close();
         return false;
     } else if (file_size > MAX_FILE_SIZE) {
         AO_DBG_ERR("Unable to initialize: filesize is too long");
-        file.close();
         return false;
     }
 
-    String token = file.readStringUntil('\n');
-    if (!token.equals("content-type:arduino-ocpp_configuration_file")) {
+    std::string token;
+    readToken(*file, '\n', token);
+    if (token != "content-type:arduino-ocpp_configuration_file") {
         AO_DBG_ERR("Unable to initialize: unrecognized configuration file format");
-        file.close();
         return false;
     }
 
-    token = file.readStringUntil('\n');
-    if (!token.equals("version:1.0")) {
+    readToken(*file, '\n', token);
+    if (token != "version:1.0") {
         AO_DBG_ERR("Unable to initialize: unsupported version");
-        file.close();
         return false;
     }
 
-    token = file.readStringUntil(':');
-    if (!token.equals("configurations_len")) {
+    readToken(*file, ':', token);
+    if (token != "configurations_len") {
         AO_DBG_ERR("Unable to initialize: missing length statement");
-        file.close();
         return false;
     }
 
-    token = file.readStringUntil('\n');
-    int configurations_len = token.toInt();
+    readToken(*file, '\n', token);
+    int configurations_len = atoi(token.c_str());
     if (configurations_len <= 0) {
         AO_DBG_ERR("Unable to initialize: empty configuration");
-        file.close();
         return true;
     }
     if (configurations_len > MAX_CONFIGURATIONS) {
         AO_DBG_ERR("Unable to initialize: configurations_len is too big");
-        file.close();
         return false;
     }
 
@@ -102,10 +380,9 @@ bool ConfigurationContainerFlash::load() {
 
     DynamicJsonDocument configDoc(jsonCapacity);
 
-    DeserializationError error = deserializeJson(configDoc, file);
+    DeserializationError error = deserializeJson(configDoc, *file);
     if (error) {
         AO_DBG_ERR("Unable to initialize: config file deserialization failed: %s", error.c_str());
-        file.close();
         return false;
     }
 
@@ -130,76 +407,122 @@ bool ConfigurationContainerFlash::load() {
         }
     }
 
-    file.close();
-
     configurationsUpdated();
 
-    AO_DBG_DEBUG("Initialization successful");
-#endif //ndef AO_DEACTIVATE_FLASH
     return true;
 }
 
 bool ConfigurationContainerFlash::save() {
-#ifndef AO_DEACTIVATE_FLASH
-
     if (!configurationsUpdated()) {
         return true; //nothing to be done
     }
 
-    if (USE_FS.exists(getFilename())) {
-        USE_FS.remove(getFilename());
-    }
+    return storeBinary();
+}
 
-    File file = USE_FS.open(getFilename(), "w");
+bool ConfigurationContainerFlash::storeBinary() {
+    using namespace BinaryFormat;
 
-    if (!file) {
-        AO_DBG_ERR("Unable to save: could not open configuration file %s", getFilename());
-        return false;
-    }
+    std::vector<uint8_t> out;
+    out.reserve(MAX_FILE_SIZE / 4);
+    out.resize(BINARY_HEADER_SIZE);
 
-    size_t jsonCapacity = JSON_OBJECT_SIZE(1); //configurations
+    uint16_t numEntries = 0;
 
-    size_t numEntries = configurations.size();
+    for (auto config = configurations.begin(); config != configurations.end(); config++) {
+        if ((*config)->toBeRemoved() || !(*config)->getKey()) {
+            continue;
+        }
 
-    file.print("content-type:arduino-ocpp_configuration_file\n");
-    file.print("version:1.0\n");
-    file.print("configurations_len:");
-    file.print(numEntries, DEC);
-    file.print("\n");
+        const char *type = (*config)->getSerializedType();
+        const char *key = (*config)->getKey();
+        size_t key_size = strlen(key) + 1;
 
-    std::vector<std::shared_ptr<DynamicJsonDocument>> entries;
+        if (key_size > BINARY_MAX_KEY_SIZE) {
+            AO_DBG_ERR("Unable to save: key %.20s... exceeds %u bytes", key, (unsigned int) BINARY_MAX_KEY_SIZE - 1);
+            return false;
+        }
 
-    for (auto config = configurations.begin(); config != configurations.end(); config++) {
-        std::shared_ptr<DynamicJsonDocument> entry = (*config)->toJsonStorageEntry();
-        if (entry)
-            entries.push_back(entry);
+        if (!strcmp(type, SerializedType<int>::get())) {
+            auto configInt = std::static_pointer_cast<Configuration<int>>(*config);
+            if (!configInt->isValid()) continue;
+            out.push_back(BINARY_TYPE_INT);
+            out.push_back((uint8_t) key_size);
+            out.insert(out.end(), key, key + key_size);
+            writeU32(out, (uint32_t) (int32_t) (int) *configInt);
+        } else if (!strcmp(type, SerializedType<float>::get())) {
+            auto configFloat = std::static_pointer_cast<Configuration<float>>(*config);
+            if (!configFloat->isValid()) continue;
+            float value = *configFloat;
+            uint32_t raw;
+            memcpy(&raw, &value, sizeof(float));
+            out.push_back(BINARY_TYPE_FLOAT);
+            out.push_back((uint8_t) key_size);
+            out.insert(out.end(), key, key + key_size);
+            writeU32(out, raw);
+        } else if (!strcmp(type, SerializedType<const char *>::get())) {
+            auto configString = std::static_pointer_cast<Configuration<const char *>>(*config);
+            if (!configString->isValid()) continue;
+            const char *value = *configString;
+            size_t value_size = strlen(value) + 1;
+            if (value_size > BINARY_MAX_STRING_SIZE) {
+                AO_DBG_ERR("Unable to save: value of %s exceeds %u bytes", key, (unsigned int) BINARY_MAX_STRING_SIZE - 1);
+                return false;
+            }
+            out.push_back(BINARY_TYPE_STRING);
+            out.push_back((uint8_t) key_size);
+            out.insert(out.end(), key, key + key_size);
+            writeU16(out, (uint16_t) value_size);
+            out.insert(out.end(), value, value + value_size);
+        } else {
+            AO_DBG_ERR("Unable to save: unsupported type %s", type);
+            continue;
+        }
+
+        numEntries++;
     }
 
-    jsonCapacity += JSON_ARRAY_SIZE(entries.size()); //length of configurations
-    for (auto entry = entries.begin(); entry != entries.end(); entry++) {
-        jsonCapacity += (*entry)->capacity();
+    if (out.size() > MAX_FILE_SIZE) {
+        AO_DBG_ERR("Unable to save: configurations exceed maximum file size");
+        return false;
     }
 
-    DynamicJsonDocument configDoc(jsonCapacity);
+    size_t payload_size = out.size() - BINARY_HEADER_SIZE;
+    uint32_t nextGeneration = generation + 1;
+
+    std::vector<uint8_t> header;
+    header.reserve(BINARY_HEADER_SIZE);
+    header.insert(header.end(), BINARY_MAGIC, BINARY_MAGIC + strlen(BINARY_MAGIC));
+    header.push_back(BINARY_VERSION);
+    header.push_back(0); //reserved
+    writeU16(header, numEntries);
+    writeU32(header, nextGeneration);
+    writeU32(header, (uint32_t) payload_size);
+    writeU32(header, crc32(out.data() + BINARY_HEADER_SIZE, payload_size));
+    writeU32(header, crc32(header.data(), header.size()));
+    memcpy(out.data(), header.data(), BINARY_HEADER_SIZE);
 
-    JsonArray configurationsArray = configDoc.createNestedArray("configurations");
+    //never touch the active slot. If the write is interrupted, the next boot still finds the previous snapshot
+    int targetSlot = activeSlot == 0 ? 1 : 0;
 
-    for (auto entry = entries.begin(); entry != entries.end(); entry++) {
-        configurationsArray.add((*entry)->as<JsonObject>());
+    auto file = filesystem->open(getSlotFilename(targetSlot), "w");
+
+    if (!file) {
+        AO_DBG_ERR("Unable to save: could not open configuration file %s", getSlotFilename(targetSlot));
+        return false;
     }
 
-    // Serialize JSON to file
-    if (serializeJson(configDoc, file) == 0) {
-        AO_DBG_ERR("Unable to save: Could not serialize JSON");
-        file.close();
+    if (file->write(out.data(), out.size()) != out.size()) {
+        AO_DBG_ERR("Unable to save: could not write configuration file %s", getSlotFilename(targetSlot));
         return false;
     }
 
-    //success
-    file.close();
-    AO_DBG_DEBUG("Saving configDoc successful");
+    file.reset(); //close
 
-#endif //ndef AO_DEACTIVATE_FLASH
+    //success. The new snapshot is valid from now on; switch slots
+    activeSlot = targetSlot;
+    generation = nextGeneration;
+    AO_DBG_DEBUG("Saving configurations successful (slot %s, generation %u)", getSlotFilename(targetSlot), (unsigned int) generation);
     return true;
 }
 
@@ -6,14 +6,43 @@
 #define CONFIGURATIONCONTAINERFLASH_H
 
 #include <ArduinoOcpp/Core/ConfigurationContainer.h>
+#include <ArduinoOcpp/Core/FilesystemAdapter.h>
+
+#include <string>
 
 namespace ArduinoOcpp {
 
+/*
+ * Stores the configurations in a compact binary snapshot. Layout (all integers little-endian):
+ *
+ *     header:  magic "AOCF" | format version (1 byte) | reserved (1 byte) | number of records (2 bytes)
+ *              | generation (4 bytes) | payload length (4 bytes) | CRC-32 of payload (4 bytes)
+ *              | CRC-32 of the preceding header bytes (4 bytes)
+ *     payload: per record: type tag (1 byte) | key length incl. 0-terminator (1 byte) | key
+ *              | value: int or float (4 bytes) or string length incl. 0-terminator (2 bytes) + string
+ *
+ * There are two slots, <filename> and <filename>.b. A save always writes the slot which is not active with an
+ * incremented generation, so a power loss during the write leaves the previous snapshot intact. On boot, only the
+ * headers are read and the newest slot with a valid checksum is loaded.
+ *
+ * Files in the former text-header + JSON format are still accepted and are converted to the binary format during
+ * load.
+ */
 class ConfigurationContainerFlash : public ConfigurationContainer {
-
+private:
+    std::shared_ptr<FilesystemAdapter> filesystem;
+    std::string filenameSlotB;
+    int activeSlot = -1; //0: <filename>, 1: <filename>.b, -1: none
+    uint32_t generation = 0;
+
+    const char *getSlotFilename(int slot);
+    bool loadSlot(int slot, size_t payload_offset, size_t payload_size, uint32_t payload_crc, size_t configurations_len);
+    bool loadBinary(const uint8_t *payload, size_t payload_size, size_t configurations_len);
+    bool loadJson(); //legacy format; only used for migration
+    bool storeBinary();
 
 public:
-    ConfigurationContainerFlash(const char *filename) : ConfigurationContainer(filename) { }
+    ConfigurationContainerFlash(std::shared_ptr<FilesystemAdapter> filesystem, const char *filename);
 
     ~ConfigurationContainerFlash() = default;
 
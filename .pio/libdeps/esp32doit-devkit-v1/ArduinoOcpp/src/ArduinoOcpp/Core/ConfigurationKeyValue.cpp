@@ -9,14 +9,6 @@
 #include <vector>
 #include <ArduinoJson.h>
 
-#if defined(ESP32) && !defined(AO_DEACTIVATE_FLASH)
-#include <LITTLEFS.h>
-#define USE_FS LITTLEFS
-#else
-#include <FS.h>
-#define USE_FS SPIFFS
-#endif
-
 #define KEY_MAXLEN 60
 #define STRING_VAL_MAXLEN 2000 //allow TLS certificates in ...
 
@@ -35,7 +27,7 @@ AbstractConfiguration::AbstractConfiguration(JsonObject &storedKeyValuePair) {
 }
 
 AbstractConfiguration::~AbstractConfiguration() {
-    if (key != nullptr) {
+    if (key != nullptr && !keyStatic) {
         free(key);
     }
     key = nullptr;
@@ -102,6 +94,30 @@ bool AbstractConfiguration::setKey(const char *newKey) {
     return true;
 }
 
+bool AbstractConfiguration::setStaticKey(const char *newKey) {
+    if (key != nullptr || key_size > 0) {
+        AO_DBG_ERR("Cannot change key or set key twice! Keep old value");
+        return false;
+    }
+
+    key_size = strlen(newKey) + 1; //plus 0-terminator
+
+    if (key_size > KEY_MAXLEN + 1) {
+        AO_DBG_ERR("Maximal key length exceeded: %s. Abort", newKey);
+        key_size = 0;
+        return false;
+    } else if (key_size <= 1) {
+        AO_DBG_ERR("Null or empty key not allowed! Abort");
+        key_size = 0;
+        return false;
+    }
+
+    key = const_cast<char*>(newKey); //never written or freed
+    keyStatic = true;
+
+    return true;
+}
+
 void AbstractConfiguration::requireRebootWhenChanged() {
     rebootRequiredWhenChanged = true;
 }
@@ -128,6 +144,37 @@ uint16_t AbstractConfiguration::getValueRevision() {
     return value_revision;
 }
 
+int AbstractConfiguration::addObserver(ConfigurationObserver observer) {
+    int observerId = observerIdCounter++;
+    observers.push_back({observerId, observer});
+    return observerId;
+}
+
+void AbstractConfiguration::removeObserver(int observerId) {
+    for (auto observer = observers.begin(); observer != observers.end(); observer++) {
+        if (observer->first == observerId) {
+            observers.erase(observer);
+            return;
+        }
+    }
+}
+
+void AbstractConfiguration::notifyObservers() {
+    auto notify = observers; //observers may (de)register during the callbacks
+    for (auto& observer : notify) {
+        bool registered = false;
+        for (auto& o : observers) {
+            if (o.first == observer.first) {
+                registered = true;
+                break;
+            }
+        }
+        if (registered) { //skip observers which an earlier callback has removed
+            observer.second();
+        }
+    }
+}
+
 bool AbstractConfiguration::keyEquals(const char *other) {
     return !strcmp(key, other);
 }
@@ -173,11 +220,15 @@ const T &Configuration<T>::operator=(const T & newVal) {
             AO_CONSOLE_PRINTF("\n");
         }
         initializedValue = true;
-        if (value != newVal) {
+        bool value_changed = value != newVal;
+        if (value_changed) {
             value_revision++;
         }
         value = newVal;
         resetToBeRemovedFlag();
+        if (value_changed) {
+            notifyObservers();
+        }
     } else {
         AO_DBG_ERR("Tried to override read-only configuration:");
         AO_CONSOLE_PRINTF("[AO]     > Key = ");
@@ -407,6 +458,9 @@ bool Configuration<const char *>::setValue(const char *new_value, size_t buffsiz
     }
     initializedValue = true;
     resetToBeRemovedFlag();
+    if (value_changed) {
+        notifyObservers();
+    }
     return true;
 }
 
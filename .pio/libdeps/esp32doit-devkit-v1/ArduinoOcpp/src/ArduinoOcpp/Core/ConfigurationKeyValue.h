@@ -7,13 +7,18 @@
 
 #include <ArduinoJson.h>
 #include <memory>
+#include <functional>
+#include <vector>
 
 namespace ArduinoOcpp {
 
+using ConfigurationObserver = std::function<void()>;
+
 class AbstractConfiguration {
 private:
     char *key = nullptr;
     size_t key_size = 0; // key=nullptr --> key_size = 0; key = "" --> key_size = 1; key = "A" --> key_size = 2
+    bool keyStatic = false; //key points to static storage and is not owned by this object
 
     bool rebootRequiredWhenChanged = false;
 
@@ -24,6 +29,9 @@ private:
 //    void loadFromSerializedAccessControl(const char *access);
 
     bool toBeRemovedFlag = false;
+
+    std::vector<std::pair<int, ConfigurationObserver>> observers;
+    int observerIdCounter = 0;
 protected:
     uint16_t value_revision = 0; //number of memory-relevant changes of subclass-member "value" (deleting counts too). This will be important for the client to detect if there was a change
     bool initializedValue = false;
@@ -37,9 +45,13 @@ protected:
     bool isValid();
 
     bool permissionLocalClientCanWrite() {return localClientCanWrite;}
+
+    void notifyObservers(); //call after value has changed
 public:
     virtual ~AbstractConfiguration();
     bool setKey(const char *key);
+    bool setStaticKey(const char *key); //like setKey, but only keeps the pointer. key must outlive this object
+    const char *getKey() {return key;}
     void printKey();
 
     void requireRebootWhenChanged();
@@ -49,6 +61,14 @@ public:
     void resetToBeRemovedFlag();
 
     uint16_t getValueRevision();
+
+    /*
+     * Register a callback which is executed every time the value changes, either by a local write or by the
+     * OCPP server (ChangeConfiguration). Lets services cache derived values instead of reading the value in each
+     * loop. Returns an id for removeObserver(). Observers must be removed before their owner is destroyed
+     */
+    int addObserver(ConfigurationObserver observer);
+    void removeObserver(int observerId);
     bool keyEquals(const char *other);
 
     virtual std::shared_ptr<DynamicJsonDocument> toJsonStorageEntry() = 0;
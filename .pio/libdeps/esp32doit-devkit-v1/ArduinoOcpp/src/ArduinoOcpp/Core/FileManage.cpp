@@ -1,74 +1,56 @@
 #include "FileManage.h"
 
-void listDir(fs::FS &fs, const char *dirname, uint8_t levels)
-{
-    Serial.printf("Listing directory: %s\r\n", dirname);
+#include <string.h>
 
-    File root = fs.open(dirname);
-    if (!root)
-    {
-        Serial.println("- failed to open directory");
-        return;
-    }
-    if (!root.isDirectory())
-    {
-        Serial.println(" - not a directory");
-        return;
-    }
+using ArduinoOcpp::FilesystemAdapter;
+using ArduinoOcpp::FileAdapter;
+
+void listDir(FilesystemAdapter &fs)
+{
+    Serial.println("Listing directory: /");
 
-    File file = root.openNextFile();
-    while (file)
+    fs.forEachFile([&fs](const char *path)
     {
-        if (file.isDirectory())
-        {
-            Serial.print("  DIR : ");
-            Serial.println(file.name());
-            if (levels)
-            {
-                listDir(fs, file.path(), levels - 1);
-            }
-        }
-        else
-        {
-            Serial.print("  FILE: ");
-            Serial.print(file.name());
-            Serial.print("\tSIZE: ");
-            Serial.println(file.size());
-        }
-        file = root.openNextFile();
-    }
+        size_t size = 0;
+        fs.stat(path, &size);
+        Serial.print("  FILE: ");
+        Serial.print(path);
+        Serial.print("\tSIZE: ");
+        Serial.println(size);
+    });
 }
 
-void readFile(fs::FS &fs, const char *path)
+void readFile(FilesystemAdapter &fs, const char *path)
 {
     Serial.printf("Reading file: %s\r\n", path);
 
-    File file = fs.open(path);
-    if (!file || file.isDirectory())
+    std::unique_ptr<FileAdapter> file = fs.open(path, "r");
+    if (!file)
     {
         Serial.println("- failed to open file for reading");
         return;
     }
 
     Serial.println("- read from file:");
-    while (file.available())
+    int c;
+    while ((c = file->read()) >= 0)
     {
-        Serial.write(file.read());
+        Serial.write(c);
     }
-    file.close();
 }
 
-void writeFile(fs::FS &fs, const char *path, const char *message)
+void writeFile(FilesystemAdapter &fs, const char *path, const char *message)
 {
     Serial.printf("Writing file: %s\r\n", path);
 
-    File file = fs.open(path, FILE_WRITE);
+    std::unique_ptr<FileAdapter> file = fs.open(path, "w");
     if (!file)
     {
         Serial.println("- failed to open file for writing");
         return;
     }
-    if (file.print(message))
+    size_t len = strlen(message);
+    if (file->write((const uint8_t *)message, len) == len)
     {
         Serial.println("- file written");
     }
@@ -76,20 +58,20 @@ void writeFile(fs::FS &fs, const char *path, const char *message)
     {
         Serial.println("- write failed");
     }
-    file.close();
 }
 
-void appendFile(fs::FS &fs, const char *path, const char *message)
+void appendFile(FilesystemAdapter &fs, const char *path, const char *message)
 {
     Serial.printf("Appending to file: %s\r\n", path);
 
-    File file = fs.open(path, FILE_APPEND);
+    std::unique_ptr<FileAdapter> file = fs.open(path, "a");
     if (!file)
     {
         Serial.println("- failed to open file for appending");
         return;
     }
-    if (file.print(message))
+    size_t len = strlen(message);
+    if (file->write((const uint8_t *)message, len) == len)
     {
         Serial.println("- message appended");
     }
@@ -97,10 +79,9 @@ void appendFile(fs::FS &fs, const char *path, const char *message)
     {
         Serial.println("- append failed");
     }
-    file.close();
 }
 
-void renameFile(fs::FS &fs, const char *path1, const char *path2)
+void renameFile(FilesystemAdapter &fs, const char *path1, const char *path2)
 {
     Serial.printf("Renaming file %s to %s\r\n", path1, path2);
     if (fs.rename(path1, path2))
@@ -113,7 +94,7 @@ void renameFile(fs::FS &fs, const char *path1, const char *path2)
     }
 }
 
-void deleteFile(fs::FS &fs, const char *path)
+void deleteFile(FilesystemAdapter &fs, const char *path)
 {
     Serial.printf("Deleting file: %s\r\n", path);
     if (fs.remove(path))
@@ -126,13 +107,13 @@ void deleteFile(fs::FS &fs, const char *path)
     }
 }
 
-void testFileIO(fs::FS &fs, const char *path)
+void testFileIO(FilesystemAdapter &fs, const char *path)
 {
     Serial.printf("Testing file I/O with %s\r\n", path);
 
     static uint8_t buf[512];
     size_t len = 0;
-    File file = fs.open(path, FILE_WRITE);
+    std::unique_ptr<FileAdapter> file = fs.open(path, "w");
     if (!file)
     {
         Serial.println("- failed to open file for writing");
@@ -148,20 +129,19 @@ void testFileIO(fs::FS &fs, const char *path)
         {
             Serial.print(".");
         }
-        file.write(buf, 512);
+        file->write(buf, 512);
     }
     Serial.println("");
     uint32_t end = millis() - start;
     Serial.printf(" - %u bytes written in %u ms\r\n", 2048 * 512, end);
-    file.close();
+    file.reset();
 
-    file = fs.open(path);
+    file = fs.open(path, "r");
     start = millis();
     end = start;
     i = 0;
-    if (file && !file.isDirectory())
+    if (file && fs.stat(path, &len))
     {
-        len = file.size();
         size_t flen = len;
         start = millis();
         Serial.print("- reading");
@@ -172,7 +152,7 @@ void testFileIO(fs::FS &fs, const char *path)
             {
                 toRead = 512;
             }
-            file.read(buf, toRead);
+            file->read(buf, toRead);
             if ((i++ & 0x001F) == 0x001F)
             {
                 Serial.print(".");
@@ -182,7 +162,7 @@ void testFileIO(fs::FS &fs, const char *path)
         Serial.println("");
         end = millis() - start;
         Serial.printf("- %u bytes read in %u ms\r\n", flen, end);
-        file.close();
+        file.reset();
     }
     else
     {
@@ -2,7 +2,7 @@
 #define FILEMANAGE_H
 
 #include <WiFi.h>
-#include <FS.h>
+#include <ArduinoOcpp/Core/FilesystemAdapter.h>
 
 extern bool server_disconnected_file_management;
 namespace parth
@@ -22,10 +22,13 @@ namespace parth
 
 };
 extern struct tm timeinfo;
-void listDir(fs::FS *fs, const char *dirname, uint8_t levels);
-void readFile(fs::FS &fs, const char *path);
-void deleteFile(fs::FS &fs, const char *path);
-void writeFile(fs::FS &fs, const char *path, const char *message);
-void appendFile(fs::FS &fs, const char *path, const char *message);
+// the helpers operate on any backend (LittleFS / SPIFFS, POSIX or RAM), see FilesystemAdapter.h
+void listDir(ArduinoOcpp::FilesystemAdapter &fs);
+void readFile(ArduinoOcpp::FilesystemAdapter &fs, const char *path);
+void deleteFile(ArduinoOcpp::FilesystemAdapter &fs, const char *path);
+void writeFile(ArduinoOcpp::FilesystemAdapter &fs, const char *path, const char *message);
+void appendFile(ArduinoOcpp::FilesystemAdapter &fs, const char *path, const char *message);
+void renameFile(ArduinoOcpp::FilesystemAdapter &fs, const char *path1, const char *path2);
+void testFileIO(ArduinoOcpp::FilesystemAdapter &fs, const char *path);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,416 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Core/FilesystemAdapter.h>
+#include <ArduinoOcpp/Debug.h>
+
+#include <string.h>
+
+namespace ArduinoOcpp {
+
+/*
+ * RAM filesystem
+ */
+
+namespace RamFs {
+
+class RamFileAdapter : public FileAdapter {
+private:
+    std::shared_ptr<std::vector<uint8_t>> data;
+    size_t pos = 0;
+    bool writable;
+    RamFilesystemAdapter::Stats& stats;
+public:
+    RamFileAdapter(std::shared_ptr<std::vector<uint8_t>> data, size_t pos, bool writable, RamFilesystemAdapter::Stats& stats)
+            : data(data), pos(pos), writable(writable), stats(stats) { }
+
+    size_t read(uint8_t *buf, size_t len) {
+        if (pos >= data->size()) {
+            return 0;
+        }
+        if (len > data->size() - pos) {
+            len = data->size() - pos;
+        }
+        memcpy(buf, data->data() + pos, len);
+        pos += len;
+        stats.bytesRead += len;
+        return len;
+    }
+
+    int read() {
+        uint8_t c;
+        return read(&c, 1) == 1 ? (int) c : -1;
+    }
+
+    size_t write(const uint8_t *buf, size_t len) {
+        if (!writable) {
+            return 0;
+        }
+        if (pos + len > data->size()) {
+            data->resize(pos + len);
+        }
+        memcpy(data->data() + pos, buf, len);
+        pos += len;
+        stats.bytesWritten += len;
+        stats.writeCalls++;
+        return len;
+    }
+
+    bool seek(size_t offset) {
+        if (offset > data->size()) {
+            return false;
+        }
+        pos = offset;
+        return true;
+    }
+};
+
+} //end namespace RamFs
+
+bool RamFilesystemAdapter::stat(const char *path, size_t *size) {
+    auto file = files.find(path);
+    if (file == files.end()) {
+        return false;
+    }
+    if (size) {
+        *size = file->second->size();
+    }
+    return true;
+}
+
+bool RamFilesystemAdapter::remove(const char *path) {
+    stats.removes++;
+    return files.erase(path) > 0;
+}
+
+bool RamFilesystemAdapter::rename(const char *from, const char *to) {
+    auto file = files.find(from);
+    if (file == files.end()) {
+        return false;
+    }
+    auto data = file->second;
+    files.erase(file);
+    files[to] = data;
+    return true;
+}
+
+std::unique_ptr<FileAdapter> RamFilesystemAdapter::open(const char *path, const char *mode) {
+    auto file = files.find(path);
+
+    if (!strcmp(mode, "r")) {
+        if (file == files.end()) {
+            return nullptr;
+        }
+        return std::unique_ptr<FileAdapter>(new RamFs::RamFileAdapter(file->second, 0, false, stats));
+    } else if (!strcmp(mode, "w") || !strcmp(mode, "a")) {
+        stats.filesOpenedForWrite++;
+        std::shared_ptr<std::vector<uint8_t>> data;
+        if (file == files.end() || !strcmp(mode, "w")) {
+            data = std::make_shared<std::vector<uint8_t>>(); //truncate. Files which are still open keep the old content
+            files[path] = data;
+        } else {
+            data = file->second;
+        }
+        return std::unique_ptr<FileAdapter>(new RamFs::RamFileAdapter(data, data->size(), true, stats));
+    } else if (!strcmp(mode, "r+")) {
+        if (file == files.end()) {
+            return nullptr;
+        }
+        stats.filesOpenedForWrite++;
+        return std::unique_ptr<FileAdapter>(new RamFs::RamFileAdapter(file->second, 0, true, stats));
+    }
+
+    AO_DBG_ERR("Unsupported file mode %s", mode);
+    return nullptr;
+}
+
+void RamFilesystemAdapter::forEachFile(std::function<void(const char *path)> fn) {
+    for (auto file = files.begin(); file != files.end(); file++) {
+        fn(file->first.c_str());
+    }
+}
+
+} //end namespace ArduinoOcpp
+
+#if AO_USE_FILEAPI == ARDUINO_LITTLEFS || AO_USE_FILEAPI == ARDUINO_SPIFFS
+
+/*
+ * Arduino filesystem (LittleFS on the ESP32, SPIFFS on the ESP8266)
+ */
+
+#if AO_USE_FILEAPI == ARDUINO_LITTLEFS
+#include <LITTLEFS.h>
+#define USE_FS LITTLEFS
+#else
+#include <FS.h>
+#define USE_FS SPIFFS
+#endif
+
+namespace ArduinoOcpp {
+namespace EspArduino {
+
+class ArduinoFileAdapter : public FileAdapter {
+private:
+    File file;
+public:
+    ArduinoFileAdapter(File file) : file(file) { }
+
+    ~ArduinoFileAdapter() {
+        if (file) {
+            file.close();
+        }
+    }
+
+    size_t read(uint8_t *buf, size_t len) {
+        return file.read(buf, len);
+    }
+
+    int read() {
+        return file.read();
+    }
+
+    size_t write(const uint8_t *buf, size_t len) {
+        return file.write(buf, len);
+    }
+
+    bool seek(size_t offset) {
+        return file.seek(offset, SeekSet);
+    }
+};
+
+class ArduinoFilesystemAdapter : public FilesystemAdapter {
+public:
+    bool stat(const char *path, size_t *size) {
+        if (!USE_FS.exists(path)) {
+            return false;
+        }
+        if (size) {
+            File file = USE_FS.open(path, "r");
+            if (!file) {
+                return false;
+            }
+            *size = file.size();
+            file.close();
+        }
+        return true;
+    }
+
+    bool remove(const char *path) {
+        return USE_FS.remove(path);
+    }
+
+    bool rename(const char *from, const char *to) {
+        return USE_FS.rename(from, to);
+    }
+
+    std::unique_ptr<FileAdapter> open(const char *path, const char *mode) {
+        File file = USE_FS.open(path, mode);
+        if (!file) {
+            return nullptr;
+        }
+        return std::unique_ptr<FileAdapter>(new ArduinoFileAdapter(file));
+    }
+
+    void forEachFile(std::function<void(const char *path)> fn) {
+#if defined(ESP32)
+        File root = USE_FS.open("/");
+        if (!root || !root.isDirectory()) {
+            return;
+        }
+        File file = root.openNextFile();
+        while (file) {
+            if (!file.isDirectory()) {
+                fn(file.name());
+            }
+            file = root.openNextFile();
+        }
+#else
+        Dir dir = USE_FS.openDir("/");
+        while (dir.next()) {
+            fn(dir.fileName().c_str());
+        }
+#endif
+    }
+};
+
+} //end namespace EspArduino
+
+std::shared_ptr<FilesystemAdapter> makeDefaultFilesystemAdapter(FilesystemOpt config) {
+    if (!config.accessAllowed()) {
+        AO_DBG_DEBUG("Access to FS not allowed by config");
+        return nullptr;
+    }
+
+    if (config.mustMount()) { 
+#if AO_USE_FILEAPI == ARDUINO_LITTLEFS
+        if(!LITTLEFS.begin(config.formatOnFail())) {
+            AO_DBG_ERR("Error while mounting LITTLEFS");
+            return nullptr;
+        }
+#else
+        //ESP8266
+        SPIFFSConfig cfg;
+        cfg.setAutoFormat(config.formatOnFail());
+        SPIFFS.setConfig(cfg);
+
+        if (!SPIFFS.begin()) {
+            AO_DBG_ERR("Unable to initialize: unable to mount SPIFFS");
+            return nullptr;
+        }
+#endif
+    } //end fs mount
+
+    return std::make_shared<EspArduino::ArduinoFilesystemAdapter>();
+}
+
+} //end namespace ArduinoOcpp
+
+#elif AO_USE_FILEAPI == POSIX_FILEAPI
+
+/*
+ * POSIX filesystem (host builds)
+ */
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+namespace ArduinoOcpp {
+namespace Posix {
+
+class PosixFileAdapter : public FileAdapter {
+private:
+    FILE *file;
+public:
+    PosixFileAdapter(FILE *file) : file(file) { }
+
+    ~PosixFileAdapter() {
+        fclose(file);
+    }
+
+    size_t read(uint8_t *buf, size_t len) {
+        return fread(buf, 1, len, file);
+    }
+
+    int read() {
+        int c = fgetc(file);
+        return c == EOF ? -1 : c;
+    }
+
+    size_t write(const uint8_t *buf, size_t len) {
+        return fwrite(buf, 1, len, file);
+    }
+
+    bool seek(size_t offset) {
+        return fseek(file, (long) offset, SEEK_SET) == 0;
+    }
+};
+
+class PosixFilesystemAdapter : public FilesystemAdapter {
+private:
+    std::string basePath;
+
+    std::string fullPath(const char *path) {
+        std::string result = basePath;
+        if (path[0] != '/') {
+            result += '/';
+        }
+        result += path;
+        return result;
+    }
+public:
+    PosixFilesystemAdapter(const char *basePath) : basePath(basePath) { }
+
+    bool stat(const char *path, size_t *size) {
+        struct ::stat st;
+        if (::stat(fullPath(path).c_str(), &st)) {
+            return false;
+        }
+        if (size) {
+            *size = (size_t) st.st_size;
+        }
+        return true;
+    }
+
+    bool remove(const char *path) {
+        return ::remove(fullPath(path).c_str()) == 0;
+    }
+
+    bool rename(const char *from, const char *to) {
+        return ::rename(fullPath(from).c_str(), fullPath(to).c_str()) == 0;
+    }
+
+    std::unique_ptr<FileAdapter> open(const char *path, const char *mode) {
+        const char *posixMode = nullptr;
+        if (!strcmp(mode, "r")) {
+            posixMode = "rb";
+        } else if (!strcmp(mode, "w")) {
+            posixMode = "wb";
+        } else if (!strcmp(mode, "a")) {
+            posixMode = "ab";
+        } else if (!strcmp(mode, "r+")) {
+            posixMode = "rb+";
+        } else {
+            AO_DBG_ERR("Unsupported file mode %s", mode);
+            return nullptr;
+        }
+
+        FILE *file = fopen(fullPath(path).c_str(), posixMode);
+        if (!file) {
+            return nullptr;
+        }
+        return std::unique_ptr<FileAdapter>(new PosixFileAdapter(file));
+    }
+
+    void forEachFile(std::function<void(const char *path)> fn) {
+        DIR *dir = opendir(basePath.c_str());
+        if (!dir) {
+            return;
+        }
+        struct dirent *entry;
+        while ((entry = readdir(dir))) {
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            std::string path = "/";
+            path += entry->d_name;
+            fn(path.c_str());
+        }
+        closedir(dir);
+    }
+};
+
+} //end namespace Posix
+
+std::shared_ptr<FilesystemAdapter> makePosixFilesystemAdapter(const char *basePath) {
+    return std::make_shared<Posix::PosixFilesystemAdapter>(basePath);
+}
+
+std::shared_ptr<FilesystemAdapter> makeDefaultFilesystemAdapter(FilesystemOpt config) {
+    if (!config.accessAllowed()) {
+        AO_DBG_DEBUG("Access to FS not allowed by config");
+        return nullptr;
+    }
+
+    if (config.mustMount()) {
+        mkdir(AO_FILENAME_PREFIX, 0755); //fails silently if the directory exists already
+    }
+
+    return makePosixFilesystemAdapter(AO_FILENAME_PREFIX);
+}
+
+} //end namespace ArduinoOcpp
+
+#else //AO_USE_FILEAPI == DISABLE_FS
+
+namespace ArduinoOcpp {
+
+std::shared_ptr<FilesystemAdapter> makeDefaultFilesystemAdapter(FilesystemOpt config) {
+    AO_DBG_DEBUG("FS disabled at compile time");
+    return nullptr;
+}
+
+} //end namespace ArduinoOcpp
+
+#endif
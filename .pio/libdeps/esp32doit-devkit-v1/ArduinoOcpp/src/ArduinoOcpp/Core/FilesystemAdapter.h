@@ -0,0 +1,112 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef FILESYSTEMADAPTER_H
+#define FILESYSTEMADAPTER_H
+
+#include <ArduinoOcpp/Core/ConfigurationOptions.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Selection of the file API for makeDefaultFilesystemAdapter(). Defaults to LittleFS on the ESP32 and SPIFFS
+ * on the ESP8266. Set AO_USE_FILEAPI to POSIX_FILEAPI for host builds (Linux)
+ */
+#define ARDUINO_LITTLEFS 1
+#define ARDUINO_SPIFFS   2
+#define POSIX_FILEAPI    3
+#define DISABLE_FS       4
+
+#ifndef AO_USE_FILEAPI
+#if defined(AO_DEACTIVATE_FLASH)
+#define AO_USE_FILEAPI DISABLE_FS
+#elif defined(ESP32)
+#define AO_USE_FILEAPI ARDUINO_LITTLEFS
+#else
+#define AO_USE_FILEAPI ARDUINO_SPIFFS
+#endif
+#endif
+
+#ifndef AO_FILENAME_PREFIX
+#define AO_FILENAME_PREFIX "." //only used by the POSIX adapter: directory in which the files are stored
+#endif
+
+namespace ArduinoOcpp {
+
+/*
+ * An opened file. It is closed when the object is destroyed.
+ * Besides the pure virtual functions, it provides the reader and writer interface of ArduinoJson, i.e.
+ * serializeJson(doc, file) and deserializeJson(doc, file) can operate on it directly
+ */
+class FileAdapter {
+public:
+    virtual ~FileAdapter() = default;
+
+    virtual size_t read(uint8_t *buf, size_t len) = 0;
+    virtual int read() = 0; //returns the next byte or -1 at the end of the file
+    virtual size_t write(const uint8_t *buf, size_t len) = 0;
+    virtual bool seek(size_t offset) = 0; //absolute position from beginning of file
+
+    size_t readBytes(char *buf, size_t len) {return read((uint8_t*) buf, len);}
+    size_t write(uint8_t c) {return write(&c, 1);}
+};
+
+class FilesystemAdapter {
+public:
+    virtual ~FilesystemAdapter() = default;
+
+    virtual bool stat(const char *path, size_t *size = nullptr) = 0; //true if the file exists. Writes the file size to size if given
+    virtual bool remove(const char *path) = 0;
+    virtual bool rename(const char *from, const char *to) = 0;
+    virtual std::unique_ptr<FileAdapter> open(const char *path, const char *mode) = 0; //mode: "r", "w" (truncate), "a" (append) or "r+" (read and overwrite in place). nullptr on failure
+    virtual void forEachFile(std::function<void(const char *path)> fn) = 0; //all files in the root directory
+};
+
+/*
+ * Keeps all files in RAM and counts the accesses. Allows to run and wear-profile the persistence code on a host
+ * without flashing a board. Content is lost when the object is destroyed
+ */
+class RamFilesystemAdapter : public FilesystemAdapter {
+public:
+    struct Stats {
+        size_t bytesWritten = 0;
+        size_t writeCalls = 0;
+        size_t filesOpenedForWrite = 0; //each one corresponds to at least one erase + program cycle on a real flash
+        size_t bytesRead = 0;
+        size_t removes = 0;
+    };
+private:
+    std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+    Stats stats;
+public:
+    bool stat(const char *path, size_t *size = nullptr);
+    bool remove(const char *path);
+    bool rename(const char *from, const char *to);
+    std::unique_ptr<FileAdapter> open(const char *path, const char *mode);
+    void forEachFile(std::function<void(const char *path)> fn);
+
+    const Stats& getStats() {return stats;}
+    void resetStats() {stats = Stats();}
+};
+
+/*
+ * Returns the filesystem of the platform as selected by AO_USE_FILEAPI and mounts it if required by config.
+ * Returns nullptr if config prohibits the FS access or the FS is unavailable
+ */
+std::shared_ptr<FilesystemAdapter> makeDefaultFilesystemAdapter(FilesystemOpt config);
+
+#if AO_USE_FILEAPI == POSIX_FILEAPI
+//files are stored in the directory basePath. The directory must exist
+std::shared_ptr<FilesystemAdapter> makePosixFilesystemAdapter(const char *basePath = AO_FILENAME_PREFIX);
+#endif
+
+} //end namespace ArduinoOcpp
+
+#endif
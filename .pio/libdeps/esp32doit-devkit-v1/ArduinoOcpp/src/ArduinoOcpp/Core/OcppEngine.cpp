@@ -21,6 +21,8 @@ OcppEngine::~OcppEngine() {
 }
 
 void OcppEngine::loop() {
+    oModel->getOcppTime().updateSnapshot(); //one time for all tasks of this loop run
+
     oSock.loop();
     oConn.loop(oSock);
 
@@ -20,6 +20,7 @@
 
 #include <ArduinoJson.h>
 #include <memory>
+#include <string>
 
 namespace ArduinoOcpp {
 
@@ -53,6 +54,13 @@ public:
      */
     virtual std::unique_ptr<DynamicJsonDocument> createReq();
 
+    /**
+     * Optional alternative to createReq() for messages with large payloads: appends the payload as JSON directly to
+     * out, without building a JSON document first. Returns false if the message doesn't support this; then
+     * createReq() is used.
+     */
+    virtual bool serializeReq(std::string& out) {return false;}
+
 
     virtual void processConf(JsonObject payload);
     
@@ -100,34 +100,51 @@ boolean OcppOperation::sendReq(OcppSocket& ocppSocket){
         retry_interval_mult *= 2;
 
     /*
-     * Create the OCPP message
+     * Messages which can serialize themselves are written directly behind the OCPP-J Remote Procedure Call header
      */
-    auto requestPayload = ocppMessage->createReq();
-    if (!requestPayload) {
-        onAbortListener();
-        return true;
-    }
+    std::string out {};
+    out += "[";
+    out += std::to_string(MESSAGE_TYPE_CALL);
+    out += ",\"";
+    out += *getMessageID();
+    out += "\",\"";
+    out += ocppMessage->getOcppOperationType();
+    out += "\",";
+    if (ocppMessage->serializeReq(out)) {
+        out += "]";
+    } else {
+        out.clear();
 
-    /*
-     * Create OCPP-J Remote Procedure Call header
-     */
-    size_t json_buffsize = JSON_ARRAY_SIZE(4) + (getMessageID()->length() + 1) + requestPayload->capacity();
-    DynamicJsonDocument requestJson(json_buffsize);
+        /*
+         * Create the OCPP message
+         */
+        auto requestPayload = ocppMessage->createReq();
+        if (!requestPayload) {
+            onAbortListener();
+            return true;
+        }
+
+        /*
+         * Create OCPP-J Remote Procedure Call header
+         */
+        size_t json_buffsize = JSON_ARRAY_SIZE(4) + (getMessageID()->length() + 1) + requestPayload->capacity();
+        DynamicJsonDocument requestJson(json_buffsize);
+
+        requestJson.add(MESSAGE_TYPE_CALL);                    //MessageType
+        requestJson.add(*getMessageID());                      //Unique message ID
+        requestJson.add(ocppMessage->getOcppOperationType());  //Action
+        requestJson.add(*requestPayload);                      //Payload
 
-    requestJson.add(MESSAGE_TYPE_CALL);                    //MessageType
-    requestJson.add(*getMessageID());                      //Unique message ID
-    requestJson.add(ocppMessage->getOcppOperationType());  //Action
-    requestJson.add(*requestPayload);                      //Payload
+        serializeJson(requestJson, out);
+    }
 
     /*
-     * Serialize and send. Destroy serialization and JSON object. 
+     * Send. Destroy serialization.
      * 
      * If sending was successful, start timer
      * 
      * Return that this function must be called again (-> false)
      */
-    std::string out {};
-    serializeJson(requestJson, out);
 
     if (printReqCounter > 5000) {
         printReqCounter = 0;
@@ -4,6 +4,30 @@
 
 #include <ArduinoOcpp/Core/OcppTime.h>
 #include <ArduinoOcpp/Platform.h>
+#include <ArduinoOcpp/Debug.h>
+
+#include <string.h>
+
+#ifndef AO_CLOCK_STEP_THRESHOLD_MS
+#define AO_CLOCK_STEP_THRESHOLD_MS 10000 //larger errors are not slewed, but corrected at once
+#endif
+
+#ifndef AO_CLOCK_SLEW_DIVISOR
+#define AO_CLOCK_SLEW_DIVISOR 200 //slew at most 5ms per second
+#endif
+
+#ifndef AO_CLOCK_SYSTEM_TOLERANCE_MS
+#define AO_CLOCK_SYSTEM_TOLERANCE_MS 1000 //the system clock only has full seconds, so smaller lags are normal
+#endif
+
+#ifndef AO_TIME_SNAPSHOT_MAX_AGE_MS
+#define AO_TIME_SNAPSHOT_MAX_AGE_MS 100
+#endif
+
+#define AO_CLOCK_DRIFT_MIN_INTERVAL_MS (15UL * 60UL * 1000UL) //shorter intervals are dominated by network latency
+#define AO_CLOCK_DRIFT_MAX_PPM 1000
+
+#define AO_TIME_SCALAR_EPOCH_MS 1577836800000LL //2020-01-01T00:00:00Z. Scalars count seconds from here to stay far below INFINITY_THLD
 
 namespace ArduinoOcpp {
 
@@ -28,163 +52,267 @@ OcppClock DEFAULT_CLOCK = [] () {
 } //end namespace Clocks
 
 
+namespace Calendar {
+
+const int64_t SECONDS_PER_DAY = 24 * 3600;
+
+/*
+ * Days since 1970-01-01 of the given date in the Gregorian calendar. Month and day start at 1 here. Constant
+ * time, no loops over years or months (H. Hinnant's days_from_civil)
+ */
+int32_t daysFromCivil(int32_t y, int32_t m, int32_t d) {
+    y -= m <= 2;
+    const int32_t era = (y >= 0 ? y : y - 399) / 400;
+    const int32_t yoe = y - era * 400;                                   //[0, 399]
+    const int32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;  //[0, 365]
+    const int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;           //[0, 146096]
+    return era * 146097 + doe - 719468;
+}
+
+//inverse of daysFromCivil
+void civilFromDays(int32_t z, int32_t& y, int32_t& m, int32_t& d) {
+    z += 719468;
+    const int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const int32_t doe = z - era * 146097;
+    const int32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int32_t mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = yoe + era * 400 + (m <= 2);
+}
+
+int64_t toEpoch(int32_t year, int32_t month, int32_t day, int32_t hour, int32_t minute, int32_t second) {
+    year += month / 12;
+    month %= 12;
+    if (month < 0) {
+        month += 12;
+        year--;
+    }
+    return ((int64_t) daysFromCivil(year, month + 1, 1) + day) * SECONDS_PER_DAY
+            + (int64_t) hour * 3600 + (int64_t) minute * 60 + second;
+}
+
+} //end namespace Calendar
+
 OcppTimestamp::OcppTimestamp() {
     
 }
 
+OcppTimestamp::OcppTimestamp(int16_t year, int16_t month, int16_t day, int32_t hour, int32_t minute, int32_t second) :
+            epochMs(Calendar::toEpoch(year, month, day, hour, minute, second) * 1000) {
+
+}
+
 int noDays(int month, int year) {
     return (month == 0 || month == 2 || month == 4 || month == 6 || month == 7 || month == 9 || month == 11) ? 31 :
             ((month == 3 || month == 5 || month == 8 || month == 10) ? 30 :
             ((year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)) ? 29 : 28));
 }
 
+namespace Iso8601 {
+
+/*
+ * Format of the fixed part. 'd' stands for a decimal digit, all other characters must match exactly. The
+ * terminating 0 of a too short string never matches, so no strlen() is needed
+ */
+const char PATTERN [] = "dddd-dd-ddTdd:dd:dd";
+const size_t PATTERN_LENGTH = sizeof(PATTERN) - 1;
+
+inline bool isDigit(char c) {
+    return (unsigned char) (c - '0') <= 9;
+}
+
+inline int parse2(const char *s) {
+    return (s[0] - '0') * 10 + (s[1] - '0');
+}
+
+//"00" "01" ... "99"
+const char DIGIT_PAIRS [] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+inline void write2(char *out, int32_t val) {
+    memcpy(out, DIGIT_PAIRS + 2 * val, 2);
+}
+
+} //end namespace Iso8601
+
 bool OcppTimestamp::setTime(const char *jsonDateString) {
+    using namespace Iso8601;
 
-    const int JSONDATE_MINLENGTH = 19;
+    const char *s = jsonDateString;
 
-    if (strlen(jsonDateString) < JSONDATE_MINLENGTH){
-        return false;
+    bool formatOk = true;
+    for (size_t i = 0; i < PATTERN_LENGTH; i++) {
+        formatOk &= PATTERN[i] == 'd' ? isDigit(s[i]) : s[i] == PATTERN[i];
+        if (!s[i]) {
+            return false; //too short
+        }
     }
-
-    if (!isdigit(jsonDateString[0]) ||  //2
-        !isdigit(jsonDateString[1]) ||    //0
-        !isdigit(jsonDateString[2]) ||    //1
-        !isdigit(jsonDateString[3]) ||    //3
-        jsonDateString[4] != '-' ||       //-
-        !isdigit(jsonDateString[5]) ||    //0
-        !isdigit(jsonDateString[6]) ||    //2
-        jsonDateString[7] != '-' ||       //-
-        !isdigit(jsonDateString[8]) ||    //0
-        !isdigit(jsonDateString[9]) ||    //1
-        jsonDateString[10] != 'T' ||      //T
-        !isdigit(jsonDateString[11]) ||   //2
-        !isdigit(jsonDateString[12]) ||   //0
-        jsonDateString[13] != ':' ||      //:
-        !isdigit(jsonDateString[14]) ||   //5
-        !isdigit(jsonDateString[15]) ||   //3
-        jsonDateString[16] != ':' ||      //:
-        !isdigit(jsonDateString[17]) ||   //3
-        !isdigit(jsonDateString[18])) {   //2
-                                        //ignore subsequent characters
+    if (!formatOk) {
         return false;
     }
     
-    int year  =  (jsonDateString[0] - '0') * 1000 +
-                (jsonDateString[1] - '0') * 100 +
-                (jsonDateString[2] - '0') * 10 +
-                (jsonDateString[3] - '0');
-    int month =  (jsonDateString[5] - '0') * 10 +
-                (jsonDateString[6] - '0') - 1;
-    int day   =  (jsonDateString[8] - '0') * 10 +
-                (jsonDateString[9] - '0') - 1;
-    int hour  =  (jsonDateString[11] - '0') * 10 +
-                (jsonDateString[12] - '0');
-    int minute = (jsonDateString[14] - '0') * 10 +
-                (jsonDateString[15] - '0');
-    int second = (jsonDateString[17] - '0') * 10 +
-                (jsonDateString[18] - '0');
-    //ignore fractals
+    int year  = parse2(s) * 100 + parse2(s + 2);
+    int month = parse2(s + 5) - 1;
+    int day   = parse2(s + 8) - 1;
+    int hour  = parse2(s + 11);
+    int minute = parse2(s + 14);
+    int second = parse2(s + 17);
+
+    s += PATTERN_LENGTH;
+
+    //fraction: 1 or more digits, anything beyond milliseconds is ignored
+    int ms = 0;
+    if (*s == '.') {
+        s++;
+        if (!isDigit(*s)) {
+            return false;
+        }
+        int scale = 100;
+        for (; isDigit(*s); s++) {
+            ms += (*s - '0') * scale;
+            scale /= 10;
+        }
+    }
+
+    //time zone: Z, +hh:mm, -hh:mm, +hhmm, +hh or nothing (UTC)
+    int offsetMinutes = 0;
+    if (*s == 'Z' || *s == 'z') {
+        s++;
+    } else if (*s == '+' || *s == '-') {
+        int sign = *s == '-' ? -1 : 1;
+        s++;
+        if (!isDigit(s[0]) || !isDigit(s[1])) {
+            return false;
+        }
+        int offsetHours = parse2(s);
+        int offsetMins = 0;
+        s += 2;
+        if (*s == ':') {
+            s++;
+            if (!isDigit(s[0]) || !isDigit(s[1])) {
+                return false;
+            }
+        }
+        if (isDigit(s[0]) && isDigit(s[1])) {
+            offsetMins = parse2(s);
+            s += 2;
+        }
+        if (offsetHours >= 24 || offsetMins >= 60) {
+            return false;
+        }
+        offsetMinutes = sign * (offsetHours * 60 + offsetMins);
+    }
+
+    if (*s != '\0') {
+        return false; //trailing characters
+    }
 
     if (year < 1970 || year >= 2038 ||
         month < 0 || month >= 12 ||
         day < 0 || day >= noDays(month, year) ||
-        hour < 0 || hour >= 24 ||
-        minute < 0 || minute >= 60 ||
-        second < 0 || second > 60) { //tolerate leap seconds -- (23:59:60) can be a valid time
+        hour >= 24 ||
+        minute >= 60 ||
+        second > 60) { //tolerate leap seconds -- (23:59:60) can be a valid time
         return false;
     }
 
-    this->year = year;
-    this->month = month;
-    this->day = day;
-    this->hour = hour;
-    this->minute = minute;
-    this->second = second;
+    epochMs = (Calendar::toEpoch(year, month, day, hour, minute, second) - (int64_t) offsetMinutes * 60) * 1000 + ms;
     
     return true;
 }
 
+namespace JsonStringCache {
+
+/*
+ * Most timestamps of a loop run (MeterValues samples, StatusNotifications, transactions) fall into the same few
+ * seconds. Keep the formatted date and time of the last seconds and only append the milliseconds
+ */
+const size_t SIZE = 4; //power of 2
+const size_t PREFIX_LENGTH = 19; //"2020-10-01T20:53:32"
+
+struct Entry {
+    int64_t second = -1;
+    char prefix [PREFIX_LENGTH];
+};
+
+Entry entries [SIZE];
+
+} //end namespace JsonStringCache
+
 bool OcppTimestamp::toJsonString(char *jsonDateString, size_t buffsize) const {
     if (buffsize < JSONDATE_LENGTH + 1) return false;
 
-    jsonDateString[0] = ((char) ((year / 1000) % 10)) + '0';
-    jsonDateString[1] = ((char) ((year / 100) % 10)) + '0';
-    jsonDateString[2] = ((char) ((year / 10) % 10))  + '0';
-    jsonDateString[3] = ((char) ((year / 1) % 10))  + '0';
+    int64_t epochSecond = epochMs >= 0 ? epochMs / 1000 : -((-epochMs + 999) / 1000);
+    int32_t msOfSecond = (int32_t) (epochMs - epochSecond * 1000);
+
+    JsonStringCache::Entry& cached = JsonStringCache::entries[(size_t) epochSecond & (JsonStringCache::SIZE - 1)];
+    if (cached.second == epochSecond) {
+        memcpy(jsonDateString, cached.prefix, JsonStringCache::PREFIX_LENGTH);
+        jsonDateString[19] = '.';
+        jsonDateString[20] = (char) (msOfSecond / 100) + '0';
+        Iso8601::write2(jsonDateString + 21, msOfSecond % 100);
+        jsonDateString[23] = 'Z';
+        return true;
+    }
+
+    int64_t msPerDay = Calendar::SECONDS_PER_DAY * 1000;
+    int32_t days = (int32_t) (epochMs / msPerDay);
+    int32_t msOfDay = (int32_t) (epochMs % msPerDay);
+    if (msOfDay < 0) {
+        days--;
+        msOfDay += msPerDay;
+    }
+    int32_t secondOfDay = msOfDay / 1000;
+    int32_t ms = msOfDay % 1000;
+
+    int32_t year, month, day;
+    Calendar::civilFromDays(days, year, month, day);
+    month--; //to the internal convention: January is month 0, first day is day 0
+    day--;
+    int32_t hour = secondOfDay / 3600;
+    int32_t minute = (secondOfDay / 60) % 60;
+    int32_t second = secondOfDay % 60;
+
+    if (year < 0 || year > 9999) {
+        return false;
+    }
+
+    Iso8601::write2(jsonDateString, year / 100);
+    Iso8601::write2(jsonDateString + 2, year % 100);
     jsonDateString[4] = '-';
-    jsonDateString[5] = ((char) (((month + 1) / 10) % 10))  + '0';
-    jsonDateString[6] = ((char) (((month + 1) / 1) % 10))  + '0';
+    Iso8601::write2(jsonDateString + 5, month + 1);
     jsonDateString[7] = '-';
-    jsonDateString[8] = ((char) (((day + 1) / 10) % 10))  + '0';
-    jsonDateString[9] = ((char) (((day + 1) / 1) % 10))  + '0';
+    Iso8601::write2(jsonDateString + 8, day + 1);
     jsonDateString[10] = 'T';
-    jsonDateString[11] = ((char) ((hour / 10) % 10))  + '0';
-    jsonDateString[12] = ((char) ((hour / 1) % 10))  + '0';
+    Iso8601::write2(jsonDateString + 11, hour);
     jsonDateString[13] = ':';
-    jsonDateString[14] = ((char) ((minute / 10) % 10))  + '0';
-    jsonDateString[15] = ((char) ((minute / 1) % 10))  + '0';
+    Iso8601::write2(jsonDateString + 14, minute);
     jsonDateString[16] = ':';
-    jsonDateString[17] = ((char) ((second / 10) % 10))  + '0';
-    jsonDateString[18] = ((char) ((second / 1) % 10))  + '0';
+    Iso8601::write2(jsonDateString + 17, second);
     jsonDateString[19] = '.';
-    jsonDateString[20] = '0'; //ignore fractals
-    jsonDateString[21] = '0';
-    jsonDateString[22] = '0';
+    jsonDateString[20] = (char) (ms / 100) + '0';
+    Iso8601::write2(jsonDateString + 21, ms % 100);
     jsonDateString[23] = 'Z';
 
+    cached.second = epochSecond;
+    memcpy(cached.prefix, jsonDateString, JsonStringCache::PREFIX_LENGTH);
+
     return true;
 }
 
 OcppTimestamp &OcppTimestamp::operator+=(int secs) {
-
-    second += secs;
-
-    if (second >= 0 && second < 60) return *this;
-
-    minute += second / 60;
-    second %= 60;
-    if (second < 0) {
-        minute--;
-        second += 60;
-    }
-
-    if (minute >= 0 && minute < 60) return *this;
-
-    hour += minute / 60;
-    minute %= 60;
-    if (minute < 0) {
-        hour--;
-        minute += 60;
-    }
-
-    if (hour >= 0 && hour < 24) return *this;
-
-    day += hour / 24;
-    hour %= 24;
-    if (hour < 0) {
-        day--;
-        hour += 24;
-    }
-
-    while (day >= noDays(month, year)) {
-        day -= noDays(month, year);
-        month++;
-        
-        if (month >= 12) {
-            month -= 12;
-            year++;
-        }
-    }
-
-    while (day < 0) {
-        month--;
-        if (month < 0) {
-            month += 12;
-            year--;
-        }
-        day += noDays(month, year);
-    }
-
+    epochMs += (int64_t) secs * 1000;
     return *this;
 };
 
@@ -193,43 +321,12 @@ OcppTimestamp &OcppTimestamp::operator-=(int secs) {
 }
 
 otime_t OcppTimestamp::operator-(const OcppTimestamp &rhs) const {
-    //dt = rhs - ocpp_base
-    
-    int16_t year_base, year_end;
-    if (year <= rhs.year) {
-        year_base = year;
-        year_end = rhs.year;
-    } else {
-        year_base = rhs.year;
-        year_end = year;
-    }
-
-    int16_t lhsDays = day;
-    int16_t rhsDays = rhs.day;
-
-    for (int16_t iy = year_base; iy <= year_end; iy++) {
-        for (int16_t im = 0; im < 12; im++) {
-            if (year > iy || (year == iy && month > im)) {
-                lhsDays += noDays(im, iy);
-            }
-            if (rhs.year > iy || (rhs.year == iy && rhs.month > im)) {
-                rhsDays += noDays(im, iy);
-            }
-        }
-    }
-
-    otime_t dt = (lhsDays - rhsDays) * (24 * 3600) + (hour - rhs.hour) * 3600 + (minute - rhs.minute) * 60 + second - rhs.second;
-    return dt;
+    int64_t dt = epochMs - rhs.epochMs;
+    return (otime_t) (dt >= 0 ? dt / 1000 : -((-dt + 999) / 1000));
 }
 
 OcppTimestamp &OcppTimestamp::operator=(const OcppTimestamp &rhs) {
-    year = rhs.year;
-    month = rhs.month;
-    day = rhs.day;
-    hour = rhs.hour;
-    minute = rhs.minute;
-    second = rhs.second;
-
+    epochMs = rhs.epochMs;
     return *this;
 }
 
@@ -244,31 +341,19 @@ OcppTimestamp operator-(const OcppTimestamp &lhs, int secs) {
 }
 
 bool operator==(const OcppTimestamp &lhs, const OcppTimestamp &rhs) {
-    return lhs.year == rhs.year && lhs.month == rhs.month && lhs.day == rhs.day && lhs.hour == rhs.hour && lhs.minute == rhs.minute && lhs.second == rhs.second;
+    return lhs.epochMs == rhs.epochMs;
 }
 
 bool operator!=(const OcppTimestamp &lhs, const OcppTimestamp &rhs) {
-    return !(lhs == rhs);
+    return lhs.epochMs != rhs.epochMs;
 }
 
 bool operator<(const OcppTimestamp &lhs, const OcppTimestamp &rhs) {
-    if (lhs.year != rhs.year)
-        return lhs.year < rhs.year;
-    if (lhs.month != rhs.month)
-        return lhs.month < rhs.month;
-    if (lhs.day != rhs.day)
-        return lhs.day < rhs.day;
-    if (lhs.hour != rhs.hour)
-        return lhs.hour < rhs.hour;
-    if (lhs.minute != rhs.minute)
-        return lhs.minute < rhs.minute;
-    if (lhs.second != rhs.second)
-        return lhs.second < rhs.second;
-    return false;  
+    return lhs.epochMs < rhs.epochMs;
 }
 
 bool operator<=(const OcppTimestamp &lhs, const OcppTimestamp &rhs) {
-    return lhs < rhs || lhs == rhs;
+    return lhs.epochMs <= rhs.epochMs;
 }
 
 bool operator>(const OcppTimestamp &lhs, const OcppTimestamp &rhs) {
@@ -281,7 +366,51 @@ bool operator>=(const OcppTimestamp &lhs, const OcppTimestamp &rhs) {
 
 
 OcppTime::OcppTime(const OcppClock& system_clock) : system_clock(system_clock) {
+    lastTickReading = ao_tick_ms();
+    if (this->system_clock) {
+        systemClockBase = this->system_clock();
+    }
+}
+
+uint64_t OcppTime::readTickMs() {
+    unsigned long tick = ao_tick_ms();
+    tickMs += (unsigned long) (tick - lastTickReading); //tolerates overflows of ao_tick_ms()
+    lastTickReading = tick;
+
+    if (system_clock) {
+        //catch up if ao_tick_ms() has fallen behind the system clock, e.g. because it stopped during a sleep mode
+        int64_t lagMs = (int64_t) (system_clock() - systemClockBase) * 1000 - (int64_t) tickMs;
+        if (lagMs > AO_CLOCK_SYSTEM_TOLERANCE_MS) {
+            tickMs += (uint64_t) (lagMs - AO_CLOCK_SYSTEM_TOLERANCE_MS);
+        }
+    }
+
+    return tickMs;
+}
+
+int64_t OcppTime::toOcppMs(uint64_t tick) {
+    int64_t dt = (int64_t) (tick - baseTickMs);
+    int64_t t = baseOcppMs + dt + dt * driftPpm / 1000000;
+
+    int64_t maxSlew = dt / AO_CLOCK_SLEW_DIVISOR;
+    if (slewMs > maxSlew) {
+        t += maxSlew;
+    } else if (slewMs < -maxSlew) {
+        t -= maxSlew;
+    } else {
+        t += slewMs;
+    }
+    return t;
+}
+
+void OcppTime::stepTo(int64_t ocppMs, uint64_t tick) {
+    baseOcppMs = ocppMs;
+    baseTickMs = tick;
+    slewMs = 0;
 
+    hasSyncReference = true;
+    syncReferenceOcppMs = ocppMs;
+    syncReferenceTickMs = tick;
 }
 
 bool OcppTime::setOcppTime(const char* jsonDateString) {
@@ -292,37 +421,82 @@ bool OcppTime::setOcppTime(const char* jsonDateString) {
         return false;
     }
 
-    system_basetime = system_clock();
-    ocpp_basetime = timestamp;
+    uint64_t tick = readTickMs();
+    int64_t serverMs = timestamp.getEpochMs();
+
+    if (!ocppTimeIsSet) {
+        stepTo(serverMs, tick);
+    } else {
+        int64_t predictedMs = toOcppMs(tick);
+        int64_t error = serverMs - predictedMs;
+
+        if (error > AO_CLOCK_STEP_THRESHOLD_MS || error < -AO_CLOCK_STEP_THRESHOLD_MS) {
+            AO_DBG_INFO("Clock off by %lld ms, set to server time", (long long) error);
+            stepTo(serverMs, tick);
+        } else {
+            //estimate drift over a long enough interval so that the network latency doesn't matter
+            if (hasSyncReference && tick - syncReferenceTickMs >= AO_CLOCK_DRIFT_MIN_INTERVAL_MS) {
+                int64_t dLocal = (int64_t) (tick - syncReferenceTickMs);
+                int64_t dServer = serverMs - syncReferenceOcppMs;
+                int64_t measuredPpm = (dServer - dLocal) * 1000000 / dLocal;
+                if (measuredPpm > AO_CLOCK_DRIFT_MAX_PPM) {
+                    measuredPpm = AO_CLOCK_DRIFT_MAX_PPM;
+                } else if (measuredPpm < -AO_CLOCK_DRIFT_MAX_PPM) {
+                    measuredPpm = -AO_CLOCK_DRIFT_MAX_PPM;
+                }
+                driftPpm += (int32_t) ((measuredPpm - driftPpm) / 4); //low-pass over several syncs
+
+                syncReferenceOcppMs = serverMs;
+                syncReferenceTickMs = tick;
+                AO_DBG_DEBUG("Clock drift estimation: %ld ppm", (long) driftPpm);
+            }
+
+            //continue from the current prediction without jump and blend in the error
+            baseOcppMs = predictedMs;
+            baseTickMs = tick;
+            slewMs = error;
+        }
+    }
+
     ocppTimeIsSet = true;
 
-    currentTime = ocpp_basetime;
-    previousUpdate = system_basetime;
+    currentTime.setEpochMs(toOcppMs(tick));
+    snapshotTickMs = tick;
+    snapshotValid = true;
 
     return true;
 }
 
 otime_t OcppTime::getOcppTimeScalar() {
-    return system_clock();
+    return toOcppTimeScalar(getOcppTimestampNow());
+}
+
+void OcppTime::updateSnapshot() {
+    snapshotTickMs = readTickMs();
+    currentTime.setEpochMs(toOcppMs(snapshotTickMs)); //before the first sync, this counts from UNIX-time 0
+    snapshotValid = true;
 }
 
 const OcppTimestamp &OcppTime::getOcppTimestampNow() {
-    otime_t tNow = system_clock();
-    if (previousUpdate != tNow) {
-        currentTime += (tNow - previousUpdate);
-        previousUpdate = tNow;
+    if (!snapshotValid || readTickMs() - snapshotTickMs > AO_TIME_SNAPSHOT_MAX_AGE_MS) {
+        updateSnapshot();
     }
     return currentTime;
 }
 
 OcppTimestamp OcppTime::createTimestamp(otime_t scalar) {
-    OcppTimestamp res = ocpp_basetime + (scalar - system_basetime);
+    OcppTimestamp res = OcppTimestamp();
+    res.setEpochMs(AO_TIME_SCALAR_EPOCH_MS + (int64_t) scalar * 1000);
 
     return res;
 }
 
 otime_t OcppTime::toOcppTimeScalar(const OcppTimestamp &otimestamp) {
-    return otimestamp.operator-(ocpp_basetime);
+    int64_t ms = otimestamp.getEpochMs() - AO_TIME_SCALAR_EPOCH_MS;
+    if (ms < 0) {
+        return (otime_t) -((-ms + 999) / 1000); //round down, so that a scalar never lies after its timestamp
+    }
+    return (otime_t) (ms / 1000);
 }
 
 }
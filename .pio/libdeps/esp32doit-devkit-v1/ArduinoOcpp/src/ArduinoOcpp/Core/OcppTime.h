@@ -6,6 +6,7 @@
 #define OCPPTIME_H
 
 #include <functional>
+#include <stdint.h>
 
 namespace ArduinoOcpp {
 
@@ -27,22 +28,20 @@ extern OcppClock DEFAULT_CLOCK;
 class OcppTimestamp {
 private:
     /*
-     * Internal representation of the current time. The initial values correspond to UNIX-time 0. January
-     * corresponds to month 0 and the first day in the month is day 0.
+     * Internal representation of the current time: milliseconds since UNIX-time 0. Arithmetic and comparisons
+     * are plain integer operations; the calendar fields are only computed for parsing and formatting.
      */
-    int16_t year = 1970;
-    int16_t month = 0;
-    int16_t day = 0;
-    int32_t hour = 0;
-    int32_t minute = 0;
-    int32_t second = 0;
+    int64_t epochMs = 0;
 
 public:
 
     OcppTimestamp();
 
-    OcppTimestamp(int16_t year, int16_t month, int16_t day, int32_t hour, int32_t minute, int32_t second) :
-                year(year), month(month), day(day), hour(hour), minute(minute), second(second) { };
+    /*
+     * January corresponds to month 0 and the first day in the month is day 0. Fields exceeding their range
+     * are carried over (e.g. hour = 24 is the next day)
+     */
+    OcppTimestamp(int16_t year, int16_t month, int16_t day, int32_t hour, int32_t minute, int32_t second);
 
     /**
      * Expects a date string like
@@ -50,7 +49,8 @@ public:
      * 
      * as generated in JavaScript by calling toJSON() on a Date object
      * 
-     * Only processes the first 19 characters. The subsequent are ignored until terminating 0.
+     * Also accepts any number of fractional digits (only milliseconds are kept), time zone offsets like
+     * +02:00, -0530 or +01 instead of Z, or no zone designator at all (UTC). Trailing characters are rejected.
      * 
      * Has a semi-sophisticated type check included. Will return true on successful time set and false if
      * the given string is not a JSON Date string.
@@ -59,14 +59,18 @@ public:
      */
     bool setTime(const char* jsonDateString);
 
-    bool toJsonString(char *out, size_t buffsize) const;
+    bool toJsonString(char *out, size_t buffsize) const; //writes millisecond precision, e.g. 2020-10-01T20:53:32.486Z
+
+    int64_t getEpochMs() const {return epochMs;}
+    void setEpochMs(int64_t ms) {epochMs = ms;}
+    OcppTimestamp &addMilliseconds(int64_t ms) {epochMs += ms; return *this;}
 
     OcppTimestamp &operator=(const OcppTimestamp &rhs);
 
     OcppTimestamp &operator+=(int secs);
     OcppTimestamp &operator-=(int secs);
 
-    otime_t operator-(const OcppTimestamp &rhs) const;
+    otime_t operator-(const OcppTimestamp &rhs) const; //difference in full seconds (rounded down)
 
     friend OcppTimestamp operator+(const OcppTimestamp &lhs, int secs);
     friend OcppTimestamp operator-(const OcppTimestamp &lhs, int secs);
@@ -82,24 +86,61 @@ public:
 extern const OcppTimestamp MIN_TIME;
 extern const OcppTimestamp MAX_TIME;
 
+/*
+ * Keeps the OCPP server time with millisecond resolution.
+ *
+ * The timestamps are derived from ao_tick_ms(). Each server time (BootNotification and Heartbeat) disciplines the
+ * clock: the first one sets it, later ones are compared with the local prediction. Small errors are slewed out
+ * (the clock runs at most 1/AO_CLOCK_SLEW_DIVISOR faster or slower, it never jumps back) and the long-term rate
+ * difference between the local oscillator and the server is estimated in ppm and compensated. Errors above
+ * AO_CLOCK_STEP_THRESHOLD_MS are corrected by setting the clock directly.
+ *
+ * The scalar API (seconds) runs on the same disciplined clock. The OcppClock which is passed to the constructor
+ * (system clock in seconds) is the long-term time base: ao_tick_ms() provides the milliseconds between its seconds,
+ * and if ao_tick_ms() falls behind the system clock by more than AO_CLOCK_SYSTEM_TOLERANCE_MS (e.g. because it
+ * stops in a sleep mode), the OCPP time catches up with the system clock. It never goes back.
+ */
 class OcppTime {
 private:
 
-    OcppTimestamp ocpp_basetime = OcppTimestamp();
-    otime_t system_basetime = 0; //your system clock's time at the moment when the OCPP server's time was taken
     bool ocppTimeIsSet = false;
 
-    OcppClock system_clock = [] () {return (otime_t) 0;};
+    OcppTimestamp currentTime = OcppTimestamp(); //snapshot, see updateSnapshot()
+    uint64_t snapshotTickMs = 0;
+    bool snapshotValid = false;
+
+    uint64_t tickMs = 0; //ao_tick_ms() extended to 64 bit, caught up with the system clock
+    unsigned long lastTickReading = 0;
+
+    OcppClock system_clock;
+    otime_t systemClockBase = 0; //system clock at tickMs = 0
 
-    OcppTimestamp currentTime = OcppTimestamp();
-    otime_t previousUpdate = -1;
+    int64_t baseOcppMs = 0; //server time at baseTickMs
+    uint64_t baseTickMs = 0;
+    int64_t slewMs = 0; //error at baseTickMs which is still to be blended in
+    int32_t driftPpm = 0; //estimated rate difference server - local oscillator
+
+    bool hasSyncReference = false;
+    int64_t syncReferenceOcppMs = 0; //server time and local time of an earlier sync for the drift estimation
+    uint64_t syncReferenceTickMs = 0;
+
+    uint64_t readTickMs();
+    int64_t toOcppMs(uint64_t tick);
+    void stepTo(int64_t ocppMs, uint64_t tick);
 
 public:
 
     OcppTime(const OcppClock& system_clock);
     //OcppTime(const OcppTime& ocppTime) = default;
 
-    otime_t getOcppTimeScalar(); //returns current time of the OCPP server in non-UNIX but signed integer format. t2 - t1 is the time difference in seconds. 
+    otime_t getOcppTimeScalar(); //returns current time of the OCPP server in non-UNIX but signed integer format. t2 - t1 is the time difference in seconds. Same time base as getOcppTimestampNow()
+
+    /*
+     * Takes the time snapshot which getOcppTimestampNow() returns. Called once at the beginning of each OcppEngine
+     * loop, so that all services of one loop run see the same time. If the snapshot gets older than
+     * AO_TIME_SNAPSHOT_MAX_AGE_MS (e.g. calls from outside the loop), getOcppTimestampNow() refreshes it
+     */
+    void updateSnapshot();
     const OcppTimestamp &getOcppTimestampNow();
     OcppTimestamp createTimestamp(otime_t scalar); //creates a timestamp in a JSON-serializable format. createTimestamp(getOcppTimeScalar()) will return the current OCPP time
     otime_t toOcppTimeScalar(const OcppTimestamp &otimestamp);
@@ -110,7 +151,7 @@ public:
      * 
      * as generated in JavaScript by calling toJSON() on a Date object
      * 
-     * Only processes the first 19 characters. The subsequent are ignored until terminating 0.
+     * Synchronizes the clock with the given server time (see class description).
      * 
      * Has a semi-sophisticated type check included. Will return true on successful time set and false if
      * the given string is not a JSON Date string.
@@ -120,6 +161,8 @@ public:
     bool setOcppTime(const char* jsonDateString);
 
     bool isValid() {return ocppTimeIsSet;}
+
+    int32_t getDriftPpm() {return driftPpm;}
 };
 
 }
@@ -0,0 +1,86 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Core/StandardConfiguration.h>
+#include <ArduinoOcpp/Core/Configuration.h>
+#include <ArduinoOcpp/Debug.h>
+
+#include <string.h>
+#include <new>
+
+namespace ArduinoOcpp {
+
+namespace StandardConfigurationRegistry {
+
+constexpr size_t INT_KEYS_COUNT = (size_t) StandardIntKey::COUNT;
+
+//order must match StandardIntKey
+constexpr StandardKey<int> INT_KEYS [INT_KEYS_COUNT] = {
+    //key                               default filename                remoteW remoteR localW  reboot
+    {"HeartbeatInterval",               86400,  CONFIGURATION_FN,       true,   true,   true,   false},
+    {"ConnectionTimeOut",               30,     CONFIGURATION_FN,       true,   true,   true,   false},
+    {"MeterValueSampleInterval",        60,     CONFIGURATION_FN,       true,   true,   true,   false},
+    {"MeterValuesSampledDataMaxLength", 4,      CONFIGURATION_VOLATILE, false,  true,   false,  false},
+    {"ClockAlignedDataInterval",        0,      CONFIGURATION_FN,       true,   true,   true,   false},
+};
+
+Configuration<int> intConfigurations [INT_KEYS_COUNT];
+std::shared_ptr<Configuration<int>> intConfigurationHandles [INT_KEYS_COUNT];
+
+void noDelete(Configuration<int>*) { } //objects are in static storage
+
+bool bind(size_t index) {
+    if (intConfigurationHandles[index]) {
+        return false; //already bound
+    }
+    if (!intConfigurations[index].setStaticKey(INT_KEYS[index].key)) {
+        AO_DBG_ERR("Cannot bind %s", INT_KEYS[index].key);
+        return false;
+    }
+    intConfigurationHandles[index] = std::shared_ptr<Configuration<int>>(&intConfigurations[index], noDelete);
+    return true;
+}
+
+} //end namespace StandardConfigurationRegistry
+
+const StandardKey<int> &getStandardKey(StandardIntKey key) {
+    return StandardConfigurationRegistry::INT_KEYS[(size_t) key];
+}
+
+std::shared_ptr<Configuration<int>> getStandardConfiguration(StandardIntKey key) {
+    using namespace StandardConfigurationRegistry;
+    size_t index = (size_t) key;
+    bind(index);
+    return intConfigurationHandles[index];
+}
+
+template <>
+std::shared_ptr<Configuration<int>> findStandardConfiguration<int>(const char *key, const char *filename) {
+    using namespace StandardConfigurationRegistry;
+    for (size_t i = 0; i < INT_KEYS_COUNT; i++) {
+        if (!strcmp(INT_KEYS[i].key, key) && !strcmp(INT_KEYS[i].filename, filename)) {
+            if (bind(i)) {
+                return intConfigurationHandles[i];
+            } else {
+                return nullptr;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void resetStandardConfigurations() {
+    using namespace StandardConfigurationRegistry;
+    for (size_t i = 0; i < INT_KEYS_COUNT; i++) {
+        if (!intConfigurationHandles[i]) {
+            continue; //never bound
+        }
+        intConfigurationHandles[i].reset();
+        //the key, the permissions and the value must be set again by the next bind()
+        intConfigurations[i].~Configuration<int>();
+        new (&intConfigurations[i]) Configuration<int>();
+    }
+}
+
+} //end namespace ArduinoOcpp
@@ -0,0 +1,64 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef STANDARDCONFIGURATION_H
+#define STANDARDCONFIGURATION_H
+
+#include <ArduinoOcpp/Core/ConfigurationKeyValue.h>
+
+#include <memory>
+
+namespace ArduinoOcpp {
+
+/*
+ * Registry of the standard OCPP 1.6 configuration keys which are used by the library itself. Their keys, defaults
+ * and access flags are fixed at compile time and their Configuration objects live in static storage. Services get
+ * a raw pointer via declareConfiguration(StandardIntKey) (see Configuration.h) and read the value without
+ * refcounting or key lookup.
+ *
+ * Keys which are not listed here (vendor keys, keys declared by the host application) are declared with the
+ * string-based declareConfiguration<T>() as before. Both ways can be mixed for the same key.
+ */
+
+enum class StandardIntKey : uint8_t {
+    HeartbeatInterval,
+    ConnectionTimeOut,
+    MeterValueSampleInterval,
+    MeterValuesSampledDataMaxLength,
+    ClockAlignedDataInterval,
+    COUNT
+};
+
+template <class T>
+struct StandardKey {
+    const char *key;
+    T defaultValue;
+    const char *filename;
+    bool remotePeerCanWrite;
+    bool remotePeerCanRead;
+    bool localClientCanWrite;
+    bool rebootRequiredWhenChanged;
+};
+
+const StandardKey<int> &getStandardKey(StandardIntKey key);
+
+//returns the statically allocated Configuration of key. The returned shared_ptr does not own the object
+std::shared_ptr<Configuration<int>> getStandardConfiguration(StandardIntKey key);
+
+//for container implementations: returns the static Configuration if (key, filename) belongs to a standard key
+//whose static object is not in use yet. Returns nullptr otherwise
+template <class T>
+std::shared_ptr<Configuration<T>> findStandardConfiguration(const char *key, const char *filename) {
+    return nullptr;
+}
+
+template <>
+std::shared_ptr<Configuration<int>> findStandardConfiguration<int>(const char *key, const char *filename);
+
+//resets the static Configurations to their unbound state. Only call after the containers have released them
+void resetStandardConfigurations();
+
+} //end namespace ArduinoOcpp
+
+#endif
@@ -81,7 +81,7 @@ void BootNotification::processConf(JsonObject payload){
 
     //only write if in valid range
     if (interval >= 1) {
-        std::shared_ptr<Configuration<int>> intervalConf = declareConfiguration<int>("HeartbeatInterval", 86400);
+        Configuration<int> *intervalConf = declareConfiguration(StandardIntKey::HeartbeatInterval);
         if (intervalConf && interval != *intervalConf) {
             *intervalConf = interval;
             configuration_save();
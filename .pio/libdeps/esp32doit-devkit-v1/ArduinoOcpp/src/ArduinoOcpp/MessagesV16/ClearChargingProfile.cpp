@@ -31,7 +31,9 @@ void ClearChargingProfile::processReq(JsonObject payload) {
         }
 
         if (payload.containsKey("connectorId")) {
-            AO_DBG_WARN("Smart Charging does not implement multiple connectors yet. Ignore connectorId");
+            if (connectorId != (payload["connectorId"] | -1)) {
+                return false;
+            }
         }
 
         if (payload.containsKey("chargingProfilePurpose")) {
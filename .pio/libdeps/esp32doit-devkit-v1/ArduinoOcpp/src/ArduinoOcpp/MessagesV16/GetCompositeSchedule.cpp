@@ -0,0 +1,70 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/MessagesV16/GetCompositeSchedule.h>
+#include <ArduinoOcpp/Core/OcppModel.h>
+#include <ArduinoOcpp/Tasks/SmartCharging/SmartChargingService.h>
+#include <ArduinoOcpp/Tasks/ChargePointStatus/ChargePointStatusService.h>
+#include <ArduinoOcpp/Debug.h>
+
+using ArduinoOcpp::Ocpp16::GetCompositeSchedule;
+
+GetCompositeSchedule::GetCompositeSchedule() {
+
+}
+
+const char* GetCompositeSchedule::getOcppOperationType(){
+    return "GetCompositeSchedule";
+}
+
+void GetCompositeSchedule::processReq(JsonObject payload) {
+
+    connectorId = payload["connectorId"] | -1;
+    int duration = payload["duration"] | -1;
+
+    if (connectorId < 0 || duration < 0) {
+        errorCode = "FormationViolation";
+        return;
+    }
+
+    ChargingRateUnitType unit = ChargingRateUnitType::Watt;
+    const char *unitStr = payload["chargingRateUnit"] | "W";
+    if (unitStr[0] == 'A' || unitStr[0] == 'a') {
+        unit = ChargingRateUnitType::Amp;
+    }
+
+    if (!ocppModel || !ocppModel->getSmartChargingService()) {
+        AO_DBG_ERR("SmartChargingService not initialized! Reject request");
+        return;
+    }
+
+    if (ocppModel->getChargePointStatusService() &&
+            connectorId >= ocppModel->getChargePointStatusService()->getNumConnectors()) {
+        AO_DBG_WARN("connectorId out of bounds. Reject request");
+        return;
+    }
+
+    schedule = std::unique_ptr<ChargingSchedule>(
+            ocppModel->getSmartChargingService()->getCompositeSchedule(connectorId, (otime_t) duration, unit));
+}
+
+std::unique_ptr<DynamicJsonDocument> GetCompositeSchedule::createConf(){
+    if (!schedule) {
+        auto doc = std::unique_ptr<DynamicJsonDocument>(new DynamicJsonDocument(JSON_OBJECT_SIZE(1)));
+        JsonObject payload = doc->to<JsonObject>();
+        payload["status"] = "Rejected";
+        return doc;
+    }
+
+    auto scheduleDoc = std::unique_ptr<DynamicJsonDocument>(schedule->toJsonDocument());
+
+    auto doc = std::unique_ptr<DynamicJsonDocument>(new DynamicJsonDocument(
+            JSON_OBJECT_SIZE(4) + (JSONDATE_LENGTH + 1) + scheduleDoc->capacity()));
+    JsonObject payload = doc->to<JsonObject>();
+    payload["status"] = "Accepted";
+    payload["connectorId"] = connectorId;
+    payload["scheduleStart"] = (*scheduleDoc)["startSchedule"];
+    payload["chargingSchedule"] = *scheduleDoc;
+    return doc;
+}
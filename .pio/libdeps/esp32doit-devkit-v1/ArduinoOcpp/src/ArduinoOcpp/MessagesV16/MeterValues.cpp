@@ -7,21 +7,104 @@
 #include <ArduinoOcpp/Tasks/ChargePointStatus/ChargePointStatusService.h>
 #include <ArduinoOcpp/Debug.h>
 
+#include <vector>
+#include <math.h>
+
 using ArduinoOcpp::Ocpp16::MeterValues;
 
+namespace ArduinoOcpp {
+namespace Ocpp16 {
+namespace MeterValuesSerializer {
+
+const int VALUE_SIGNIFICANT_DIGITS = 7; //precision of float. The integer part is never rounded
+
+/*
+ * Appends value in plain decimal notation without trailing zeros, e.g. 1234.5 -> "1234.5", 7.0 -> "7". Uses integer
+ * arithmetic only; very large and very small values fall back to snprintf
+ */
+void appendDecimal(std::string& out, float value_f) {
+    double value = value_f;
+    double magnitude = value < 0. ? -value : value;
+    if (!(magnitude < 1e15) || (magnitude > 0. && magnitude < 1e-3)) { //also catches NaN
+        char buf [24] = {'\0'};
+        snprintf(buf, sizeof(buf), "%.*g", VALUE_SIGNIFICANT_DIGITS, value);
+        out += buf;
+        return;
+    }
+
+    int intDigits = 1;
+    for (double bound = 10.; bound <= magnitude; bound *= 10.) {
+        intDigits++;
+    }
+    int fracDigits = intDigits < VALUE_SIGNIFICANT_DIGITS ? VALUE_SIGNIFICANT_DIGITS - intDigits : 0;
+    uint64_t scale = 1;
+    for (int i = 0; i < fracDigits; i++) {
+        scale *= 10;
+    }
+
+    uint64_t scaled = (uint64_t) (magnitude * (double) scale + 0.5);
+    uint64_t intPart = scaled / scale;
+    uint64_t fracPart = scaled % scale;
+    while (fracDigits > 0 && fracPart % 10 == 0) {
+        fracPart /= 10;
+        fracDigits--;
+    }
+
+    char buf [24]; //filled from the end
+    char *p = buf + sizeof(buf);
+    for (int i = 0; i < fracDigits; i++) {
+        *--p = '0' + (char) (fracPart % 10);
+        fracPart /= 10;
+    }
+    if (fracDigits > 0) {
+        *--p = '.';
+    }
+    do {
+        *--p = '0' + (char) (intPart % 10);
+        intPart /= 10;
+    } while (intPart > 0);
+    if (value < 0. && scaled > 0) {
+        *--p = '-';
+    }
+    out.append(p, buf + sizeof(buf) - p);
+}
+
+void appendString(std::string& out, const char *str) {
+    out += '"';
+    for (const char *c = str; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+            out += *c;
+        } else if ((unsigned char) *c < 0x20) {
+            char esc [7];
+            snprintf(esc, sizeof(esc), "\\u%04x", (unsigned char) *c);
+            out += esc;
+        } else {
+            out += *c;
+        }
+    }
+    out += '"';
+}
+
+void appendMember(std::string& out, const char *key, const char *value) {
+    out += ",\"";
+    out += key;
+    out += "\":";
+    appendString(out, value);
+}
+
+} //end namespace MeterValuesSerializer
+} //end namespace Ocpp16
+} //end namespace ArduinoOcpp
+
 //can only be used for echo server debugging
 MeterValues::MeterValues() {
     
 }
 
-MeterValues::MeterValues(const std::vector<OcppTimestamp> *sampleTime, const std::vector<float> *energy, const std::vector<float> *power, int connectorId, int transactionId) 
-      : connectorId{connectorId}, transactionId{transactionId} {
-    if (sampleTime)
-        this->sampleTime = std::vector<OcppTimestamp>(*sampleTime);
-    if (energy)
-        this->energy = std::vector<float>(*energy);
-    if (power)
-        this->power = std::vector<float>(*power);
+MeterValues::MeterValues(MeterSampleBuffer&& samples, int connectorId, int transactionId, bool fixedTransactionId) 
+      : samples{std::move(samples)}, connectorId{connectorId}, transactionId{transactionId}, fixedTransactionId{fixedTransactionId} {
+
 }
 
 MeterValues::~MeterValues(){
@@ -34,7 +117,16 @@ const char* MeterValues::getOcppOperationType(){
 
 std::unique_ptr<DynamicJsonDocument> MeterValues::createReq() {
 
-    int numEntries = sampleTime.size();
+    int numEntries = samples.size();
+
+    //if a measurand is missing at at least one point in time, omit that measurand completely
+    std::vector<size_t> columns;
+    for (size_t column = 0; column < samples.getNumColumns(); column++) {
+        if (samples.isColumnComplete(column)) {
+            columns.push_back(column);
+        }
+    }
+    int numColumns = columns.size();
 
     const size_t VALUE_MAXPRECISION = 10;
     const size_t VALUE_MAXSIZE = VALUE_MAXPRECISION + 7; 
@@ -45,39 +137,45 @@ std::unique_ptr<DynamicJsonDocument> MeterValues::createReq() {
         + JSON_ARRAY_SIZE(numEntries) //metervalue array
         + numEntries * JSON_OBJECT_SIZE(1) //sampledValue entry
         + numEntries * (JSON_OBJECT_SIZE(1) + (JSONDATE_LENGTH + 1)) //timestamp
-        + numEntries * JSON_ARRAY_SIZE(2) //sampledValue
-        + 2 * numEntries * (JSON_OBJECT_SIZE(1) + VALUE_MAXSIZE) //value
-        + 2 * numEntries * JSON_OBJECT_SIZE(1) //measurand
-        + 2 * numEntries * JSON_OBJECT_SIZE(1) //unit
+        + numEntries * JSON_ARRAY_SIZE(numColumns) //sampledValue
+        + numColumns * numEntries * (JSON_OBJECT_SIZE(1) + VALUE_MAXSIZE) //value
+        + numColumns * numEntries * JSON_OBJECT_SIZE(1) //measurand
+        + numColumns * numEntries * JSON_OBJECT_SIZE(1) //unit
+        + numColumns * numEntries * 3 * JSON_OBJECT_SIZE(1) //context, phase, location
         + 230)); //"safety space"
     JsonObject payload = doc->to<JsonObject>();
     
     payload["connectorId"] = connectorId;
     JsonArray meterValues = payload.createNestedArray("meterValue");
-    for (size_t i = 0; i < sampleTime.size(); i++) {
+    for (size_t i = 0; i < samples.size(); i++) {
         JsonObject meterValue = meterValues.createNestedObject();
         char timestamp[JSONDATE_LENGTH + 1] = {'\0'};
-        OcppTimestamp otimestamp = sampleTime.at(i);
-        otimestamp.toJsonString(timestamp, JSONDATE_LENGTH + 1);
+        samples.getTimestamp(i).toJsonString(timestamp, JSONDATE_LENGTH + 1);
         meterValue["timestamp"] = timestamp;
         JsonArray sampledValue = meterValue.createNestedArray("sampledValue");
-        if (energy.size() >= i + 1) {
-            JsonObject sampledValue_1 = sampledValue.createNestedObject();
-            snprintf(value_str, VALUE_MAXSIZE, "%.*g", VALUE_MAXPRECISION, energy.at(i));
-            sampledValue_1["value"] = value_str;
-            sampledValue_1["measurand"] = "Energy.Active.Import.Register";
-            sampledValue_1["unit"] = "Wh";
-        }
-        if (power.size() >= i + 1) {
-            JsonObject sampledValue_2 = sampledValue.createNestedObject();
-            snprintf(value_str, VALUE_MAXSIZE, "%.*g", VALUE_MAXPRECISION, power.at(i));
-            sampledValue_2["value"] = value_str;
-            sampledValue_2["measurand"] = "Power.Active.Import";
-            sampledValue_2["unit"] = "W";
+        for (size_t column : columns) {
+            JsonObject sampledValue_i = sampledValue.createNestedObject();
+            snprintf(value_str, VALUE_MAXSIZE, "%.*g", VALUE_MAXPRECISION, samples.getValue(column, i));
+            sampledValue_i["value"] = value_str; //copied by ArduinoJson (non-const char*)
+            if (samples.getContext()) {
+                sampledValue_i["context"] = samples.getContext();
+            }
+            sampledValue_i["measurand"] = samples.getColumn(column).measurand;
+            sampledValue_i["unit"] = samples.getColumn(column).unit;
+            if (samples.getColumn(column).phase) {
+                sampledValue_i["phase"] = samples.getColumn(column).phase;
+            }
+            if (samples.getColumn(column).location) {
+                sampledValue_i["location"] = samples.getColumn(column).location;
+            }
         }
     }
 
-    if (ocppModel && ocppModel->getConnectorStatus(connectorId)) {
+    if (fixedTransactionId) {
+        if (transactionId >= 0) {
+            payload["transactionId"] = transactionId;
+        }
+    } else if (ocppModel && ocppModel->getConnectorStatus(connectorId)) {
         auto connector = ocppModel->getConnectorStatus(connectorId);
         if (connector->getTransactionIdSync() >= 0) {
             payload["transactionId"] = connector->getTransactionIdSync();
@@ -87,6 +185,74 @@ std::unique_ptr<DynamicJsonDocument> MeterValues::createReq() {
     return doc;
 }
 
+void ArduinoOcpp::Ocpp16::appendMeterValueEntries(std::string& out, const MeterSampleBuffer& samples) {
+    using namespace MeterValuesSerializer;
+
+    //if a measurand is missing at at least one point in time, omit that measurand completely
+    std::vector<size_t> columns;
+    for (size_t column = 0; column < samples.getNumColumns(); column++) {
+        if (samples.isColumnComplete(column)) {
+            columns.push_back(column);
+        }
+    }
+
+    for (size_t i = 0; i < samples.size(); i++) {
+        if (i > 0) {
+            out += ',';
+        }
+        char timestamp[JSONDATE_LENGTH + 1] = {'\0'};
+        samples.getTimestamp(i).toJsonString(timestamp, JSONDATE_LENGTH + 1);
+        out += "{\"timestamp\":";
+        appendString(out, timestamp);
+        out += ",\"sampledValue\":[";
+        for (size_t k = 0; k < columns.size(); k++) {
+            const MeasurandDescriptor& descriptor = samples.getColumn(columns[k]);
+            if (k > 0) {
+                out += ',';
+            }
+            out += "{\"value\":\"";
+            appendDecimal(out, samples.getValue(columns[k], i));
+            out += '"';
+            if (samples.getContext()) {
+                appendMember(out, "context", samples.getContext());
+            }
+            appendMember(out, "measurand", descriptor.measurand);
+            appendMember(out, "unit", descriptor.unit);
+            if (descriptor.phase) {
+                appendMember(out, "phase", descriptor.phase);
+            }
+            if (descriptor.location) {
+                appendMember(out, "location", descriptor.location);
+            }
+            out += '}';
+        }
+        out += "]}";
+    }
+}
+
+bool MeterValues::serializeReq(std::string& out) {
+    out += "{\"connectorId\":";
+    out += std::to_string(connectorId);
+
+    out += ",\"meterValue\":[";
+    appendMeterValueEntries(out, samples);
+    out += ']';
+
+    int txId = -1;
+    if (fixedTransactionId) {
+        txId = transactionId;
+    } else if (ocppModel && ocppModel->getConnectorStatus(connectorId)) {
+        txId = ocppModel->getConnectorStatus(connectorId)->getTransactionIdSync();
+    }
+    if (txId >= 0) {
+        out += ",\"transactionId\":";
+        out += std::to_string(txId);
+    }
+
+    out += '}';
+    return true;
+}
+
 void MeterValues::processConf(JsonObject payload) {
     AO_DBG_DEBUG("Request has been confirmed");
 }
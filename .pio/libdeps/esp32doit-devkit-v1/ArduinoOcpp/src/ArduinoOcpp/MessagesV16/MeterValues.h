@@ -7,24 +7,28 @@
 
 #include <ArduinoOcpp/Core/OcppMessage.h>
 #include <ArduinoOcpp/Core/OcppTime.h>
-
-#include <vector>
+#include <ArduinoOcpp/Tasks/Metering/MeterSampleBuffer.h>
 
 namespace ArduinoOcpp {
 namespace Ocpp16 {
 
+/*
+ * Appends the samples as comma-separated MeterValue objects (without the enclosing array brackets). Measurands which
+ * are missing at at least one point in time are omitted. Also used for the transactionData of StopTransaction
+ */
+void appendMeterValueEntries(std::string& out, const MeterSampleBuffer& samples);
+
 class MeterValues : public OcppMessage {
 private:
 
-    std::vector<OcppTimestamp> sampleTime;
-    std::vector<float> power;
-    std::vector<float> energy;
+    MeterSampleBuffer samples;
 
     int connectorId = 0;
     int transactionId = -1;
+    bool fixedTransactionId = false; //if false, the transactionId is taken from the connector when sending
 
 public:
-    MeterValues(const std::vector<OcppTimestamp> *sampleTime, const std::vector<float> *energy, const std::vector<float> *power, int connectorId, int transactionId);
+    MeterValues(MeterSampleBuffer&& samples, int connectorId, int transactionId, bool fixedTransactionId = false); //takes over the samples without copy
 
     MeterValues(); //for debugging only. Make this for the server pendant
 
@@ -34,11 +38,21 @@ public:
 
     std::unique_ptr<DynamicJsonDocument> createReq();
 
+    /*
+     * Writes the payload straight from the sample buffer into the outgoing frame. Needs no intermediate JSON
+     * document, so the memory overhead doesn't depend on the number of samples
+     */
+    bool serializeReq(std::string& out);
+
     void processConf(JsonObject payload);
 
     void processReq(JsonObject payload);
 
     std::unique_ptr<DynamicJsonDocument> createConf();
+
+    const MeterSampleBuffer& getSamples() {return samples;}
+    int getConnectorId() {return connectorId;}
+    int getTransactionId() {return transactionId;}
 };
 
 } //end namespace Ocpp16
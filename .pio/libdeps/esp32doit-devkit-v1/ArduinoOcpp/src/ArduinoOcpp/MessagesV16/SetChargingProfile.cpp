@@ -28,20 +28,20 @@ const char* SetChargingProfile::getOcppOperationType(){
 
 void SetChargingProfile::processReq(JsonObject payload) {
 
-    //int connectorID = payload["connectorId"];
+    int connectorId = payload["connectorId"] | -1;
 
     JsonObject csChargingProfiles = payload["csChargingProfiles"];
 
     if (ocppModel && ocppModel->getSmartChargingService()) {
         auto smartChargingService = ocppModel->getSmartChargingService();
-        smartChargingService->updateChargingProfile(&csChargingProfiles);
+        accepted = smartChargingService->updateChargingProfile(connectorId, &csChargingProfiles);
     }
 }
 
-std::unique_ptr<DynamicJsonDocument> SetChargingProfile::createConf(){ //TODO review
+std::unique_ptr<DynamicJsonDocument> SetChargingProfile::createConf(){
     auto doc = std::unique_ptr<DynamicJsonDocument>(new DynamicJsonDocument(JSON_OBJECT_SIZE(1)));
     JsonObject payload = doc->to<JsonObject>();
-    payload["status"] = "Accepted";
+    payload["status"] = accepted ? "Accepted" : "Rejected";
     return doc;
 }
 
@@ -13,6 +13,7 @@ namespace Ocpp16 {
 class SetChargingProfile : public OcppMessage {
 private:
     std::unique_ptr<DynamicJsonDocument> payloadToClient;
+    bool accepted = false;
 public:
     SetChargingProfile();
 
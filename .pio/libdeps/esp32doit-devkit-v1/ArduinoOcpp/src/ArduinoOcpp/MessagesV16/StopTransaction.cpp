@@ -3,6 +3,7 @@
 // MIT License
 
 #include <ArduinoOcpp/MessagesV16/StopTransaction.h>
+#include <ArduinoOcpp/MessagesV16/MeterValues.h>
 #include <ArduinoOcpp/Core/OcppModel.h>
 #include <ArduinoOcpp/Tasks/ChargePointStatus/ChargePointStatusService.h>
 #include <ArduinoOcpp/Tasks/Metering/MeteringService.h>
@@ -23,6 +24,7 @@ void StopTransaction::initiate() {
     if (ocppModel && ocppModel->getMeteringService()) {
         auto meteringService = ocppModel->getMeteringService();
         meterStop = (int) meteringService->readEnergyActiveImportRegister(connectorId);
+        transactionData = meteringService->takeStopTxnData(connectorId); //before the transaction ends
     }
 
     if (ocppModel) {
@@ -64,6 +66,46 @@ std::unique_ptr<DynamicJsonDocument> StopTransaction::createReq() {
     return doc;
 }
 
+bool StopTransaction::serializeReq(std::string& out) {
+    if (transactionData.empty()) {
+        return false; //createReq() is sufficient
+    }
+
+    out += '{';
+
+    if (meterStop >= 0) {
+        out += "\"meterStop\":";
+        out += std::to_string(meterStop);
+        out += ',';
+    }
+
+    if (otimestamp > MIN_TIME) {
+        char timestamp[JSONDATE_LENGTH + 1] = {'\0'};
+        otimestamp.toJsonString(timestamp, JSONDATE_LENGTH + 1);
+        out += "\"timestamp\":\"";
+        out += timestamp;
+        out += "\",";
+    }
+
+    if (ocppModel && ocppModel->getConnectorStatus(connectorId)){
+        auto connector = ocppModel->getConnectorStatus(connectorId);
+        out += "\"transactionId\":";
+        out += std::to_string(connector->getTransactionIdSync());
+        out += ',';
+    }
+
+    out += "\"transactionData\":[";
+    for (size_t i = 0; i < transactionData.size(); i++) {
+        if (i > 0) {
+            out += ',';
+        }
+        appendMeterValueEntries(out, transactionData[i]);
+    }
+    out += "]}";
+
+    return true;
+}
+
 void StopTransaction::processConf(JsonObject payload) {
 
     if (ocppModel && ocppModel->getConnectorStatus(connectorId)){
@@ -7,6 +7,9 @@
 
 #include <ArduinoOcpp/Core/OcppMessage.h>
 #include <ArduinoOcpp/Core/OcppTime.h>
+#include <ArduinoOcpp/Tasks/Metering/MeterSampleBuffer.h>
+
+#include <vector>
 
 namespace ArduinoOcpp {
 namespace Ocpp16 {
@@ -16,6 +19,7 @@ private:
     int connectorId = 1;
     int meterStop = -1;
     OcppTimestamp otimestamp;
+    std::vector<MeterSampleBuffer> transactionData; //StopTxnSampledData and StopTxnAlignedData
 public:
 
     StopTransaction(int connectorId);
@@ -24,7 +28,9 @@ public:
 
     void initiate();
 
-    std::unique_ptr<DynamicJsonDocument> createReq();
+    std::unique_ptr<DynamicJsonDocument> createReq(); //without transactionData
+
+    bool serializeReq(std::string& out); //with transactionData
 
     void processConf(JsonObject payload);
 
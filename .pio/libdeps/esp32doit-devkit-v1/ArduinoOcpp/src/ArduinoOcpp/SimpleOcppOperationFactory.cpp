@@ -25,6 +25,7 @@
 #include <ArduinoOcpp/MessagesV16/DiagnosticsStatusNotification.h>
 #include <ArduinoOcpp/MessagesV16/UnlockConnector.h>
 #include <ArduinoOcpp/MessagesV16/ClearChargingProfile.h>
+#include <ArduinoOcpp/MessagesV16/GetCompositeSchedule.h>
 #include <ArduinoOcpp/MessagesV16/ChangeAvailability.h>
 #include <ArduinoOcpp/MessagesV16/ClearCache.h>
 
@@ -273,6 +274,8 @@ std::unique_ptr<OcppOperation> makeOcppOperation(const char *messageType, int co
         msg = std::unique_ptr<OcppMessage>(new Ocpp16::UnlockConnector());
     } else if (!strcmp(messageType, "ClearChargingProfile")) {
         msg = std::unique_ptr<OcppMessage>(new Ocpp16::ClearChargingProfile());
+    } else if (!strcmp(messageType, "GetCompositeSchedule")) {
+        msg = std::unique_ptr<OcppMessage>(new Ocpp16::GetCompositeSchedule());
     } else if (!strcmp(messageType, "ChangeAvailability")) {
         msg = std::unique_ptr<OcppMessage>(new Ocpp16::ChangeAvailability());
     } else if (!strcmp(messageType, "ClearCache")) {
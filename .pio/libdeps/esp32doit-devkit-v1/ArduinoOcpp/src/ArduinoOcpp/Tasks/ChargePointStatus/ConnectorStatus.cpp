@@ -33,7 +33,13 @@ ConnectorStatus::ConnectorStatus(OcppModel& context, int connectorId)
     snprintf(key, CONF_KEYLEN_MAX + 1, "AO_AVAIL_CONN_%d", connectorId);
     availability = declareConfiguration<int>(key, AVAILABILITY_OPERATIVE, CONFIGURATION_FN, false, false, true, false);
 
-    connectionTimeOut = declareConfiguration<int>("ConnectionTimeOut", 30, CONFIGURATION_FN, true, true, true, false);
+    connectionTimeOut = declareConfiguration(StandardIntKey::ConnectionTimeOut);
+    if (connectionTimeOut) {
+        connectionTimeOutMs = ((ulong) ((int) *connectionTimeOut)) * 1000UL;
+        connectionTimeOutObserver = connectionTimeOut->addObserver([this] () {
+            connectionTimeOutMs = ((ulong) ((int) *connectionTimeOut)) * 1000UL;
+        });
+    }
     if (!sIdTag || !transactionId || !availability) {
         AO_DBG_ERR("Cannot declare sessionIdTag, transactionId or availability");
     }
@@ -47,6 +53,12 @@ ConnectorStatus::ConnectorStatus(OcppModel& context, int connectorId)
     transactionIdSync = *transactionId;
 }
 
+ConnectorStatus::~ConnectorStatus() {
+    if (connectionTimeOut) {
+        connectionTimeOut->removeObserver(connectionTimeOutObserver);
+    }
+}
+
 OcppEvseState ConnectorStatus::inferenceStatus() {
     /*
     * Handle special case: This is the ConnectorStatus for the whole CP (i.e. connectorId=0) --> only states Available, Unavailable, Faulted are possible
@@ -148,7 +160,7 @@ OcppMessage *ConnectorStatus::loop() {
             AO_DBG_DEBUG("Session mngt: release connectionTimeOut");
             connectionTimeOutListen = false;
         } else {
-            if (ao_tick_ms() - connectionTimeOutTimestamp >= ((ulong) *connectionTimeOut) * 1000UL) {
+            if (ao_tick_ms() - connectionTimeOutTimestamp >= connectionTimeOutMs) {
                 AO_DBG_INFO("Session mngt: timeout");
                 endSession();
                 connectionTimeOutListen = false;
@@ -36,7 +36,9 @@ private:
     std::shared_ptr<Configuration<int>> transactionId {nullptr};
     int transactionIdSync = -1;
 
-    std::shared_ptr<Configuration<int>> connectionTimeOut {nullptr}; //in seconds
+    Configuration<int> *connectionTimeOut {nullptr}; //in seconds
+    int connectionTimeOutObserver {-1};
+    ulong connectionTimeOutMs {0}; //cached value of connectionTimeOut; updated by observer
     bool connectionTimeOutListen {false};
     ulong connectionTimeOutTimestamp {0}; //in milliseconds
 
@@ -49,6 +51,7 @@ private:
     std::function<bool()> onUnlockConnector {nullptr};
 public:
     ConnectorStatus(OcppModel& context, int connectorId);
+    ~ConnectorStatus();
 
     /*
      * Relation Session <-> Transaction
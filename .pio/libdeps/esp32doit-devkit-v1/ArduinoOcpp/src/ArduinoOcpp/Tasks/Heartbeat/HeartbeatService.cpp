@@ -12,16 +12,34 @@
 using namespace ArduinoOcpp;
 
 HeartbeatService::HeartbeatService(OcppEngine& context) : context(context) {
-    heartbeatInterval = declareConfiguration("HeartbeatInterval", 86400);
+    heartbeatInterval = declareConfiguration(StandardIntKey::HeartbeatInterval);
+    if (heartbeatInterval) {
+        heartbeatIntervalObserver = heartbeatInterval->addObserver([this] () {
+            updateHeartbeatInterval();
+        });
+    }
+    updateHeartbeatInterval();
     lastHeartbeat = ao_tick_ms();
 }
 
+HeartbeatService::~HeartbeatService() {
+    if (heartbeatInterval) {
+        heartbeatInterval->removeObserver(heartbeatIntervalObserver);
+    }
+}
+
+void HeartbeatService::updateHeartbeatInterval() {
+    if (!heartbeatInterval) {
+        return;
+    }
+    heartbeatIntervalMs = (ulong) ((int) *heartbeatInterval);
+    heartbeatIntervalMs *= 1000UL; //conversion s -> ms
+}
+
 void HeartbeatService::loop() {
-    ulong hbInterval = *heartbeatInterval;
-    hbInterval *= 1000UL; //conversion s -> ms
     ulong now = ao_tick_ms();
 
-    if (now - lastHeartbeat >= hbInterval) {
+    if (now - lastHeartbeat >= heartbeatIntervalMs) {
         lastHeartbeat = now;
 
         auto heartbeat = makeOcppOperation("Heartbeat");
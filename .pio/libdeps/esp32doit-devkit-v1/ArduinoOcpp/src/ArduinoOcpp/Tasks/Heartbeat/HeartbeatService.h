@@ -17,10 +17,14 @@ private:
     OcppEngine& context;
 
     ulong lastHeartbeat;
-    std::shared_ptr<ArduinoOcpp::Configuration<int>> heartbeatInterval;
+    Configuration<int> *heartbeatInterval = nullptr;
+    int heartbeatIntervalObserver = -1;
+    ulong heartbeatIntervalMs = 0; //cached value of HeartbeatInterval; updated by observer
+    void updateHeartbeatInterval();
 
 public:
     HeartbeatService(OcppEngine& context);
+    ~HeartbeatService();
 
     void loop();
 };
@@ -10,48 +10,300 @@
 #include <ArduinoOcpp/Platform.h>
 #include <ArduinoOcpp/Debug.h>
 
+#include <math.h>
+#include <string.h>
+
 using namespace ArduinoOcpp;
 using namespace ArduinoOcpp::Ocpp16;
 
+namespace ArduinoOcpp {
+namespace SampledData {
+
+const MeasurandDescriptor ENERGY = {"Energy.Active.Import.Register", "Wh", nullptr, nullptr};
+const MeasurandDescriptor POWER = {"Power.Active.Import", "W", nullptr, nullptr};
+const char *INTERVAL_ENERGY = "Energy.Active.Import.Interval";
+const char *CONTEXT_CLOCK = "Sample.Clock";
+
+bool equals(const char *a, const char *b) {
+    if (!a || !b) {
+        return a == b;
+    }
+    return !strcmp(a, b);
+}
+
+bool sameQuantity(const MeasurandDescriptor& a, const MeasurandDescriptor& b) {
+    return equals(a.measurand, b.measurand) &&
+            equals(a.phase, b.phase) &&
+            equals(a.location, b.location);
+}
+
+bool tokenEquals(const char *token, size_t len, const char *measurand) {
+    return !strncmp(token, measurand, len) && measurand[len] == '\0';
+}
+
+bool isRegister(const char *measurand) {
+    const char *suffix = ".Register";
+    size_t len = strlen(measurand);
+    size_t suffix_len = strlen(suffix);
+    return len >= suffix_len && !strcmp(measurand + len - suffix_len, suffix);
+}
+
+} //end namespace SampledData
+} //end namespace ArduinoOcpp
+
 ConnectorMeterValuesRecorder::ConnectorMeterValuesRecorder(OcppModel& context, int connectorId)
         : context(context), connectorId{connectorId} {
-    sampleTimestamp = std::vector<OcppTimestamp>();
-    energy = std::vector<float>();
-    power = std::vector<float>();
 
-    MeterValueSampleInterval = declareConfiguration("MeterValueSampleInterval", 60);
-    MeterValuesSampledDataMaxLength = declareConfiguration("MeterValuesSampledDataMaxLength", 4, CONFIGURATION_VOLATILE, false, true, false, false);
+    MeterValuesSampledData = declareConfiguration<const char*>("MeterValuesSampledData", "Energy.Active.Import.Register,Power.Active.Import");
+    StopTxnSampledData = declareConfiguration<const char*>("StopTxnSampledData", "");
+    MeterValuesAlignedData = declareConfiguration<const char*>("MeterValuesAlignedData", "Energy.Active.Import.Register");
+    StopTxnAlignedData = declareConfiguration<const char*>("StopTxnAlignedData", "");
+
+    if (MeterValuesSampledData) {
+        MeterValuesSampledDataObserver = MeterValuesSampledData->addObserver([this] () {
+            updateSelection();
+        });
+    }
+    if (StopTxnSampledData) {
+        StopTxnSampledDataObserver = StopTxnSampledData->addObserver([this] () {
+            updateSelection();
+        });
+    }
+    if (MeterValuesAlignedData) {
+        MeterValuesAlignedDataObserver = MeterValuesAlignedData->addObserver([this] () {
+            updateSelection();
+        });
+    }
+    if (StopTxnAlignedData) {
+        StopTxnAlignedDataObserver = StopTxnAlignedData->addObserver([this] () {
+            updateSelection();
+        });
+    }
+    updateSelection();
+
+    MeterValueSampleInterval = declareConfiguration(StandardIntKey::MeterValueSampleInterval);
+    MeterValuesSampledDataMaxLength = declareConfiguration(StandardIntKey::MeterValuesSampledDataMaxLength);
+    ClockAlignedDataInterval = declareConfiguration(StandardIntKey::ClockAlignedDataInterval);
+
+    if (MeterValueSampleInterval) {
+        MeterValueSampleIntervalObserver = MeterValueSampleInterval->addObserver([this] () {
+            updateConfiguration();
+        });
+    }
+    if (MeterValuesSampledDataMaxLength) {
+        MeterValuesSampledDataMaxLengthObserver = MeterValuesSampledDataMaxLength->addObserver([this] () {
+            updateConfiguration();
+        });
+    }
+    if (ClockAlignedDataInterval) {
+        ClockAlignedDataIntervalObserver = ClockAlignedDataInterval->addObserver([this] () {
+            updateConfiguration();
+        });
+    }
+    updateConfiguration();
+}
+
+ConnectorMeterValuesRecorder::~ConnectorMeterValuesRecorder() {
+    if (MeterValuesSampledData) {
+        MeterValuesSampledData->removeObserver(MeterValuesSampledDataObserver);
+    }
+    if (StopTxnSampledData) {
+        StopTxnSampledData->removeObserver(StopTxnSampledDataObserver);
+    }
+    if (MeterValuesAlignedData) {
+        MeterValuesAlignedData->removeObserver(MeterValuesAlignedDataObserver);
+    }
+    if (StopTxnAlignedData) {
+        StopTxnAlignedData->removeObserver(StopTxnAlignedDataObserver);
+    }
+    if (MeterValueSampleInterval) {
+        MeterValueSampleInterval->removeObserver(MeterValueSampleIntervalObserver);
+    }
+    if (MeterValuesSampledDataMaxLength) {
+        MeterValuesSampledDataMaxLength->removeObserver(MeterValuesSampledDataMaxLengthObserver);
+    }
+    if (ClockAlignedDataInterval) {
+        ClockAlignedDataInterval->removeObserver(ClockAlignedDataIntervalObserver);
+    }
+}
+
+void ConnectorMeterValuesRecorder::updateConfiguration() {
+    int interval = MeterValueSampleInterval ? (int) *MeterValueSampleInterval : 0;
+    if (interval >= 1) {
+        sampleIntervalMs = ((ulong) interval) * 1000UL;
+    } else {
+        sampleIntervalMs = 0;
+    }
+
+    sampledDataMaxLength = MeterValuesSampledDataMaxLength ? (int) *MeterValuesSampledDataMaxLength : 0;
+
+    int alignedInterval = ClockAlignedDataInterval ? (int) *ClockAlignedDataInterval : 0;
+    int64_t alignedIntervalMsNew = alignedInterval >= 1 ? (int64_t) alignedInterval * 1000LL : 0;
+    if (alignedIntervalMsNew != alignedIntervalMs) {
+        alignedIntervalMs = alignedIntervalMsNew;
+        alignedPeriod = -1; //restart aggregation
+    }
+}
+
+ConnectorMeterValuesRecorder::SamplerSelection ConnectorMeterValuesRecorder::select(const char *measurandsCsl, bool integratePower) {
+    SamplerSelection selection;
+    auto columns = std::make_shared<MeasurandColumns>();
+
+    //the order of the CSL determines the order of the sampledValues
+    const char *token = measurandsCsl ? measurandsCsl : "";
+    while (*token) {
+        while (*token == ',' || *token == ' ') {
+            token++;
+        }
+        size_t len = 0;
+        while (token[len] && token[len] != ',' && token[len] != ' ') {
+            len++;
+        }
+        if (len == 0) {
+            break;
+        }
+
+        bool found = false;
+        for (size_t i = 0; i < samplers.size(); i++) {
+            if (!SampledData::tokenEquals(token, len, samplers[i].descriptor.measurand)) {
+                continue;
+            }
+            found = true;
+            bool duplicate = false;
+            for (size_t selected : selection.samplers) {
+                duplicate |= (selected == i);
+            }
+            if (!duplicate) {
+                selection.samplers.push_back(i);
+                columns->push_back(samplers[i].descriptor);
+            }
+        }
+
+        if (!found && integratePower && SampledData::tokenEquals(token, len, SampledData::INTERVAL_ENERGY)) {
+            //no meter for the interval energy. Integrate the power instead
+            for (size_t i = 0; i < samplers.size(); i++) {
+                auto& descriptor = samplers[i].descriptor;
+                if (!SampledData::equals(descriptor.measurand, SampledData::POWER.measurand)) {
+                    continue;
+                }
+                found = true;
+                selection.samplers.push_back(i);
+                columns->push_back(MeasurandDescriptor{
+                        SampledData::INTERVAL_ENERGY,
+                        SampledData::equals(descriptor.unit, "kW") ? "kWh" : "Wh",
+                        descriptor.phase,
+                        descriptor.location});
+            }
+        }
+
+        if (!found) {
+            AO_DBG_DEBUG("No sampler for measurand %.*s", (int) len, token);
+        }
+        token += len;
+    }
+
+    selection.columns = std::move(columns);
+    return selection;
+}
+
+void ConnectorMeterValuesRecorder::updateSelection() {
+    meterValuesSelection = select(MeterValuesSampledData ? (const char*) *MeterValuesSampledData : nullptr);
+    stopTxnSelection = select(StopTxnSampledData ? (const char*) *StopTxnSampledData : nullptr);
+    alignedSelection = select(MeterValuesAlignedData ? (const char*) *MeterValuesAlignedData : nullptr, true);
+    stopTxnAlignedSelection = select(StopTxnAlignedData ? (const char*) *StopTxnAlignedData : nullptr);
 }
 
-void ConnectorMeterValuesRecorder::takeSample() {
-    if (energySampler != nullptr || powerSampler != nullptr) {
-        if (!context.getOcppTime().isValid()) return;
-        sampleTimestamp.push_back(context.getOcppTime().getOcppTimestampNow());
+size_t ConnectorMeterValuesRecorder::getBufferCapacity() {
+    if (sampledDataMaxLength < 1) {
+        return 1;
+    } else if (sampledDataMaxLength > AO_METERVALUES_MAX_SAMPLES) {
+        return AO_METERVALUES_MAX_SAMPLES;
     }
+    return (size_t) sampledDataMaxLength;
+}
+
+void ConnectorMeterValuesRecorder::takeSample(MeterSampleBuffer& buffer, const SamplerSelection& selection, bool deferAsync) {
+    if (selection.samplers.empty() || buffer.getColumns() != selection.columns) {
+        return;
+    }
+
+    if (!context.getOcppTime().isValid()) return;
 
-    if (energySampler != nullptr) {
-        energy.push_back(energySampler());
+    if (!buffer.push(context.getOcppTime().getOcppTimestampNow())) {
+        return;
     }
 
-    if (powerSampler != nullptr) {
-        power.push_back(powerSampler());
+    for (size_t column = 0; column < selection.samplers.size(); column++) {
+        auto& sampler = samplers[selection.samplers[column]];
+        if (deferAsync && sampler.async) {
+            auto reading = sampler.async->request();
+            if (reading && reading->isReady()) {
+                buffer.setValue(column, reading->getValue());
+            } else if (reading) {
+                pendingValues.push_back(PendingValue{reading, buffer.getLatestSampleId(), column, ao_tick_ms()});
+            }
+        } else {
+            buffer.setValue(column, sampler.sample());
+        }
     }
 }
 
+void ConnectorMeterValuesRecorder::pollPendingValues() {
+    auto pending = pendingValues.begin();
+    while (pending != pendingValues.end()) {
+        if (pending->reading->isReady()) {
+            samples.setValueById(pending->sampleId, pending->column, pending->reading->getValue());
+            pending = pendingValues.erase(pending);
+        } else if (ao_tick_ms() - pending->requestTime >= AO_METER_READ_TIMEOUT_MS) {
+            AO_DBG_WARN("Meter read timeout. Value stays empty");
+            pending = pendingValues.erase(pending);
+        } else {
+            pending++;
+        }
+    }
+}
+
+void ConnectorMeterValuesRecorder::completePendingValues() {
+    for (auto& pending : pendingValues) {
+        float value = NAN;
+        if (pending.reading->isReady()) {
+            value = pending.reading->getValue();
+        } else if (pending.column < meterValuesSelection.samplers.size()) {
+            auto& sampler = samplers[meterValuesSelection.samplers[pending.column]];
+            if (sampler.async) {
+                value = sampler.async->getLatest();
+            }
+        }
+        if (!isnan(value)) {
+            samples.setValueById(pending.sampleId, pending.column, value);
+        }
+    }
+    pendingValues.clear();
+}
+
 OcppMessage *ConnectorMeterValuesRecorder::loop() {
 
-    if (*MeterValueSampleInterval < 1) {
+    stopTxnLoop();
+
+    if (auto alignedMeterValues = alignedLoop()) {
+        return alignedMeterValues;
+    }
+
+    if (sampleIntervalMs == 0) {
         //Metering off by definition
         clear();
         return nullptr;
     }
 
+    pollPendingValues();
+
     /*
      * First: check if there was a transaction break (i.e. transaction either started or stopped; transactionId changed)
      */ 
     auto connector = context.getConnectorStatus(connectorId);
     if (connector && connector->getTransactionId() != lastTransactionId) {
-        //transaction break occured!
+        //transaction break occured! Send without waiting for pending reads. They take the latest value of their sampler
+        completePendingValues();
         auto result = toMeterValues();
         lastTransactionId = connector->getTransactionId();
         return result;
@@ -64,8 +316,22 @@ OcppMessage *ConnectorMeterValuesRecorder::loop() {
     * If no powerSampler is available, estimate the energy consumption taking the Charging Schedule and CP Status
     * into account.
     */
-    if (ao_tick_ms() - lastSampleTime >= (ulong) (*MeterValueSampleInterval * 1000)) {
-        takeSample();
+    if (samples.getColumns() != meterValuesSelection.columns) {
+        //MeterValuesSampledData or the samplers changed. Send the samples recorded so far and restart with the new columns
+        if (samples.size() > 0) {
+            return toMeterValues();
+        }
+        clear();
+    }
+
+    bool bufferFull = samples.size() > 0 && (((int) samples.size()) >= sampledDataMaxLength || samples.isFull());
+
+    //a full buffer waits for its pending reads and is sent before the next sample. Don't overwrite samples meanwhile
+    if (!bufferFull && ao_tick_ms() - lastSampleTime >= sampleIntervalMs) {
+        if (samples.getCapacity() == 0) {
+            clear(); //allocate
+        }
+        takeSample(samples, meterValuesSelection, true);
         lastSampleTime = ao_tick_ms();
     }
 
@@ -73,7 +339,8 @@ OcppMessage *ConnectorMeterValuesRecorder::loop() {
     /*
     * Is the value buffer already full? If yes, return MeterValues message
     */
-    if (((int) sampleTimestamp.size()) >= (int) *MeterValuesSampledDataMaxLength) {
+    bufferFull = samples.size() > 0 && (((int) samples.size()) >= sampledDataMaxLength || samples.isFull());
+    if (bufferFull && pendingValues.empty()) {
         auto result = toMeterValues();
         return result;
     }
@@ -81,90 +348,284 @@ OcppMessage *ConnectorMeterValuesRecorder::loop() {
     return nullptr; //successful method completition. Currently there is no reason to send a MeterValues Msg.
 }
 
-OcppMessage *ConnectorMeterValuesRecorder::toMeterValues() {
-    if (sampleTimestamp.size() == 0) {
-        AO_DBG_DEBUG("Checking if to send MeterValues ... No");
-        clear();
+OcppMessage *ConnectorMeterValuesRecorder::alignedLoop() {
+    if (alignedIntervalMs == 0 || alignedSelection.samplers.empty() || !context.getOcppTime().isValid()) {
+        alignedPeriod = -1;
         return nullptr;
     }
 
-    //decide which measurands to send. If a measurand is missing at at least one point in time, omit that measurand completely
-
-    if (energy.size() == sampleTimestamp.size() && power.size() == sampleTimestamp.size()) {
-        auto result = new MeterValues(&sampleTimestamp, &energy, &power, connectorId, lastTransactionId);
-        clear();
-        return result;
+    if (alignedAggregatesColumns != alignedSelection.columns) {
+        //MeterValuesAlignedData or the samplers changed. Restart with the new columns
+        alignedAggregates.reset(new MeterAggregate[alignedSelection.samplers.size()]);
+        alignedAggregatesColumns = alignedSelection.columns;
+        alignedPeriod = -1;
     }
 
-    if (energy.size() == sampleTimestamp.size() && power.size() != sampleTimestamp.size()) {
-        auto result = new MeterValues(&sampleTimestamp, &energy, nullptr, connectorId, lastTransactionId);
-        clear();
-        return result;
+    int64_t nowMs = context.getOcppTime().getOcppTimestampNow().getEpochMs();
+    int64_t period = nowMs / alignedIntervalMs;
+
+    OcppMessage *result = nullptr;
+
+    if (alignedPeriod < 0 || period < alignedPeriod) {
+        //(re)start. The first interval is only partially covered, but still reported at its end
+        for (size_t column = 0; column < alignedSelection.samplers.size(); column++) {
+            alignedAggregates[column] = MeterAggregate();
+        }
+        alignedPeriod = period;
+        aggregate(nowMs);
+        lastAggregationTime = ao_tick_ms();
+        return nullptr;
+    } else if (period > alignedPeriod) {
+        result = toAlignedMeterValues((alignedPeriod + 1) * alignedIntervalMs);
+        alignedPeriod = period;
     }
 
-    if (energy.size() != sampleTimestamp.size() && power.size() == sampleTimestamp.size()) {
-        auto result = new MeterValues(&sampleTimestamp, nullptr, &power, connectorId, lastTransactionId);
-        clear();
-        return result;
+    if (ao_tick_ms() - lastAggregationTime >= AO_METERVALUES_AGGREGATION_INTERVAL_MS) {
+        aggregate(nowMs);
+        lastAggregationTime = ao_tick_ms();
     }
 
-    //Maybe the energy sampler or power sampler was set during recording. Discard recorded data.
-    AO_DBG_WARN("Invalid data set. Discard data set and restart recording");
-    clear();
+    return result;
+}
+
+void ConnectorMeterValuesRecorder::aggregate(int64_t timeMs) {
+    for (size_t column = 0; column < alignedSelection.samplers.size(); column++) {
+        size_t sampler = alignedSelection.samplers[column];
+
+        //the same sampler can feed several columns (e.g. power and interval energy). Read each only once
+        size_t prev = 0;
+        while (prev < column && alignedSelection.samplers[prev] != sampler) {
+            prev++;
+        }
 
-    return nullptr;
+        float value = prev < column ?
+                alignedAggregates[prev].getLast() :
+                samplers[sampler].sample();
+        alignedAggregates[column].add(value, timeMs);
+    }
 }
 
-OcppMessage *ConnectorMeterValuesRecorder::takeMeterValuesNow() {
+OcppMessage *ConnectorMeterValuesRecorder::toAlignedMeterValues(int64_t endMs) {
+    MeterSampleBuffer buffer {1, alignedSelection.columns};
+    buffer.setContext(SampledData::CONTEXT_CLOCK);
+
+    OcppTimestamp timestamp;
+    timestamp.setEpochMs(endMs);
+    buffer.push(timestamp);
+
+    bool anyValue = false;
+    for (size_t column = 0; column < buffer.getNumColumns(); column++) {
+        auto& aggregate = alignedAggregates[column];
+        aggregate.closeAt(endMs);
+
+        if (aggregate.getCount() > 0) {
+            //only the aggregate is reported: registers at the end of the interval, the rest as average
+            const char *measurand = buffer.getColumn(column).measurand;
+            if (SampledData::isRegister(measurand)) {
+                buffer.setValue(column, aggregate.getLast());
+            } else if (SampledData::equals(measurand, SampledData::INTERVAL_ENERGY)) {
+                buffer.setValue(column, aggregate.getIntegralHours());
+            } else {
+                buffer.setValue(column, aggregate.getAverage());
+            }
+            anyValue = true;
+
+            AO_DBG_DEBUG("Aligned %s: min = %f, max = %f, avg = %f (%u samples)",
+                    measurand, aggregate.getMin(), aggregate.getMax(), aggregate.getAverage(), (unsigned int) aggregate.getCount());
+        }
+
+        aggregate.restart(endMs);
+    }
 
-    if (!energySampler && !powerSampler) {
+    if (!anyValue) {
         return nullptr;
     }
 
-    decltype(sampleTimestamp) t_now;
-    decltype(energy) e_now;
-    decltype(power) p_now;
+    int txId_now = -1;
+    auto connector = context.getConnectorStatus(connectorId);
+    if (connector) {
+        txId_now = connector->getTransactionId();
+    }
+
+    return new MeterValues(std::move(buffer), connectorId, txId_now);
+}
+
+void ConnectorMeterValuesRecorder::stopTxnLoop() {
+    auto connector = context.getConnectorStatus(connectorId);
+    if (!connector || connector->getTransactionId() < 0 || !context.getOcppTime().isValid()) {
+        //no transaction (anymore). Data which StopTransaction didn't take is discarded
+        stopTxnSampled.reset();
+        stopTxnAligned.reset();
+        stopTxnRecording = false;
+        return;
+    }
+
+    OcppTimestamp now = context.getOcppTime().getOcppTimestampNow();
+
+    if (!stopTxnRecording) {
+        //transaction started (the transactionId may still be pending). Start with a sample of the initial values
+        stopTxnRecording = true;
+        if (!stopTxnSelection.samplers.empty()) {
+            stopTxnSampled.reset(new TransactionDataBuffer(AO_STOPTXN_MAX_SAMPLES, stopTxnSelection.columns));
+            takeTransactionSample(*stopTxnSampled, stopTxnSelection, now);
+        }
+        if (!stopTxnAlignedSelection.samplers.empty()) {
+            stopTxnAligned.reset(new TransactionDataBuffer(AO_STOPTXN_MAX_SAMPLES, stopTxnAlignedSelection.columns, SampledData::CONTEXT_CLOCK));
+        }
+        lastStopTxnSampleTime = ao_tick_ms();
+        stopTxnAlignedPeriod = -1;
+        return;
+    }
+
+    if (stopTxnSampled && sampleIntervalMs > 0 && ao_tick_ms() - lastStopTxnSampleTime >= sampleIntervalMs) {
+        takeTransactionSample(*stopTxnSampled, stopTxnSelection, now);
+        lastStopTxnSampleTime = ao_tick_ms();
+    }
+
+    if (stopTxnAligned && alignedIntervalMs > 0) {
+        int64_t period = now.getEpochMs() / alignedIntervalMs;
+        if (stopTxnAlignedPeriod >= 0 && period > stopTxnAlignedPeriod) {
+            OcppTimestamp boundary;
+            boundary.setEpochMs(period * alignedIntervalMs);
+            takeTransactionSample(*stopTxnAligned, stopTxnAlignedSelection, boundary);
+        }
+        stopTxnAlignedPeriod = period;
+    }
+}
+
+void ConnectorMeterValuesRecorder::takeTransactionSample(TransactionDataBuffer& buffer, const SamplerSelection& selection, const OcppTimestamp& timestamp) {
+    if (buffer.getColumns() != selection.columns) {
+        //StopTxnSampledData / StopTxnAlignedData or the samplers changed. Keep the data recorded so far
+        return;
+    }
+
+    if (!buffer.push(timestamp)) {
+        return;
+    }
+
+    for (size_t column = 0; column < selection.samplers.size(); column++) {
+        buffer.addValue(column, samplers[selection.samplers[column]].sample());
+    }
+}
+
+std::vector<MeterSampleBuffer> ConnectorMeterValuesRecorder::takeStopTxnData() {
+    std::vector<MeterSampleBuffer> result;
+    if (stopTxnSampled && stopTxnSampled->size() > 0) {
+        result.push_back(stopTxnSampled->toSampleBuffer());
+    }
+    if (stopTxnAligned && stopTxnAligned->size() > 0) {
+        result.push_back(stopTxnAligned->toSampleBuffer());
+    }
+    stopTxnSampled.reset();
+    stopTxnAligned.reset();
+    return result;
+}
+
+OcppMessage *ConnectorMeterValuesRecorder::toMeterValues() {
+    if (samples.size() == 0) {
+        AO_DBG_DEBUG("Checking if to send MeterValues ... No");
+        clear();
+        return nullptr;
+    }
 
-    if (context.getOcppTime().isValid()) {
-        t_now.push_back(context.getOcppTime().getOcppTimestampNow());
+    //MeterValues omits measurands which are missing at at least one point in time
+    bool anyComplete = false;
+    for (size_t column = 0; column < samples.getNumColumns(); column++) {
+        anyComplete |= samples.isColumnComplete(column);
     }
 
-    if (energySampler) {
-        e_now.push_back(energySampler());
+    if (!anyComplete) {
+        //Maybe a sampler was set during recording. Discard recorded data.
+        AO_DBG_WARN("Invalid data set. Discard data set and restart recording");
+        clear();
+        return nullptr;
     }
 
-    if (powerSampler) {
-        p_now.push_back(powerSampler());
+    auto result = new MeterValues(std::move(samples), connectorId, lastTransactionId);
+    clear(); //allocate new buffer
+    return result;
+}
+
+OcppMessage *ConnectorMeterValuesRecorder::takeMeterValuesNow() {
+
+    if (meterValuesSelection.samplers.empty()) {
+        return nullptr;
     }
 
+    MeterSampleBuffer sample_now {1, meterValuesSelection.columns};
+    takeSample(sample_now, meterValuesSelection);
+
     int txId_now = -1;
     auto connector = context.getConnectorStatus(connectorId);
     if (connector) {
         txId_now = connector->getTransactionId();
     }
 
-    return new MeterValues(&t_now, &e_now, &p_now, connectorId, txId_now);
+    return new MeterValues(std::move(sample_now), connectorId, txId_now);
 }
 
 void ConnectorMeterValuesRecorder::clear() {
-    sampleTimestamp.clear();
-    energy.clear();
-    power.clear();
+    pendingValues.clear(); //sample ids refer to the current buffer
+    if (samples.getCapacity() != getBufferCapacity() || samples.getColumns() != meterValuesSelection.columns) {
+        //buffer was handed over to a MeterValues message or MeterValuesSampledDataMaxLength / MeterValuesSampledData changed
+        samples = MeterSampleBuffer(getBufferCapacity(), meterValuesSelection.columns);
+    } else {
+        samples.clear();
+    }
 }
 
 void ConnectorMeterValuesRecorder::setPowerSampler(PowerSampler ps){
-  this->powerSampler = ps;
+    addMeterValueSampler(SampledData::POWER, ps);
 }
 
 void ConnectorMeterValuesRecorder::setEnergySampler(EnergySampler es){
-  this->energySampler = es;
+    addMeterValueSampler(SampledData::ENERGY, es);
+}
+
+void ConnectorMeterValuesRecorder::addMeterValueSampler(const MeasurandDescriptor& descriptor, MeasurandSampler sampler) {
+    if (!sampler) {
+        AO_DBG_ERR("invalid args");
+        return;
+    }
+    addSampler(descriptor, sampler, nullptr);
+}
+
+void ConnectorMeterValuesRecorder::addAsyncMeterValueSampler(const MeasurandDescriptor& descriptor, AsyncMeasurandSampler sampler) {
+    if (!sampler) {
+        AO_DBG_ERR("invalid args");
+        return;
+    }
+    auto async = std::make_shared<AsyncMeterSampler>(sampler);
+    addSampler(descriptor, [async] () {return async->getLatest();}, async);
+}
+
+void ConnectorMeterValuesRecorder::addSampler(const MeasurandDescriptor& descriptor, MeasurandSampler sampler, std::shared_ptr<AsyncMeterSampler> async) {
+    if (!descriptor.measurand || !descriptor.unit) {
+        AO_DBG_ERR("invalid args");
+        return;
+    }
+
+    for (auto& entry : samplers) {
+        if (SampledData::sameQuantity(entry.descriptor, descriptor)) {
+            entry.descriptor = descriptor;
+            entry.sample = sampler;
+            entry.async = async;
+            updateSelection();
+            return;
+        }
+    }
+
+    samplers.push_back(RegisteredSampler{descriptor, sampler, async});
+    updateSelection();
 }
 
 float ConnectorMeterValuesRecorder::readEnergyActiveImportRegister() {
-    if (energySampler != nullptr) {
-        return energySampler();
-    } else {
-        AO_DBG_DEBUG("Called readEnergyActiveImportRegister(), but no energySampler or handling strategy set");
-        return 0.f;
+    for (auto& entry : samplers) {
+        if (SampledData::sameQuantity(entry.descriptor, SampledData::ENERGY)) {
+            return entry.sample();
+        }
     }
+
+    AO_DBG_DEBUG("Called readEnergyActiveImportRegister(), but no energySampler or handling strategy set");
+    return 0.f;
 }
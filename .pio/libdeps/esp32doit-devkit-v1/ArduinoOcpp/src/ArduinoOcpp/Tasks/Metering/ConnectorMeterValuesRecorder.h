@@ -14,14 +14,26 @@
 #include <vector>
 
 #include <ArduinoOcpp/Core/ConfigurationKeyValue.h>
+#include <ArduinoOcpp/Tasks/Metering/MeterSampleBuffer.h>
+#include <ArduinoOcpp/Tasks/Metering/MeterAggregate.h>
+#include <ArduinoOcpp/Tasks/Metering/MeterReading.h>
+#include <ArduinoOcpp/Tasks/Metering/TransactionDataBuffer.h>
+
+#ifndef AO_METERVALUES_MAX_SAMPLES
+#define AO_METERVALUES_MAX_SAMPLES 50 //upper bound for MeterValuesSampledDataMaxLength; limits the buffer memory
+#endif
+
+#ifndef AO_METERVALUES_AGGREGATION_INTERVAL_MS
+#define AO_METERVALUES_AGGREGATION_INTERVAL_MS 1000 //internal sampling period for the clock-aligned data
+#endif
 
 namespace ArduinoOcpp {
 
 using PowerSampler = std::function<float()>;
 using EnergySampler = std::function<float()>;
+using MeasurandSampler = std::function<float()>;
 
 class OcppModel;
-class OcppTimestamp;
 class OcppMessage;
 
 class ConnectorMeterValuesRecorder {
@@ -30,24 +42,100 @@ private:
     
     const int connectorId;
 
-    std::vector<OcppTimestamp> sampleTimestamp;
-    std::vector<float> energy;
-    std::vector<float> power;
+    MeterSampleBuffer samples;
     ulong lastSampleTime = 0; //0 means not charging right now
     float lastPower;
     int lastTransactionId = -1;
  
-    PowerSampler powerSampler = NULL;
-    EnergySampler energySampler = NULL;
-
-    std::shared_ptr<Configuration<int>> MeterValueSampleInterval = NULL;
-    std::shared_ptr<Configuration<int>> MeterValuesSampledDataMaxLength = NULL;
-
-    void takeSample();
+    struct RegisteredSampler {
+        MeasurandDescriptor descriptor;
+        MeasurandSampler sample; //for asynchronous samplers, this returns the most recent value
+        std::shared_ptr<AsyncMeterSampler> async; //nullptr for synchronous samplers
+    };
+    std::vector<RegisteredSampler> samplers; //registry of all available measurands
+    void addSampler(const MeasurandDescriptor& descriptor, MeasurandSampler sampler, std::shared_ptr<AsyncMeterSampler> async);
+
+    /*
+     * Values of asynchronous reads which the periodic samples are waiting for. The samples are timestamped when the
+     * read is requested and the values are filled in on completion. The samples are only sent when all reads have
+     * completed or timed out
+     */
+    struct PendingValue {
+        std::shared_ptr<MeterReading> reading;
+        uint32_t sampleId;
+        size_t column;
+        ulong requestTime;
+    };
+    std::vector<PendingValue> pendingValues;
+    void pollPendingValues();
+    void completePendingValues(); //fills the pending reads with the latest value of their sampler and drops them
+
+    /*
+     * Subset of the registry which is reported. The columns are in the same order as the sampler indices
+     */
+    struct SamplerSelection {
+        std::vector<size_t> samplers;
+        std::shared_ptr<const MeasurandColumns> columns;
+    };
+    SamplerSelection meterValuesSelection; //selected by MeterValuesSampledData
+    SamplerSelection stopTxnSelection; //selected by StopTxnSampledData
+    SamplerSelection alignedSelection; //selected by MeterValuesAlignedData
+    SamplerSelection stopTxnAlignedSelection; //selected by StopTxnAlignedData
+    SamplerSelection select(const char *measurandsCsl, bool integratePower = false);
+    void updateSelection();
+
+    std::shared_ptr<Configuration<const char*>> MeterValuesSampledData;
+    std::shared_ptr<Configuration<const char*>> StopTxnSampledData;
+    std::shared_ptr<Configuration<const char*>> MeterValuesAlignedData;
+    std::shared_ptr<Configuration<const char*>> StopTxnAlignedData;
+    int MeterValuesSampledDataObserver = -1;
+    int StopTxnSampledDataObserver = -1;
+    int MeterValuesAlignedDataObserver = -1;
+    int StopTxnAlignedDataObserver = -1;
+
+    /*
+     * Clock-aligned data: the aligned samplers are read every AO_METERVALUES_AGGREGATION_INTERVAL_MS and folded into
+     * one MeterAggregate per column. At each multiple of ClockAlignedDataInterval (wall-clock time), one sample with
+     * the aggregates is sent and the aggregation restarts
+     */
+    Configuration<int> *ClockAlignedDataInterval = nullptr;
+    int ClockAlignedDataIntervalObserver = -1;
+    int64_t alignedIntervalMs = 0; //cached ClockAlignedDataInterval; 0 means off
+    std::unique_ptr<MeterAggregate[]> alignedAggregates; //one per column of alignedSelection
+    std::shared_ptr<const MeasurandColumns> alignedAggregatesColumns; //columns which alignedAggregates belong to
+    int64_t alignedPeriod = -1; //number of the running interval since the epoch; -1 if not started
+    ulong lastAggregationTime = 0;
+    OcppMessage *alignedLoop();
+    void aggregate(int64_t timeMs);
+    OcppMessage *toAlignedMeterValues(int64_t endMs);
+
+    /*
+     * Transaction data: while a transaction is running, StopTxnSampledData is sampled every MeterValueSampleInterval
+     * and StopTxnAlignedData at each multiple of ClockAlignedDataInterval. StopTransaction takes the recorded data
+     */
+    std::unique_ptr<TransactionDataBuffer> stopTxnSampled; //nullptr if not recording
+    std::unique_ptr<TransactionDataBuffer> stopTxnAligned; //nullptr if not recording
+    bool stopTxnRecording = false;
+    ulong lastStopTxnSampleTime = 0;
+    int64_t stopTxnAlignedPeriod = -1;
+    void stopTxnLoop();
+    void takeTransactionSample(TransactionDataBuffer& buffer, const SamplerSelection& selection, const OcppTimestamp& timestamp);
+
+    Configuration<int> *MeterValueSampleInterval = nullptr;
+    Configuration<int> *MeterValuesSampledDataMaxLength = nullptr;
+    int MeterValueSampleIntervalObserver = -1;
+    int MeterValuesSampledDataMaxLengthObserver = -1;
+    ulong sampleIntervalMs = 0; //cached MeterValueSampleInterval; 0 means metering off
+    int sampledDataMaxLength = 0; //cached MeterValuesSampledDataMaxLength
+    void updateConfiguration();
+
+    size_t getBufferCapacity();
+    void takeSample(MeterSampleBuffer& buffer, const SamplerSelection& selection, bool deferAsync = false);
     OcppMessage *toMeterValues();
     void clear();
 public:
     ConnectorMeterValuesRecorder(OcppModel& context, int connectorId);
+    ~ConnectorMeterValuesRecorder();
 
     OcppMessage *loop();
 
@@ -55,9 +143,25 @@ public:
 
     void setEnergySampler(EnergySampler energySampler);
 
+    /*
+     * Registers a sampler for the measurand, phase and location of the descriptor, or replaces the sampler
+     * which was registered for them before. The strings of the descriptor must point to static storage. The
+     * sampler only contributes to MeterValues if its measurand is listed in MeterValuesSampledData
+     */
+    void addMeterValueSampler(const MeasurandDescriptor& descriptor, MeasurandSampler sampler);
+
+    //like addMeterValueSampler, but the sampler only starts the read and completes it later
+    void addAsyncMeterValueSampler(const MeasurandDescriptor& descriptor, AsyncMeasurandSampler sampler);
+
     float readEnergyActiveImportRegister();
 
     OcppMessage *takeMeterValuesNow();
+
+    /*
+     * Hands over the transaction data which has been recorded since the start of the current transaction and stops
+     * the recording. One buffer per kind of data (sampled, clock-aligned); empty buffers are omitted
+     */
+    std::vector<MeterSampleBuffer> takeStopTxnData();
 };
 
 } //end namespace ArduinoOcpp
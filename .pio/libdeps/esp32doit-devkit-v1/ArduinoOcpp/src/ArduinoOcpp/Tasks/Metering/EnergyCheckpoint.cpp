@@ -0,0 +1,152 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Tasks/Metering/EnergyCheckpoint.h>
+#include <ArduinoOcpp/Core/Checksum.h>
+#include <ArduinoOcpp/Debug.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#define ENERGYCHECKPOINT_FORMAT_VERSION 1
+#define ENERGYCHECKPOINT_RECORD_SIZE (1 + 4 + 8 + 4)
+#define ENERGYCHECKPOINT_FN_MAXSIZE (sizeof(AO_ENERGYCHECKPOINT_FN_PREFIX) + 24)
+
+using namespace ArduinoOcpp;
+
+EnergyCheckpoint::EnergyCheckpoint(std::shared_ptr<FilesystemAdapter> filesystem, int connectorId)
+        : filesystem(filesystem), connectorId(connectorId) {
+
+}
+
+bool EnergyCheckpoint::readSlot(int slot, uint32_t& sequence, double& energyWh) {
+    char fn [ENERGYCHECKPOINT_FN_MAXSIZE];
+    snprintf(fn, sizeof(fn), AO_ENERGYCHECKPOINT_FN_PREFIX "%i-%i", connectorId, slot);
+
+    auto file = filesystem->open(fn, "r");
+    if (!file) {
+        return false;
+    }
+
+    uint8_t record [ENERGYCHECKPOINT_RECORD_SIZE];
+    if (file->read(record, sizeof(record)) != sizeof(record) ||
+            record[0] != ENERGYCHECKPOINT_FORMAT_VERSION) {
+        AO_DBG_WARN("Discard invalid checkpoint %s", fn);
+        return false;
+    }
+
+    uint32_t crc = 0;
+    for (int i = 0; i < 4; i++) {
+        crc |= ((uint32_t) record[13 + i]) << (8 * i);
+    }
+    if (crc != crc32(record, 13)) {
+        AO_DBG_WARN("Discard corrupt checkpoint %s", fn);
+        return false;
+    }
+
+    sequence = 0;
+    for (int i = 0; i < 4; i++) {
+        sequence |= ((uint32_t) record[1 + i]) << (8 * i);
+    }
+    uint64_t energy_mWh = 0;
+    for (int i = 0; i < 8; i++) {
+        energy_mWh |= ((uint64_t) record[5 + i]) << (8 * i);
+    }
+    energyWh = (double) ((int64_t) energy_mWh) / 1000.;
+    return true;
+}
+
+bool EnergyCheckpoint::restore(double& energyWh) {
+    if (!filesystem) {
+        return false;
+    }
+
+    slot = -1;
+    for (int i = 0; i < AO_ENERGYCHECKPOINT_SLOTS; i++) {
+        uint32_t seq;
+        double energy;
+        if (readSlot(i, seq, energy) && (slot < 0 || seq > sequence)) {
+            slot = i;
+            sequence = seq;
+            storedEnergyWh = energy;
+        }
+    }
+
+    if (slot < 0) {
+        return false;
+    }
+
+    AO_DBG_INFO("Restored energy register of connector %i: %.3f Wh", connectorId, storedEnergyWh);
+    energyWh = storedEnergyWh;
+    return true;
+}
+
+bool EnergyCheckpoint::store(double energyWh) {
+    if (!filesystem) {
+        return false;
+    }
+
+    int nextSlot = (slot + 1) % AO_ENERGYCHECKPOINT_SLOTS;
+    uint32_t nextSequence = slot < 0 ? 0 : sequence + 1;
+    int64_t energy_mWh = llround(energyWh * 1000.);
+
+    uint8_t record [ENERGYCHECKPOINT_RECORD_SIZE];
+    record[0] = ENERGYCHECKPOINT_FORMAT_VERSION;
+    for (int i = 0; i < 4; i++) {
+        record[1 + i] = (uint8_t) (nextSequence >> (8 * i));
+    }
+    for (int i = 0; i < 8; i++) {
+        record[5 + i] = (uint8_t) (((uint64_t) energy_mWh) >> (8 * i));
+    }
+    uint32_t crc = crc32(record, 13);
+    for (int i = 0; i < 4; i++) {
+        record[13 + i] = (uint8_t) (crc >> (8 * i));
+    }
+
+    char fn [ENERGYCHECKPOINT_FN_MAXSIZE];
+    snprintf(fn, sizeof(fn), AO_ENERGYCHECKPOINT_FN_PREFIX "%i-%i", connectorId, nextSlot);
+
+    auto file = filesystem->open(fn, "w");
+    if (!file) {
+        AO_DBG_ERR("Cannot open %s", fn);
+        return false;
+    }
+    if (file->write(record, sizeof(record)) != sizeof(record)) {
+        AO_DBG_ERR("Cannot write %s", fn);
+        return false;
+    }
+
+    slot = nextSlot;
+    sequence = nextSequence;
+    storedEnergyWh = energyWh;
+    return true;
+}
+
+void EnergyCheckpoint::storeReported(double energyWh) {
+    if (slot >= 0 && energyWh <= storedEnergyWh) {
+        return;
+    }
+
+    store(energyWh);
+    lastWriteTime = ao_tick_ms();
+}
+
+void EnergyCheckpoint::loop(double energyWh, bool charging) {
+    bool transactionBreak = charging != lastCharging;
+    lastCharging = charging;
+
+    if (!transactionBreak) {
+        if (energyWh - storedEnergyWh < AO_ENERGYCHECKPOINT_MIN_DELTA_WH && slot >= 0) {
+            return;
+        }
+
+        ulong interval = charging ? AO_ENERGYCHECKPOINT_INTERVAL_CHARGING_MS : AO_ENERGYCHECKPOINT_INTERVAL_IDLE_MS;
+        if (ao_tick_ms() - lastWriteTime < interval) {
+            return;
+        }
+    }
+
+    store(energyWh);
+    lastWriteTime = ao_tick_ms();
+}
@@ -0,0 +1,82 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef ENERGYCHECKPOINT_H
+#define ENERGYCHECKPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+
+#include <ArduinoOcpp/Core/FilesystemAdapter.h>
+#include <ArduinoOcpp/Platform.h>
+
+#ifndef AO_ENERGYCHECKPOINT_SLOTS
+#define AO_ENERGYCHECKPOINT_SLOTS 8 //number of files the checkpoints rotate through
+#endif
+
+#ifndef AO_ENERGYCHECKPOINT_INTERVAL_CHARGING_MS
+#define AO_ENERGYCHECKPOINT_INTERVAL_CHARGING_MS 60000 //checkpoint period during a transaction
+#endif
+
+#ifndef AO_ENERGYCHECKPOINT_INTERVAL_IDLE_MS
+#define AO_ENERGYCHECKPOINT_INTERVAL_IDLE_MS 900000 //checkpoint period outside of transactions
+#endif
+
+#ifndef AO_ENERGYCHECKPOINT_MIN_DELTA_WH
+#define AO_ENERGYCHECKPOINT_MIN_DELTA_WH 1.f //smaller changes of the energy register are not written
+#endif
+
+#define AO_ENERGYCHECKPOINT_FN_PREFIX "/ocpp-ecp-"
+
+namespace ArduinoOcpp {
+
+/*
+ * Keeps the energy register of a connector across reboots, for energy registers which are derived in software and
+ * start at 0 on every boot (see EnergyIntegrator).
+ *
+ * The register is written to a ring of AO_ENERGYCHECKPOINT_SLOTS files (AO_ENERGYCHECKPOINT_FN_PREFIX +
+ * "<connectorId>-<slot>"), one after the other, so that the flash wear is spread over the slots. Each record has a
+ * sequence number; on boot the valid record with the highest sequence number wins. A power loss while writing
+ * therefore only loses the record which is being written. Record layout (little-endian):
+ *
+ *     version (1 byte) | sequence number (4 bytes) | energy in mWh (8 bytes) | CRC-32 of the preceding bytes (4 bytes)
+ *
+ * A checkpoint is only written if the register has grown by at least AO_ENERGYCHECKPOINT_MIN_DELTA_WH, at most
+ * every AO_ENERGYCHECKPOINT_INTERVAL_CHARGING_MS during a transaction and every AO_ENERGYCHECKPOINT_INTERVAL_IDLE_MS
+ * otherwise. The start and end of a transaction are always checkpointed. Before a register value is sent to the CS,
+ * it is checkpointed as well (see storeReported()), so that the restored register never falls behind values which
+ * the CS already knows and meterStart stays monotonic across reboots.
+ */
+class EnergyCheckpoint {
+private:
+    std::shared_ptr<FilesystemAdapter> filesystem;
+    const int connectorId;
+
+    int slot = -1; //slot of the most recent record; -1 if there is none
+    uint32_t sequence = 0; //of the most recent record
+    double storedEnergyWh = 0.;
+    ulong lastWriteTime = 0;
+    bool lastCharging = false;
+
+    bool readSlot(int slot, uint32_t& sequence, double& energyWh);
+public:
+    EnergyCheckpoint(std::shared_ptr<FilesystemAdapter> filesystem, int connectorId);
+
+    /*
+     * Reads the most recent checkpoint. Returns false if there is none
+     */
+    bool restore(double& energyWh);
+
+    bool store(double energyWh);
+
+    //stores energyWh if it exceeds the last checkpoint. Call before the value is reported to the CS
+    void storeReported(double energyWh);
+
+    void loop(double energyWh, bool charging);
+};
+
+} //end namespace ArduinoOcpp
+
+#endif
@@ -0,0 +1,110 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Tasks/Metering/EnergyIntegrator.h>
+
+#include <math.h>
+
+using namespace ArduinoOcpp;
+
+namespace ArduinoOcpp {
+namespace Integration {
+
+const int64_t MW_MS_PER_WH = 3600LL * 1000LL * 1000LL;
+const ulong SIMPSON_MAX_STEP_MS = 2000; //bounds the intermediate products to 64 bits
+
+int64_t trapezoid(int32_t pa, int32_t pb, ulong dt) {
+    return ((int64_t) pa + (int64_t) pb) * (int64_t) dt / 2;
+}
+
+/*
+ * Simpson's rule for the steps h0 = t1 - t0 and h1 = t2 - t1 of unequal length:
+ *
+ *     (h0 + h1) / (6 h0 h1) * ((2 h0 - h1) h1 p0 + (h0 + h1)^2 p1 + (2 h1 - h0) h0 p2)
+ *
+ * For h0 = h1 = h this is h/3 * (p0 + 4 p1 + p2)
+ */
+int64_t simpson(int32_t p0, int32_t p1, int32_t p2, int64_t h0, int64_t h1) {
+    int64_t sum = (h0 + h1) * (h0 + h1) * p1
+            + (2 * h0 - h1) * h1 * p0
+            + (2 * h1 - h0) * h0 * p2;
+    int64_t div = 6 * h0 * h1;
+    return (sum / div) * (h0 + h1) + (sum % div) * (h0 + h1) / div;
+}
+
+bool simpsonApplicable(ulong h0, ulong h1) {
+    return h0 > 0 && h1 > 0 &&
+            h0 <= SIMPSON_MAX_STEP_MS && h1 <= SIMPSON_MAX_STEP_MS &&
+            h0 <= 2 * h1 && h1 <= 2 * h0; //otherwise the weights of p0 or p2 become negative
+}
+
+} //end namespace Integration
+} //end namespace ArduinoOcpp
+
+EnergyIntegrator::EnergyIntegrator(std::function<float()> powerSampler, ulong samplePeriodMs, IntegrationRule rule)
+        : powerSampler(powerSampler), samplePeriodMs(samplePeriodMs), rule(rule) {
+
+}
+
+int32_t EnergyIntegrator::readPower() {
+    float power = powerSampler ? powerSampler() : 0.f;
+    if (isnan(power) || power <= 0.f) {
+        return 0;
+    } else if (power >= (float) (INT32_MAX / 1000)) {
+        return INT32_MAX / 1000 * 1000;
+    }
+    return (int32_t) (power * 1000.f);
+}
+
+void EnergyIntegrator::loop() {
+    ulong now = ao_tick_ms();
+    if (started && now - lastSampleTime < samplePeriodMs) {
+        return;
+    }
+    lastSampleTime = now;
+
+    int32_t p = readPower();
+
+    if (!started) {
+        t0 = now;
+        p0 = p;
+        started = true;
+        return;
+    }
+
+    if (rule == IntegrationRule::Trapezoidal) {
+        energy += Integration::trapezoid(p0, p, now - t0);
+    } else if (!pending) {
+        //first step of a Simpson pair
+        t1 = now;
+        p1 = p;
+        pending = true;
+        return;
+    } else {
+        ulong h0 = t1 - t0;
+        ulong h1 = now - t1;
+        if (Integration::simpsonApplicable(h0, h1)) {
+            energy += Integration::simpson(p0, p1, p, h0, h1);
+        } else {
+            energy += Integration::trapezoid(p0, p1, h0);
+            energy += Integration::trapezoid(p1, p, h1);
+        }
+        pending = false;
+    }
+
+    t0 = now;
+    p0 = p;
+}
+
+void EnergyIntegrator::setEnergyWh(double energyWh) {
+    energy = llround(energyWh * 1000.) * (Integration::MW_MS_PER_WH / 1000);
+}
+
+float EnergyIntegrator::getEnergyWh() {
+    int64_t res = energy;
+    if (pending) {
+        res += Integration::trapezoid(p0, p1, t1 - t0);
+    }
+    return (float) (res / Integration::MW_MS_PER_WH) + (float) (res % Integration::MW_MS_PER_WH) / (float) Integration::MW_MS_PER_WH;
+}
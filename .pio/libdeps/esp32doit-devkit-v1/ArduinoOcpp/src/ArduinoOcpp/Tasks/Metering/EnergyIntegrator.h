@@ -0,0 +1,62 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef ENERGYINTEGRATOR_H
+#define ENERGYINTEGRATOR_H
+
+#include <stdint.h>
+#include <functional>
+
+#include <ArduinoOcpp/Platform.h>
+
+#ifndef AO_ENERGY_INTEGRATION_PERIOD_MS
+#define AO_ENERGY_INTEGRATION_PERIOD_MS 100 //default sampling period of the power when the energy is derived from it
+#endif
+
+namespace ArduinoOcpp {
+
+enum class IntegrationRule {
+    Trapezoidal,
+    Simpson
+};
+
+/*
+ * Derives an energy register from a power sampler for EVSEs without an energy meter. The power is read every
+ * samplePeriodMs (or on every loop() call if the loop is slower) and integrated in fixed point: power in mW times
+ * ms accumulates in a 64-bit register, so the resolution does not degrade with the register value like with a float
+ * register. Negative power readings count as 0.
+ *
+ * With Simpson's rule, two consecutive steps are integrated together, using the variant for unequal step lengths
+ * as the loop timing jitters. Pairs with very uneven or long steps fall back to the trapezoidal rule.
+ */
+class EnergyIntegrator {
+private:
+    std::function<float()> powerSampler; //in W
+    ulong samplePeriodMs;
+    IntegrationRule rule;
+
+    int64_t energy = 0; //in mW * ms, integrated up to t0
+
+    bool started = false;
+    ulong t0 = 0; //last sample which is integrated
+    int32_t p0 = 0; //in mW
+    bool pending = false; //if there is a sample which waits for the second step of a Simpson pair
+    ulong t1 = 0;
+    int32_t p1 = 0;
+    ulong lastSampleTime = 0;
+
+    int32_t readPower();
+public:
+    EnergyIntegrator(std::function<float()> powerSampler, ulong samplePeriodMs = AO_ENERGY_INTEGRATION_PERIOD_MS, IntegrationRule rule = IntegrationRule::Simpson);
+
+    void loop();
+
+    float getEnergyWh(); //energy since construction, including the last step
+
+    void setEnergyWh(double energyWh); //continue integrating from energyWh, e.g. after a reboot
+};
+
+} //end namespace ArduinoOcpp
+
+#endif
@@ -0,0 +1,42 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Tasks/Metering/MeterAggregate.h>
+
+using namespace ArduinoOcpp;
+
+void MeterAggregate::add(float value, int64_t timeMs) {
+    if (count == 0) {
+        min = value;
+        max = value;
+    } else {
+        if (value < min) min = value;
+        if (value > max) max = value;
+    }
+    sum += value;
+    count++;
+
+    if (hasLast && timeMs > lastMs) {
+        integral += 0.5 * ((double) last + (double) value) * (double) (timeMs - lastMs);
+    }
+    hasLast = true;
+    last = value;
+    lastMs = timeMs;
+}
+
+void MeterAggregate::closeAt(int64_t endMs) {
+    if (hasLast && endMs > lastMs) {
+        integral += (double) last * (double) (endMs - lastMs);
+        lastMs = endMs;
+    }
+}
+
+void MeterAggregate::restart(int64_t endMs) {
+    closeAt(endMs);
+    count = 0;
+    min = 0.f;
+    max = 0.f;
+    sum = 0.;
+    integral = 0.;
+}
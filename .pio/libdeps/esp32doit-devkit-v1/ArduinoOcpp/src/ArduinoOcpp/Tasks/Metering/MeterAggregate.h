@@ -0,0 +1,48 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef METERAGGREGATE_H
+#define METERAGGREGATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ArduinoOcpp {
+
+/*
+ * Running statistics of one measurand over one interval: min, max, average, the most recent value and the
+ * time integral (trapezoidal rule). Needs constant memory regardless of how many samples are added.
+ */
+class MeterAggregate {
+private:
+    size_t count = 0;
+    float min = 0.f;
+    float max = 0.f;
+    double sum = 0.;
+    double integral = 0.; //value * ms
+
+    bool hasLast = false;
+    float last = 0.f;
+    int64_t lastMs = 0;
+public:
+    void add(float value, int64_t timeMs);
+    void closeAt(int64_t endMs); //extends the integral to endMs with the most recent value
+
+    /*
+     * Ends the interval at endMs and starts the next one. The integral is extended to endMs with the most recent
+     * value, which also becomes the starting point of the integral of the next interval
+     */
+    void restart(int64_t endMs);
+
+    size_t getCount() const {return count;}
+    float getMin() const {return min;}
+    float getMax() const {return max;}
+    float getAverage() const {return count > 0 ? (float) (sum / count) : 0.f;}
+    float getLast() const {return last;}
+    float getIntegralHours() const {return (float) (integral / 3600000.);} //e.g. W -> Wh
+};
+
+} //end namespace ArduinoOcpp
+
+#endif
@@ -0,0 +1,416 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Tasks/Metering/MeterLog.h>
+#include <ArduinoOcpp/Core/Checksum.h>
+#include <ArduinoOcpp/Debug.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+#define METERLOG_FORMAT_VERSION 1
+#define METERLOG_HEADER_SIZE 7
+#define METERLOG_RECORD_MAXSIZE (1 + 5 + 5 + 10 + 10 + 10)
+#define METERLOG_FN_MAXSIZE (sizeof(AO_METERLOG_FN_PREFIX) + 10)
+
+#define METERLOG_FLAG_ENERGY 0x01
+#define METERLOG_FLAG_POWER  0x02
+#define METERLOG_FLAG_HEADER 0x04
+
+using namespace ArduinoOcpp;
+
+namespace ArduinoOcpp {
+namespace Varint {
+
+uint64_t zigzag(int64_t v) {
+    return (((uint64_t) v) << 1) ^ (uint64_t) (v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+    return (int64_t) (v >> 1) ^ -((int64_t) (v & 1));
+}
+
+size_t write(uint8_t *dst, uint64_t v) {
+    size_t len = 0;
+    while (v >= 0x80) {
+        dst[len++] = (uint8_t) (v | 0x80);
+        v >>= 7;
+    }
+    dst[len++] = (uint8_t) v;
+    return len;
+}
+
+bool read(const uint8_t *src, size_t size, size_t& pos, uint64_t& v) {
+    v = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        if (pos >= size) {
+            return false;
+        }
+        uint8_t b = src[pos++];
+        v |= ((uint64_t) (b & 0x7F)) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} //end namespace Varint
+
+namespace MeterLogFormat {
+
+const MeasurandDescriptor ENERGY = {"Energy.Active.Import.Register", "Wh", nullptr, nullptr};
+const MeasurandDescriptor POWER = {"Power.Active.Import", "W", nullptr, nullptr};
+
+struct Record {
+    int connectorId;
+    int transactionId;
+    int64_t timestampMs;
+    float energy; //NAN if missing
+    float power; //NAN if missing
+};
+
+//returns the column of samples with the same measurand, phase and location as descriptor or -1
+int findColumn(const MeterSampleBuffer& samples, const MeasurandDescriptor& descriptor) {
+    for (size_t i = 0; i < samples.getNumColumns(); i++) {
+        auto& column = samples.getColumn(i);
+        if (!strcmp(column.measurand, descriptor.measurand) && !column.phase && !column.location) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Encodes record relative to the previous record of the page and advances encoder. The first record of a page
+ * (pageStart) is encoded in full. Returns the record length or 0 if it exceeds size
+ */
+size_t encode(uint8_t *dst, size_t size, const Record& record, MeterLogEncoder& encoder, bool pageStart) {
+    uint8_t buf [METERLOG_RECORD_MAXSIZE];
+    uint8_t flags = 0;
+    size_t len = 1;
+    if (pageStart || record.connectorId != encoder.connectorId || record.transactionId != encoder.transactionId) {
+        flags |= METERLOG_FLAG_HEADER;
+        len += Varint::write(buf + len, (uint64_t) record.connectorId);
+        len += Varint::write(buf + len, Varint::zigzag(record.transactionId));
+    }
+    int64_t timestampMs = pageStart ? 0 : encoder.timestampMs;
+    len += Varint::write(buf + len, Varint::zigzag(record.timestampMs - timestampMs));
+    int64_t energyWh = 0;
+    if (!isnan(record.energy)) {
+        flags |= METERLOG_FLAG_ENERGY;
+        energyWh = llroundf(record.energy);
+        len += Varint::write(buf + len, Varint::zigzag(energyWh - (pageStart ? 0 : encoder.energy)));
+    }
+    if (!isnan(record.power)) {
+        flags |= METERLOG_FLAG_POWER;
+        len += Varint::write(buf + len, Varint::zigzag(llroundf(record.power)));
+    }
+    buf[0] = flags;
+
+    if (len > size) {
+        return 0;
+    }
+
+    memcpy(dst, buf, len);
+    if (pageStart) {
+        encoder = MeterLogEncoder();
+    }
+    encoder.connectorId = record.connectorId;
+    encoder.transactionId = record.transactionId;
+    encoder.timestampMs = record.timestampMs;
+    if (flags & METERLOG_FLAG_ENERGY) {
+        encoder.energy = energyWh;
+    }
+    return len;
+}
+
+bool decode(const uint8_t *payload, size_t size, std::vector<Record>& out) {
+    Record record {-1, -1, 0, NAN, NAN};
+    int64_t energy = 0;
+    size_t pos = 0;
+    while (pos < size) {
+        uint8_t flags = payload[pos++];
+        uint64_t v;
+        if (flags & METERLOG_FLAG_HEADER) {
+            if (!Varint::read(payload, size, pos, v)) return false;
+            record.connectorId = (int) v;
+            if (!Varint::read(payload, size, pos, v)) return false;
+            record.transactionId = (int) Varint::unzigzag(v);
+        }
+        if (!Varint::read(payload, size, pos, v)) return false;
+        record.timestampMs += Varint::unzigzag(v);
+        record.energy = NAN;
+        if (flags & METERLOG_FLAG_ENERGY) {
+            if (!Varint::read(payload, size, pos, v)) return false;
+            energy += Varint::unzigzag(v);
+            record.energy = (float) energy;
+        }
+        record.power = NAN;
+        if (flags & METERLOG_FLAG_POWER) {
+            if (!Varint::read(payload, size, pos, v)) return false;
+            record.power = (float) Varint::unzigzag(v);
+        }
+        out.push_back(record);
+    }
+    return true;
+}
+
+} //end namespace MeterLogFormat
+} //end namespace ArduinoOcpp
+
+MeterLog::MeterLog(std::shared_ptr<FilesystemAdapter> filesystem) : filesystem(filesystem) {
+    auto columns = std::make_shared<MeasurandColumns>();
+    columns->push_back(MeterLogFormat::ENERGY);
+    columns->push_back(MeterLogFormat::POWER);
+    this->columns = std::move(columns);
+
+    if (!filesystem) {
+        return;
+    }
+
+    //find the range of the stored pages. All of them are complete; appending continues on a new page
+    bool found = false;
+    unsigned int minPage = 0, maxPage = 0;
+    filesystem->forEachFile([&found, &minPage, &maxPage] (const char *path) {
+        const char *prefix = AO_METERLOG_FN_PREFIX + 1; //without leading '/'
+        const char *name = strstr(path, prefix);
+        if (!name) {
+            return;
+        }
+        unsigned int pageNr = (unsigned int) strtoul(name + strlen(prefix), nullptr, 10);
+        if (!found || pageNr < minPage) minPage = pageNr;
+        if (!found || pageNr > maxPage) maxPage = pageNr;
+        found = true;
+    });
+
+    if (found) {
+        headPage = minPage;
+        tailPage = maxPage + 1;
+        AO_DBG_INFO("Found %u pages of undelivered meter values", tailPage - headPage);
+    }
+}
+
+bool MeterLog::appendRecord(int connectorId, int transactionId, int64_t timestampMs, float energy, float power) {
+    MeterLogFormat::Record record {connectorId, transactionId, timestampMs, energy, power};
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t len = MeterLogFormat::encode(page + pageLen, AO_METERLOG_PAGE_SIZE - pageLen, record, tailEncoder, pageLen == 0);
+        if (len == 0) {
+            //page is full. The record is encoded again relative to the empty next page
+            sealPage();
+            continue;
+        }
+        pageLen += len;
+        return true;
+    }
+    return false;
+}
+
+void MeterLog::sealPage() {
+    if (pageLen == 0) {
+        return;
+    }
+    storePage(tailPage, page, pageLen);
+    tailPage++;
+    pageLen = 0;
+    tailEncoder = MeterLogEncoder();
+
+    while (tailPage - headPage >= AO_METERLOG_MAX_PAGES) {
+        AO_DBG_WARN("Meter log full. Drop oldest page");
+        dropHeadPage();
+    }
+}
+
+bool MeterLog::append(const MeterSampleBuffer& samples, int connectorId, int transactionId) {
+    int energyColumn = MeterLogFormat::findColumn(samples, MeterLogFormat::ENERGY);
+    int powerColumn = MeterLogFormat::findColumn(samples, MeterLogFormat::POWER);
+    if (energyColumn < 0 && powerColumn < 0) {
+        return false;
+    }
+
+    for (size_t i = 0; i < samples.size(); i++) {
+        float energy = energyColumn >= 0 ? samples.getValue(energyColumn, i) : NAN;
+        float power = powerColumn >= 0 ? samples.getValue(powerColumn, i) : NAN;
+        if (isnan(energy) && isnan(power)) {
+            continue;
+        }
+        if (!appendRecord(connectorId, transactionId, samples.getTimestamp(i).getEpochMs(), energy, power)) {
+            AO_DBG_ERR("Cannot encode record");
+            return false;
+        }
+    }
+
+    //persist the partially filled page so that the samples survive a reboot
+    return storePage(tailPage, page, pageLen);
+}
+
+bool MeterLog::storePage(unsigned int pageNr, const uint8_t *data, size_t len) {
+    if (!filesystem || len == 0) {
+        return false;
+    }
+
+    char fn [METERLOG_FN_MAXSIZE];
+    snprintf(fn, sizeof(fn), AO_METERLOG_FN_PREFIX "%u", pageNr);
+
+    uint8_t header [METERLOG_HEADER_SIZE];
+    uint32_t crc = crc32(data, len);
+    header[0] = METERLOG_FORMAT_VERSION;
+    header[1] = (uint8_t) len;
+    header[2] = (uint8_t) (len >> 8);
+    for (int i = 0; i < 4; i++) {
+        header[3 + i] = (uint8_t) (crc >> (8 * i));
+    }
+
+    auto file = filesystem->open(fn, "w");
+    if (!file) {
+        AO_DBG_ERR("Cannot open %s", fn);
+        return false;
+    }
+    bool success = file->write(header, sizeof(header)) == sizeof(header) &&
+                   file->write(data, len) == len;
+    if (!success) {
+        AO_DBG_ERR("Write error %s", fn);
+    }
+    return success;
+}
+
+bool MeterLog::loadPage(unsigned int pageNr, uint8_t *data, size_t *len) {
+    if (!filesystem) {
+        return false;
+    }
+
+    char fn [METERLOG_FN_MAXSIZE];
+    snprintf(fn, sizeof(fn), AO_METERLOG_FN_PREFIX "%u", pageNr);
+
+    auto file = filesystem->open(fn, "r");
+    if (!file) {
+        return false;
+    }
+
+    uint8_t header [METERLOG_HEADER_SIZE];
+    if (file->read(header, sizeof(header)) != sizeof(header) || header[0] != METERLOG_FORMAT_VERSION) {
+        return false;
+    }
+    size_t payloadLen = ((size_t) header[1]) | (((size_t) header[2]) << 8);
+    uint32_t crc = 0;
+    for (int i = 0; i < 4; i++) {
+        crc |= ((uint32_t) header[3 + i]) << (8 * i);
+    }
+    if (payloadLen > AO_METERLOG_PAGE_SIZE ||
+            file->read(data, payloadLen) != payloadLen ||
+            crc32(data, payloadLen) != crc) {
+        return false;
+    }
+    *len = payloadLen;
+    return true;
+}
+
+void MeterLog::dropHeadPage() {
+    if (filesystem) {
+        char fn [METERLOG_FN_MAXSIZE];
+        snprintf(fn, sizeof(fn), AO_METERLOG_FN_PREFIX "%u", headPage);
+        filesystem->remove(fn);
+    }
+    headPage++;
+    replaySeq++;
+    replayOffset = 0;
+    replayPageRecords = 0;
+}
+
+bool MeterLog::readBatch(MeterLogBatch& batch) {
+    if (headPage == tailPage) {
+        //only the page in progress is left. Close it so that its records can be sent
+        sealPage();
+    }
+
+    while (headPage != tailPage) {
+        uint8_t payload [AO_METERLOG_PAGE_SIZE];
+        size_t payloadLen = 0;
+        std::vector<MeterLogFormat::Record> records;
+
+        if (!loadPage(headPage, payload, &payloadLen) ||
+                !MeterLogFormat::decode(payload, payloadLen, records)) {
+            AO_DBG_ERR("Meter log page %u corrupted. Drop", headPage);
+            dropHeadPage();
+            continue;
+        }
+
+        if (replayOffset >= records.size()) {
+            dropHeadPage();
+            continue;
+        }
+        replayPageRecords = records.size();
+
+        auto& first = records[replayOffset];
+        size_t end = replayOffset + 1;
+        while (end < records.size() &&
+                records[end].connectorId == first.connectorId &&
+                records[end].transactionId == first.transactionId) {
+            end++;
+        }
+
+        batch.connectorId = first.connectorId;
+        batch.transactionId = first.transactionId;
+        batch.pageNr = headPage;
+        batch.seq = replaySeq;
+        batch.samples = MeterSampleBuffer(end - replayOffset, columns);
+        for (size_t i = replayOffset; i < end; i++) {
+            OcppTimestamp timestamp;
+            timestamp.setEpochMs(records[i].timestampMs);
+            batch.samples.push(timestamp);
+            if (!isnan(records[i].energy)) {
+                batch.samples.setValue(0, records[i].energy);
+            }
+            if (!isnan(records[i].power)) {
+                batch.samples.setValue(1, records[i].power);
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void MeterLog::commitBatch(unsigned int pageNr, uint32_t seq, size_t numSamples) {
+    if (headPage == tailPage || pageNr != headPage || seq != replaySeq) {
+        //e.g. the page was dropped because the log overflowed while the batch was in flight
+        AO_DBG_DEBUG("Meter log changed since batch was read. Ignore commit");
+        return;
+    }
+    replayOffset += numSamples;
+    replaySeq++;
+    if (replayOffset >= replayPageRecords) {
+        dropHeadPage();
+        return;
+    }
+
+    //rewrite the head page without the confirmed records
+    uint8_t payload [AO_METERLOG_PAGE_SIZE];
+    size_t payloadLen = 0;
+    std::vector<MeterLogFormat::Record> records;
+    if (!loadPage(headPage, payload, &payloadLen) ||
+            !MeterLogFormat::decode(payload, payloadLen, records)) {
+        return; //readBatch() drops the page
+    }
+
+    MeterLogEncoder encoder;
+    payloadLen = 0;
+    for (size_t i = replayOffset; i < records.size(); i++) {
+        size_t len = MeterLogFormat::encode(payload + payloadLen, sizeof(payload) - payloadLen, records[i], encoder, i == replayOffset);
+        if (len == 0) {
+            AO_DBG_WARN("Cannot rewrite meter log page. Keep progress in RAM");
+            return;
+        }
+        payloadLen += len;
+    }
+
+    if (storePage(headPage, payload, payloadLen)) {
+        replayPageRecords = records.size() - replayOffset;
+        replayOffset = 0;
+    }
+}
@@ -0,0 +1,110 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef METERLOG_H
+#define METERLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+
+#include <ArduinoOcpp/Core/FilesystemAdapter.h>
+#include <ArduinoOcpp/Tasks/Metering/MeterSampleBuffer.h>
+
+#ifndef AO_METERLOG_PAGE_SIZE
+#define AO_METERLOG_PAGE_SIZE 256 //payload bytes per page
+#endif
+
+#ifndef AO_METERLOG_MAX_PAGES
+#define AO_METERLOG_MAX_PAGES 64 //if the log is full, the oldest page is dropped
+#endif
+
+#define AO_METERLOG_FN_PREFIX "/ocpp-mlog-"
+
+namespace ArduinoOcpp {
+
+/*
+ * Consecutive logged samples of the same connector and transaction which can be sent in one MeterValues message
+ */
+struct MeterLogBatch {
+    int connectorId = -1;
+    int transactionId = -1;
+    MeterSampleBuffer samples;
+
+    //position in the log. Passed back to commitBatch() which ignores it if the log has changed meanwhile
+    unsigned int pageNr = 0;
+    uint32_t seq = 0;
+};
+
+/*
+ * Delta encoder state of a page: values of the previous record
+ */
+struct MeterLogEncoder {
+    int connectorId = -1;
+    int transactionId = -1;
+    int64_t timestampMs = 0;
+    int64_t energy = 0;
+};
+
+/*
+ * Persistent log for meter values which could not be delivered to the CS. Only the energy register and the power
+ * (Energy.Active.Import.Register and Power.Active.Import without phase / location) are logged.
+ *
+ * The log consists of pages of at most AO_METERLOG_PAGE_SIZE bytes, each stored in one file
+ * (AO_METERLOG_FN_PREFIX + page number). Records never span two pages and the delta encoding restarts on each
+ * page, so every page can be decoded on its own. Record layout:
+ *
+ *     flags (1 byte): bit 0: energy present, bit 1: power present, bit 2: connectorId and transactionId follow
+ *     [connectorId (varint), transactionId (zigzag varint)]
+ *     timestamp in ms (zigzag varint; delta to the previous record of the page)
+ *     [energy in Wh (zigzag varint; delta to the previous energy of the page)]
+ *     [power in W (zigzag varint)]
+ *
+ * A page file starts with a header: version (1 byte) | payload length (2 bytes) | CRC-32 of payload (4 bytes).
+ * With a 60s sample interval, a day of samples takes around 15kB.
+ */
+class MeterLog {
+private:
+    std::shared_ptr<FilesystemAdapter> filesystem;
+    std::shared_ptr<const MeasurandColumns> columns; //energy register and power
+
+    unsigned int headPage = 0; //oldest page
+    unsigned int tailPage = 0; //page which is being filled. Pages [headPage, tailPage) are complete
+
+    uint8_t page [AO_METERLOG_PAGE_SIZE];
+    size_t pageLen = 0;
+
+    MeterLogEncoder tailEncoder;
+
+    size_t replayOffset = 0; //records of the head page which have been confirmed by the CS. Only in RAM if the head page couldn't be rewritten
+    size_t replayPageRecords = 0;
+    uint32_t replaySeq = 0; //changes whenever records are removed from the head page
+
+    bool appendRecord(int connectorId, int transactionId, int64_t timestampMs, float energy, float power);
+    void sealPage();
+    bool storePage(unsigned int pageNr, const uint8_t *data, size_t len);
+    bool loadPage(unsigned int pageNr, uint8_t *data, size_t *len);
+    void dropHeadPage();
+public:
+    MeterLog(std::shared_ptr<FilesystemAdapter> filesystem);
+
+    //adds the energy and power values of the samples to the log. Other measurands are ignored
+    bool append(const MeterSampleBuffer& samples, int connectorId, int transactionId);
+
+    bool isEmpty() {return headPage == tailPage && pageLen == 0;}
+
+    //reads the oldest samples which have not been confirmed yet. Returns false if there are none
+    bool readBatch(MeterLogBatch& batch);
+
+    /*
+     * Removes the first numSamples samples, after the CS has confirmed the batch. pageNr and seq are taken from the
+     * MeterLogBatch. If the head page has been dropped or changed meanwhile, the commit is ignored. Confirmed records
+     * are removed from the page file, so they aren't sent again after a reboot
+     */
+    void commitBatch(unsigned int pageNr, uint32_t seq, size_t numSamples);
+};
+
+} //end namespace ArduinoOcpp
+
+#endif
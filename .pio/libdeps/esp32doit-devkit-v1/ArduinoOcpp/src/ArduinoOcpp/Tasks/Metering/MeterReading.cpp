@@ -0,0 +1,44 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Tasks/Metering/MeterReading.h>
+#include <ArduinoOcpp/Debug.h>
+
+#include <math.h>
+
+using namespace ArduinoOcpp;
+
+AsyncMeterSampler::AsyncMeterSampler(AsyncMeasurandSampler startRead) : startRead(startRead), lastValue(NAN) {
+
+}
+
+void AsyncMeterSampler::poll() {
+    if (!inFlight) {
+        return;
+    }
+    if (inFlight->isReady()) {
+        if (!isnan(inFlight->getValue())) {
+            lastValue = inFlight->getValue();
+        }
+        inFlight.reset();
+    } else if (ao_tick_ms() - inFlightSince >= AO_METER_READ_TIMEOUT_MS) {
+        AO_DBG_WARN("Meter read timeout");
+        inFlight.reset();
+    }
+}
+
+std::shared_ptr<MeterReading> AsyncMeterSampler::request() {
+    poll();
+    if (!inFlight && startRead) {
+        inFlight = startRead();
+        inFlightSince = ao_tick_ms();
+    }
+    return inFlight;
+}
+
+float AsyncMeterSampler::getLatest() {
+    request();
+    poll(); //the read may have completed synchronously
+    return lastValue;
+}
@@ -0,0 +1,64 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef METERREADING_H
+#define METERREADING_H
+
+#include <functional>
+#include <memory>
+
+#include <ArduinoOcpp/Platform.h>
+
+#ifndef AO_METER_READ_TIMEOUT_MS
+#define AO_METER_READ_TIMEOUT_MS 5000 //asynchronous reads which take longer are discarded
+#endif
+
+namespace ArduinoOcpp {
+
+/*
+ * Result of an asynchronous meter read. The sampler returns it when it starts the read and calls complete() when
+ * the value is available, e.g. from its own loop or a bus driver callback. The library polls isReady()
+ */
+class MeterReading {
+private:
+    bool ready = false;
+    float value = 0.f;
+public:
+    void complete(float value) {this->value = value; ready = true;} //NAN if the read failed
+    bool isReady() const {return ready;}
+    float getValue() const {return value;}
+};
+
+/*
+ * Starts a meter read and returns immediately. Returns nullptr if no read could be started. To read several
+ * measurands with one bus transaction, the sampler can complete the MeterReadings of all of them at once
+ */
+using AsyncMeasurandSampler = std::function<std::shared_ptr<MeterReading>()>;
+
+/*
+ * Keeps track of the read in progress of an AsyncMeasurandSampler, so that there is at most one at a time
+ */
+class AsyncMeterSampler {
+private:
+    AsyncMeasurandSampler startRead;
+    std::shared_ptr<MeterReading> inFlight;
+    ulong inFlightSince = 0;
+    float lastValue;
+
+    void poll();
+public:
+    AsyncMeterSampler(AsyncMeasurandSampler startRead);
+
+    std::shared_ptr<MeterReading> request(); //returns the read in progress or starts a new one
+
+    /*
+     * Synchronous view for users which cannot wait: returns the most recent value which has been read (NAN if none)
+     * and starts a new read if none is in progress
+     */
+    float getLatest();
+};
+
+} //end namespace ArduinoOcpp
+
+#endif
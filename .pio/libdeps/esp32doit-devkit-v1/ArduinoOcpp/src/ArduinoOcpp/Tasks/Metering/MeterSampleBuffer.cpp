@@ -0,0 +1,102 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Tasks/Metering/MeterSampleBuffer.h>
+
+#include <math.h>
+
+using namespace ArduinoOcpp;
+
+MeterSampleBuffer::MeterSampleBuffer(size_t capacity, std::shared_ptr<const MeasurandColumns> columns)
+        : columns(columns), numColumns(columns ? columns->size() : 0), capacity(capacity) {
+    if (capacity > 0) {
+        timestamps = std::unique_ptr<int64_t[]>(new int64_t[capacity]);
+        if (numColumns > 0) {
+            values = std::unique_ptr<float[]>(new float[numColumns * capacity]);
+        }
+    }
+}
+
+MeterSampleBuffer::MeterSampleBuffer(MeterSampleBuffer&& other) {
+    *this = std::move(other);
+}
+
+MeterSampleBuffer& MeterSampleBuffer::operator=(MeterSampleBuffer&& other) {
+    columns = std::move(other.columns);
+    numColumns = other.numColumns;
+    capacity = other.capacity;
+    context = other.context;
+    head = other.head;
+    count = other.count;
+    pushCount = other.pushCount;
+    timestamps = std::move(other.timestamps);
+    values = std::move(other.values);
+
+    other.numColumns = 0;
+    other.capacity = 0;
+    other.head = 0;
+    other.count = 0;
+    return *this;
+}
+
+bool MeterSampleBuffer::push(const OcppTimestamp& timestamp) {
+    if (capacity == 0) {
+        return false;
+    }
+
+    size_t pos;
+    if (count < capacity) {
+        pos = position(count);
+        count++;
+    } else {
+        //overwrite oldest
+        pos = head;
+        head = (head + 1) % capacity;
+    }
+
+    pushCount++;
+    timestamps[pos] = timestamp.getEpochMs();
+    for (size_t column = 0; column < numColumns; column++) {
+        values[column * capacity + pos] = NAN;
+    }
+    return true;
+}
+
+void MeterSampleBuffer::setValue(size_t column, float value) {
+    if (count == 0 || column >= numColumns) {
+        return;
+    }
+    values[column * capacity + position(count - 1)] = value;
+}
+
+bool MeterSampleBuffer::setValueById(uint32_t sampleId, size_t column, float value) {
+    uint32_t age = pushCount - 1 - sampleId; //0 for the most recent sample
+    if (column >= numColumns || age >= count) {
+        return false;
+    }
+    values[column * capacity + position(count - 1 - age)] = value;
+    return true;
+}
+
+bool MeterSampleBuffer::isColumnComplete(size_t column) const {
+    if (column >= numColumns) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!hasValue(column, i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+OcppTimestamp MeterSampleBuffer::getTimestamp(size_t index) const {
+    OcppTimestamp res;
+    res.setEpochMs(timestamps[position(index)]);
+    return res;
+}
+
+bool MeterSampleBuffer::hasValue(size_t column, size_t index) const {
+    return !isnan(getValue(column, index));
+}
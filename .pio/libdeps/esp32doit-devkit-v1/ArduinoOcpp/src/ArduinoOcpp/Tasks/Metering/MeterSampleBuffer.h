@@ -0,0 +1,98 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef METERSAMPLEBUFFER_H
+#define METERSAMPLEBUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include <ArduinoOcpp/Core/OcppTime.h>
+
+namespace ArduinoOcpp {
+
+/*
+ * Describes one measured quantity. All strings must point to static storage (e.g. string literals)
+ */
+struct MeasurandDescriptor {
+    const char *measurand; //e.g. "Energy.Active.Import.Register"
+    const char *unit; //e.g. "Wh"
+    const char *phase; //e.g. "L1"; nullptr if the value is not phase-specific
+    const char *location; //e.g. "EV"; nullptr for the default location (Outlet)
+};
+
+using MeasurandColumns = std::vector<MeasurandDescriptor>;
+
+/*
+ * Fixed-capacity ring buffer of meter samples in columnar layout: one column with the timestamps (epoch ms)
+ * and one float column per measurand. All memory is allocated in the constructor. When full, the oldest
+ * sample is overwritten. A sample costs 8 bytes plus 4 bytes per column, so only the measurands which are actually
+ * reported should be columns.
+ *
+ * The column descriptors are shared with the owner of the sampler selection. If the selection changes, buffers
+ * which are still queued for sending keep the descriptors they were recorded with.
+ *
+ * Move-only, so that a MeterValues message can take over the recorded samples without copying them.
+ */
+class MeterSampleBuffer {
+private:
+    std::shared_ptr<const MeasurandColumns> columns;
+    size_t numColumns = 0;
+    size_t capacity = 0;
+    const char *context = nullptr; //ReadingContext of all samples, e.g. "Sample.Clock"; nullptr for the default (Sample.Periodic)
+
+    size_t head = 0; //position of the oldest sample
+    size_t count = 0;
+    uint32_t pushCount = 0; //number of samples pushed since construction; gives each sample an id
+
+    std::unique_ptr<int64_t[]> timestamps;
+    std::unique_ptr<float[]> values; //values[column * capacity + position]
+
+    size_t position(size_t index) const {return (head + index) % capacity;}
+public:
+    MeterSampleBuffer() = default;
+    MeterSampleBuffer(size_t capacity, std::shared_ptr<const MeasurandColumns> columns);
+
+    MeterSampleBuffer(MeterSampleBuffer&& other);
+    MeterSampleBuffer& operator=(MeterSampleBuffer&& other);
+
+    /*
+     * Appends a sample. All values of it are missing until set with setValue(). Returns false if the buffer
+     * has no capacity
+     */
+    bool push(const OcppTimestamp& timestamp);
+    void setValue(size_t column, float value); //value of the most recent sample
+
+    /*
+     * For values which arrive later than their sample was pushed (asynchronous reads). Sample ids stay valid
+     * until the sample is overwritten or the buffer is cleared. Returns false if the sample is not in the buffer anymore
+     */
+    uint32_t getLatestSampleId() const {return pushCount - 1;}
+    bool setValueById(uint32_t sampleId, size_t column, float value);
+
+    void clear() {head = 0; count = 0;} //keeps pushCount, so that ids of cleared samples become invalid
+
+    void setContext(const char *context) {this->context = context;} //context must point to static storage
+    const char *getContext() const {return context;}
+
+    size_t size() const {return count;}
+    size_t getCapacity() const {return capacity;}
+    bool isFull() const {return count >= capacity;}
+
+    size_t getNumColumns() const {return numColumns;}
+    const MeasurandDescriptor& getColumn(size_t column) const {return (*columns)[column];}
+    const std::shared_ptr<const MeasurandColumns>& getColumns() const {return columns;}
+    bool isColumnComplete(size_t column) const; //true if every sample has a value in this column
+
+    //index 0 is the oldest sample
+    OcppTimestamp getTimestamp(size_t index) const;
+    bool hasValue(size_t column, size_t index) const;
+    float getValue(size_t column, size_t index) const {return values[column * capacity + position(index)];}
+};
+
+} //end namespace ArduinoOcpp
+
+#endif
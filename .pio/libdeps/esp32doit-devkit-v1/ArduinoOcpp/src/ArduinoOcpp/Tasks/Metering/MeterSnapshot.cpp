@@ -0,0 +1,46 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Tasks/Metering/MeterSnapshot.h>
+#include <ArduinoOcpp/Debug.h>
+
+#include <math.h>
+
+using namespace ArduinoOcpp;
+
+MeterSnapshot::MeterSnapshot(size_t numChannels, BatchMeterSampler sampler)
+        : sampler(sampler), numChannels(numChannels) {
+    if (numChannels > 0) {
+        values = std::unique_ptr<float[]>(new float[numChannels]);
+        for (size_t i = 0; i < numChannels; i++) {
+            values[i] = NAN; //not read yet
+        }
+    }
+}
+
+void MeterSnapshot::refresh() {
+    upToDate = true; //also on failure: don't retry within the same loop
+    if (!sampler || !sampler(*this)) {
+        AO_DBG_WARN("Batch meter read failed. Keep previous values");
+    }
+}
+
+void MeterSnapshot::set(size_t channel, float value) {
+    if (channel >= numChannels) {
+        AO_DBG_ERR("channel out of bounds");
+        return;
+    }
+    values[channel] = value;
+}
+
+float MeterSnapshot::get(size_t channel) {
+    if (channel >= numChannels) {
+        AO_DBG_ERR("channel out of bounds");
+        return NAN;
+    }
+    if (!upToDate) {
+        refresh();
+    }
+    return values[channel];
+}
@@ -0,0 +1,57 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef METERSNAPSHOT_H
+#define METERSNAPSHOT_H
+
+#include <stddef.h>
+#include <functional>
+#include <memory>
+
+#include <ArduinoOcpp/Tasks/Metering/MeterSampleBuffer.h>
+
+namespace ArduinoOcpp {
+
+/*
+ * One value which a batch meter read provides: the measurand and the connector it belongs to
+ */
+struct MeterChannel {
+    int connectorId;
+    MeasurandDescriptor descriptor;
+};
+
+class MeterSnapshot;
+
+/*
+ * Reads all channels from the meter hardware at once and stores them with MeterSnapshot::set(). Returns false if
+ * the read failed
+ */
+using BatchMeterSampler = std::function<bool(MeterSnapshot& snapshot)>;
+
+/*
+ * The most recent values of all channels of a batch meter. The recorders of all connectors read from the snapshot,
+ * so that the meter is read at most once per loop, no matter how many measurands and connectors are sampled. The
+ * snapshot is refreshed when a value is requested after invalidate(). If a read fails, the previous values are kept.
+ */
+class MeterSnapshot {
+private:
+    BatchMeterSampler sampler;
+    std::unique_ptr<float[]> values;
+    size_t numChannels = 0;
+    bool upToDate = false;
+
+    void refresh();
+public:
+    MeterSnapshot(size_t numChannels, BatchMeterSampler sampler);
+
+    void set(size_t channel, float value); //for the BatchMeterSampler
+    size_t size() const {return numChannels;}
+
+    float get(size_t channel); //reads the meter if the snapshot is outdated
+    void invalidate() {upToDate = false;} //at the beginning of each loop
+};
+
+} //end namespace ArduinoOcpp
+
+#endif
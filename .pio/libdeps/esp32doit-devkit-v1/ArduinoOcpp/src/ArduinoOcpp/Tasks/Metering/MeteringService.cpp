@@ -4,29 +4,115 @@
 
 #include <ArduinoOcpp/Tasks/Metering/MeteringService.h>
 #include <ArduinoOcpp/Core/OcppEngine.h>
+#include <ArduinoOcpp/Core/OcppModel.h>
+#include <ArduinoOcpp/Tasks/ChargePointStatus/ChargePointStatusService.h>
 #include <ArduinoOcpp/SimpleOcppOperationFactory.h>
+#include <ArduinoOcpp/MessagesV16/MeterValues.h>
 #include <ArduinoOcpp/Debug.h>
 
 using namespace ArduinoOcpp;
+using namespace ArduinoOcpp::Ocpp16;
 
-MeteringService::MeteringService(OcppEngine& context, int numConn)
-      : context(context) {
+MeteringService::MeteringService(OcppEngine& context, int numConn, std::shared_ptr<FilesystemAdapter> filesystem)
+      : context(context), filesystem(filesystem) {
 
     for (int i = 0; i < numConn; i++) {
         connectors.push_back(std::unique_ptr<ConnectorMeterValuesRecorder>(new ConnectorMeterValuesRecorder(context.getOcppModel(), i)));
     }
+    integrators.resize(numConn);
+    checkpoints.resize(numConn);
+
+    if (filesystem) {
+        meterLog = std::unique_ptr<MeterLog>(new MeterLog(filesystem));
+    }
 }
 
 void MeteringService::loop(){
 
+    if (snapshot) {
+        snapshot->invalidate();
+    }
+
+    for (size_t i = 0; i < integrators.size(); i++) {
+        if (integrators[i]) {
+            integrators[i]->loop();
+        }
+        if (integrators[i] && checkpoints[i]) {
+            auto connector = context.getOcppModel().getConnectorStatus(i);
+            bool charging = connector && connector->getTransactionId() >= 0;
+            checkpoints[i]->loop(integrators[i]->getEnergyWh(), charging);
+        }
+    }
+
     for (int i = 0; i < connectors.size(); i++){
         auto meterValuesMsg = connectors[i]->loop();
         if (meterValuesMsg != nullptr) {
+            checkpointReported(i);
             auto meterValues = makeOcppOperation(meterValuesMsg);
+            if (meterLog) {
+                auto msg = static_cast<MeterValues*>(meterValuesMsg); //recorders only create MeterValues
+                meterValues->setOnTimeoutListener([this, msg] () {
+                    AO_DBG_INFO("MeterValues timed out. Move to meter log");
+                    meterLog->append(msg->getSamples(), msg->getConnectorId(), msg->getTransactionId());
+                });
+            }
             meterValues->setTimeout(std::unique_ptr<Timeout>{new FixedTimeout(120000)});
             context.initiateOperation(std::move(meterValues));
         }
     }
+
+    replayLoop();
+}
+
+void MeteringService::replayLoop() {
+    if (!meterLog || replayInProgress || meterLog->isEmpty()) {
+        return;
+    }
+
+    if (replayBackoff && ao_tick_ms() - lastReplayAttempt < AO_METERLOG_RETRY_INTERVAL_MS) {
+        return;
+    }
+
+    MeterLogBatch batch;
+    if (!meterLog->readBatch(batch)) {
+        return;
+    }
+
+    size_t numSamples = batch.samples.size();
+    unsigned int pageNr = batch.pageNr;
+    uint32_t seq = batch.seq;
+    auto replay = makeOcppOperation(new MeterValues(std::move(batch.samples), batch.connectorId, batch.transactionId, true));
+    replay->setOnReceiveConfListener([this, pageNr, seq, numSamples] (JsonObject) {
+        meterLog->commitBatch(pageNr, seq, numSamples);
+        replayInProgress = false;
+        replayBackoff = false; //CS is reachable again. Continue with the next batch right away
+    });
+    replay->setOnReceiveErrorListener([this, pageNr, seq, numSamples] (const char*, const char*, JsonObject) {
+        AO_DBG_WARN("CS rejected logged MeterValues. Drop them");
+        meterLog->commitBatch(pageNr, seq, numSamples);
+        replayInProgress = false;
+        replayBackoff = false; //CS is reachable. The abort listener which follows must not back off
+    });
+    replay->setOnAbortListener([this] () {
+        if (!replayInProgress) {
+            return; //CS responded with CALLERROR, see above
+        }
+        replayInProgress = false;
+        replayBackoff = true;
+        lastReplayAttempt = ao_tick_ms();
+    });
+    replay->setTimeout(std::unique_ptr<Timeout>{new FixedTimeout(120000)});
+
+    replayInProgress = true;
+    lastReplayAttempt = ao_tick_ms();
+    context.initiateOperation(std::move(replay));
+}
+
+void MeteringService::checkpointReported(int connectorId) {
+    //the integrator only grows, so its current value covers all values which have been sampled so far
+    if (integrators[connectorId] && checkpoints[connectorId]) {
+        checkpoints[connectorId]->storeReported(integrators[connectorId]->getEnergyWh());
+    }
 }
 
 void MeteringService::setPowerSampler(int connectorId, PowerSampler ps){
@@ -45,12 +131,78 @@ void MeteringService::setEnergySampler(int connectorId, EnergySampler es){
     connectors[connectorId]->setEnergySampler(es);
 }
 
+void MeteringService::addMeterValueSampler(int connectorId, const MeasurandDescriptor& descriptor, MeasurandSampler sampler) {
+    if (connectorId < 0 || connectorId >= connectors.size()) {
+        AO_DBG_ERR("connectorId is out of bounds");
+        return;
+    }
+    connectors[connectorId]->addMeterValueSampler(descriptor, sampler);
+}
+
+void MeteringService::addAsyncMeterValueSampler(int connectorId, const MeasurandDescriptor& descriptor, AsyncMeasurandSampler sampler) {
+    if (connectorId < 0 || connectorId >= connectors.size()) {
+        AO_DBG_ERR("connectorId is out of bounds");
+        return;
+    }
+    connectors[connectorId]->addAsyncMeterValueSampler(descriptor, sampler);
+}
+
+void MeteringService::setBatchSampler(const MeterChannel *channels, size_t numChannels, BatchMeterSampler sampler) {
+    for (size_t i = 0; i < numChannels; i++) {
+        if (channels[i].connectorId < 0 || channels[i].connectorId >= connectors.size()) {
+            AO_DBG_ERR("connectorId of channel %u is out of bounds", (unsigned int) i);
+            return;
+        }
+    }
+
+    snapshot = std::make_shared<MeterSnapshot>(numChannels, sampler);
+    for (size_t i = 0; i < numChannels; i++) {
+        auto channelSnapshot = snapshot;
+        connectors[channels[i].connectorId]->addMeterValueSampler(channels[i].descriptor, [channelSnapshot, i] () {
+            return channelSnapshot->get(i);
+        });
+    }
+}
+
+void MeteringService::setIntegratedEnergySampler(int connectorId, PowerSampler ps, ulong samplePeriodMs, IntegrationRule rule) {
+    if (connectorId < 0 || connectorId >= connectors.size()) {
+        AO_DBG_ERR("connectorId is out of bounds");
+        return;
+    }
+    auto integrator = std::make_shared<EnergyIntegrator>(ps, samplePeriodMs, rule);
+    integrators[connectorId] = integrator;
+
+    if (filesystem) {
+        checkpoints[connectorId] = std::unique_ptr<EnergyCheckpoint>(new EnergyCheckpoint(filesystem, connectorId));
+        double energyWh;
+        if (checkpoints[connectorId]->restore(energyWh)) {
+            integrator->setEnergyWh(energyWh);
+        }
+    }
+
+    connectors[connectorId]->setPowerSampler(ps);
+    connectors[connectorId]->setEnergySampler([integrator] () {
+        return integrator->getEnergyWh();
+    });
+}
+
 float MeteringService::readEnergyActiveImportRegister(int connectorId) {
     if (connectorId < 0 || connectorId >= connectors.size()) {
         AO_DBG_ERR("connectorId is out of bounds");
         return 0.f;
     }
-    return connectors[connectorId]->readEnergyActiveImportRegister();
+    float energy = connectors[connectorId]->readEnergyActiveImportRegister();
+    checkpointReported(connectorId); //e.g. meterStart and meterStop
+    return energy;
+}
+
+std::vector<MeterSampleBuffer> MeteringService::takeStopTxnData(int connectorId) {
+    if (connectorId < 0 || connectorId >= connectors.size()) {
+        AO_DBG_ERR("connectorId is out of bounds");
+        return std::vector<MeterSampleBuffer>();
+    }
+    checkpointReported(connectorId);
+    return connectors[connectorId]->takeStopTxnData();
 }
 
 std::unique_ptr<OcppOperation> MeteringService::takeMeterValuesNow(int connectorId) {
@@ -62,6 +214,7 @@ std::unique_ptr<OcppOperation> MeteringService::takeMeterValuesNow(int connector
     if (connector.get()) {
         auto msg = connector->takeMeterValuesNow();
         if (msg) {
+            checkpointReported(connectorId);
             auto meterValues = makeOcppOperation(msg);
             meterValues->setTimeout(std::unique_ptr<Timeout>{new FixedTimeout(120000)});
             return meterValues;
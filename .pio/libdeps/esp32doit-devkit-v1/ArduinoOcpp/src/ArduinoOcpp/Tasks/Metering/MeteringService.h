@@ -10,6 +10,14 @@
 #include <memory>
 
 #include <ArduinoOcpp/Tasks/Metering/ConnectorMeterValuesRecorder.h>
+#include <ArduinoOcpp/Tasks/Metering/EnergyIntegrator.h>
+#include <ArduinoOcpp/Tasks/Metering/EnergyCheckpoint.h>
+#include <ArduinoOcpp/Tasks/Metering/MeterSnapshot.h>
+#include <ArduinoOcpp/Tasks/Metering/MeterLog.h>
+
+#ifndef AO_METERLOG_RETRY_INTERVAL_MS
+#define AO_METERLOG_RETRY_INTERVAL_MS 60000 //pause after a failed attempt to deliver logged meter values
+#endif
 
 namespace ArduinoOcpp {
 
@@ -24,8 +32,23 @@ private:
     OcppEngine& context;
 
     std::vector<std::unique_ptr<ConnectorMeterValuesRecorder>> connectors;
+    std::vector<std::shared_ptr<EnergyIntegrator>> integrators; //per connector; nullptr if the EVSE has an energy register
+    std::vector<std::unique_ptr<EnergyCheckpoint>> checkpoints; //per connector; persists the integrated energy register
+    std::shared_ptr<MeterSnapshot> snapshot; //nullptr if there is no batch sampler
+    void checkpointReported(int connectorId); //before an integrated register value is sent to the CS
+
+    /*
+     * MeterValues which time out (i.e. the CS was unreachable) go into the meter log. The log is replayed one batch
+     * at a time and a batch is removed after the CS confirmed it
+     */
+    std::shared_ptr<FilesystemAdapter> filesystem;
+    std::unique_ptr<MeterLog> meterLog; //nullptr if there is no filesystem
+    bool replayInProgress = false;
+    ulong lastReplayAttempt = 0;
+    bool replayBackoff = false;
+    void replayLoop();
 public:
-    MeteringService(OcppEngine& context, int numConnectors);
+    MeteringService(OcppEngine& context, int numConnectors, std::shared_ptr<FilesystemAdapter> filesystem = nullptr);
 
     void loop();
 
@@ -33,10 +56,30 @@ public:
 
     void setEnergySampler(int connectorId, EnergySampler energySampler);
 
+    void addMeterValueSampler(int connectorId, const MeasurandDescriptor& descriptor, MeasurandSampler sampler);
+
+    void addAsyncMeterValueSampler(int connectorId, const MeasurandDescriptor& descriptor, AsyncMeasurandSampler sampler);
+
+    /*
+     * Alternative to the per-measurand samplers for meters with slow reads (e.g. Modbus, UART): sampler reads all
+     * channels at once. Each channel is added as a sampler to its connector, like with addMeterValueSampler(), but
+     * reads its value from a shared snapshot which is filled at most once per loop
+     */
+    void setBatchSampler(const MeterChannel *channels, size_t numChannels, BatchMeterSampler sampler);
+
+    /*
+     * For EVSEs without energy register: sets powerSampler as power sampler and derives the energy register from it.
+     * The power is sampled every samplePeriodMs, independent from MeterValueSampleInterval. If there is a filesystem,
+     * the register is checkpointed and continues from its last value after a reboot
+     */
+    void setIntegratedEnergySampler(int connectorId, PowerSampler powerSampler, ulong samplePeriodMs = AO_ENERGY_INTEGRATION_PERIOD_MS, IntegrationRule rule = IntegrationRule::Simpson);
+
     float readEnergyActiveImportRegister(int connectorId);
 
     std::unique_ptr<OcppOperation> takeMeterValuesNow(int connectorId); //snapshot of all meters now
 
+    std::vector<MeterSampleBuffer> takeStopTxnData(int connectorId); //transactionData for StopTransaction
+
     int getNumConnectors() {return connectors.size();}
 };
 
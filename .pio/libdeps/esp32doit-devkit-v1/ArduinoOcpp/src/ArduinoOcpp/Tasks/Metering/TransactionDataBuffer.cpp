@@ -0,0 +1,105 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Tasks/Metering/TransactionDataBuffer.h>
+
+#include <string.h>
+#include <math.h>
+
+using namespace ArduinoOcpp;
+
+TransactionDataBuffer::TransactionDataBuffer(size_t capacity, std::shared_ptr<const MeasurandColumns> columns, const char *context)
+        : columns(columns), numColumns(columns ? columns->size() : 0), capacity(capacity & ~((size_t) 1)), context(context) {
+    if (this->capacity > 0) {
+        timestamps = std::unique_ptr<int64_t[]>(new int64_t[this->capacity]);
+        if (numColumns > 0) {
+            values = std::unique_ptr<float[]>(new float[numColumns * this->capacity]);
+            isRegister = std::unique_ptr<bool[]>(new bool[numColumns]);
+        }
+    }
+
+    const char *suffix = ".Register";
+    size_t suffix_len = strlen(suffix);
+    for (size_t column = 0; column < numColumns; column++) {
+        const char *measurand = (*columns)[column].measurand;
+        size_t len = strlen(measurand);
+        isRegister[column] = len >= suffix_len && !strcmp(measurand + len - suffix_len, suffix);
+    }
+}
+
+bool TransactionDataBuffer::push(const OcppTimestamp& timestamp) {
+    if (capacity == 0) {
+        return false;
+    }
+
+    if (count > 0 && accumulated < stride) {
+        //continue the most recent entry
+        accumulated++;
+        timestamps[count - 1] = timestamp.getEpochMs();
+        return true;
+    }
+
+    if (count >= capacity) {
+        decimate();
+    }
+
+    count++;
+    accumulated = 1;
+    timestamps[count - 1] = timestamp.getEpochMs();
+    for (size_t column = 0; column < numColumns; column++) {
+        values[(count - 1) * numColumns + column] = NAN;
+    }
+    return true;
+}
+
+void TransactionDataBuffer::addValue(size_t column, float value) {
+    if (count == 0 || column >= numColumns || isnan(value)) {
+        return;
+    }
+
+    float& entry = values[(count - 1) * numColumns + column];
+    if (isnan(entry) || isRegister[column]) {
+        entry = value;
+    } else {
+        entry += (value - entry) / (float) accumulated; //running average
+    }
+}
+
+void TransactionDataBuffer::decimate() {
+    //only called when full, i.e. all entries are complete and count is even
+    for (size_t i = 0; i < count / 2; i++) {
+        size_t older = 2 * i;
+        size_t newer = 2 * i + 1;
+        timestamps[i] = timestamps[newer];
+        for (size_t column = 0; column < numColumns; column++) {
+            float a = values[older * numColumns + column];
+            float b = values[newer * numColumns + column];
+            float merged;
+            if (isnan(a) || isRegister[column]) {
+                merged = isnan(b) ? a : b;
+            } else if (isnan(b)) {
+                merged = a;
+            } else {
+                merged = 0.5f * (a + b);
+            }
+            values[i * numColumns + column] = merged;
+        }
+    }
+    count /= 2;
+    stride *= 2;
+}
+
+MeterSampleBuffer TransactionDataBuffer::toSampleBuffer() const {
+    MeterSampleBuffer result {count, columns};
+    result.setContext(context);
+    for (size_t i = 0; i < count; i++) {
+        OcppTimestamp timestamp;
+        timestamp.setEpochMs(timestamps[i]);
+        result.push(timestamp);
+        for (size_t column = 0; column < numColumns; column++) {
+            result.setValue(column, values[i * numColumns + column]);
+        }
+    }
+    return result;
+}
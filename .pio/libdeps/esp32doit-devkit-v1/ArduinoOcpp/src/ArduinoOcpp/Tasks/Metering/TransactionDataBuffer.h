@@ -0,0 +1,62 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef TRANSACTIONDATABUFFER_H
+#define TRANSACTIONDATABUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+
+#include <ArduinoOcpp/Tasks/Metering/MeterSampleBuffer.h>
+
+#ifndef AO_STOPTXN_MAX_SAMPLES
+#define AO_STOPTXN_MAX_SAMPLES 24 //entries per transactionData buffer; rounded down to an even number
+#endif
+
+namespace ArduinoOcpp {
+
+/*
+ * Samples of one transaction for the transactionData of StopTransaction. The capacity is fixed, regardless of how
+ * long the transaction lasts: when the buffer is full, neighbouring entries are merged pairwise and from then on each
+ * entry takes twice as many samples. So the entries always cover the whole transaction at a uniform resolution.
+ *
+ * An entry is timestamped with its most recent sample. Registers (e.g. Energy.Active.Import.Register) keep the most
+ * recent value, all other measurands the average.
+ */
+class TransactionDataBuffer {
+private:
+    std::shared_ptr<const MeasurandColumns> columns;
+    size_t numColumns = 0;
+    size_t capacity = 0;
+    const char *context = nullptr;
+
+    size_t count = 0;
+    unsigned int stride = 1; //number of samples which make up one entry
+    unsigned int accumulated = 0; //number of samples in the most recent entry
+
+    std::unique_ptr<bool[]> isRegister; //per column
+    std::unique_ptr<int64_t[]> timestamps;
+    std::unique_ptr<float[]> values; //values[entry * numColumns + column]
+
+    void decimate();
+public:
+    TransactionDataBuffer(size_t capacity, std::shared_ptr<const MeasurandColumns> columns, const char *context = nullptr);
+
+    /*
+     * Adds a sample. Its values are added with addValue(). Returns false if the buffer has no capacity
+     */
+    bool push(const OcppTimestamp& timestamp);
+    void addValue(size_t column, float value); //value of the most recent sample
+
+    size_t size() const {return count;}
+    unsigned int getStride() const {return stride;}
+    const std::shared_ptr<const MeasurandColumns>& getColumns() const {return columns;}
+
+    MeterSampleBuffer toSampleBuffer() const; //copy of the entries for sending
+};
+
+} //end namespace ArduinoOcpp
+
+#endif
@@ -0,0 +1,50 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Tasks/SmartCharging/ChargingLimitTimeline.h>
+
+using namespace ArduinoOcpp;
+
+bool ChargingLimitTimeline::append(const OcppTimestamp& start, const OcppTimestamp& end, const ChargingLimit& limit) {
+    if (!periods.empty() && periods.back().end == start &&
+            periods.back().limit.power == limit.power &&
+            periods.back().limit.current == limit.current &&
+            periods.back().limit.numberPhases == limit.numberPhases) {
+        periods.back().end = end;
+        return true;
+    }
+
+    if (periods.size() >= maxPeriods) {
+        return false;
+    }
+
+    if (periods.capacity() == 0) {
+        periods.reserve(maxPeriods);
+    }
+
+    periods.push_back(LimitPeriod{start, end, limit});
+    return true;
+}
+
+bool ChargingLimitTimeline::covers(const OcppTimestamp& t) const {
+    return !periods.empty() && periods.front().start <= t && t < periods.back().end;
+}
+
+const LimitPeriod *ChargingLimitTimeline::find(const OcppTimestamp& t) const {
+    if (!covers(t)) {
+        return nullptr;
+    }
+
+    //last period which starts at or before t
+    size_t lo = 0, hi = periods.size();
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (periods[mid].start <= t) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return &periods[lo];
+}
@@ -0,0 +1,60 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef CHARGINGLIMITTIMELINE_H
+#define CHARGINGLIMITTIMELINE_H
+
+#include <stddef.h>
+#include <vector>
+
+#include <ArduinoOcpp/Core/OcppTime.h>
+#include <ArduinoOcpp/Tasks/SmartCharging/SmartChargingModel.h>
+
+#ifndef AO_LIMIT_TIMELINE_HORIZON
+#define AO_LIMIT_TIMELINE_HORIZON (24 * 3600) //in seconds. The timeline is compiled again when it is exceeded
+#endif
+
+#ifndef AO_LIMIT_TIMELINE_MAX_PERIODS
+#define AO_LIMIT_TIMELINE_MAX_PERIODS 48 //limits the memory of the timeline; a shorter timeline is compiled more often
+#endif
+
+namespace ArduinoOcpp {
+
+struct LimitPeriod {
+    OcppTimestamp start;
+    OcppTimestamp end; //exclusive
+    ChargingLimit limit;
+};
+
+/*
+ * The composite charging limit as a sequence of periods with constant limit, sorted by time and without gaps. The
+ * profiles only need to be evaluated once when compiling the timeline; then finding the limit at a point in time
+ * is a binary search, and the end of the period is the next change of the limit.
+ */
+class ChargingLimitTimeline {
+private:
+    std::vector<LimitPeriod> periods;
+    size_t maxPeriods;
+public:
+    ChargingLimitTimeline(size_t maxPeriods = AO_LIMIT_TIMELINE_MAX_PERIODS) : maxPeriods(maxPeriods) { }
+
+    void clear() {periods.clear();}
+
+    /*
+     * Appends the period [start, end). start must be the end of the last period. Merges it into the last period if
+     * the limit is the same. Returns false if the timeline is full
+     */
+    bool append(const OcppTimestamp& start, const OcppTimestamp& end, const ChargingLimit& limit);
+
+    bool covers(const OcppTimestamp& t) const;
+
+    const LimitPeriod *find(const OcppTimestamp& t) const; //nullptr if t is not covered
+
+    size_t size() const {return periods.size();}
+    const LimitPeriod& operator[](size_t i) const {return periods[i];}
+};
+
+} //end namespace ArduinoOcpp
+
+#endif
@@ -0,0 +1,421 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Tasks/SmartCharging/ChargingProfileStore.h>
+#include <ArduinoOcpp/Core/Checksum.h>
+#include <ArduinoOcpp/Debug.h>
+
+#include <string.h>
+#include <algorithm>
+
+#define PROFILESTORE_MAGIC "AOPS"
+#define PROFILESTORE_VERSION 1
+#define PROFILESTORE_HEADER_SIZE 8
+#define PROFILESTORE_ENTRY_SIZE 20
+#define PROFILESTORE_FLAG_USED 0x01
+#define PROFILESTORE_MAX_CAPACITY 4000 //of the JsonDocument of one profile
+#define PROFILESTORE_MIN_DEAD_BYTES 1024 //don't compact for less
+
+namespace ArduinoOcpp {
+namespace ProfileStoreFormat {
+
+void writeU16(std::vector<uint8_t>& out, uint16_t val) {
+    out.push_back((uint8_t) (val & 0xFF));
+    out.push_back((uint8_t) ((val >> 8) & 0xFF));
+}
+
+void writeU32(std::vector<uint8_t>& out, uint32_t val) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((uint8_t) ((val >> (8 * i)) & 0xFF));
+    }
+}
+
+uint16_t readU16(const uint8_t *buf) {
+    return (uint16_t) buf[0] | ((uint16_t) buf[1] << 8);
+}
+
+uint32_t readU32(const uint8_t *buf) {
+    return (uint32_t) buf[0] | ((uint32_t) buf[1] << 8) | ((uint32_t) buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
+
+} //end namespace ProfileStoreFormat
+} //end namespace ArduinoOcpp
+
+using namespace ArduinoOcpp;
+using namespace ArduinoOcpp::ProfileStoreFormat;
+
+ChargingProfileStore::ChargingProfileStore(std::shared_ptr<FilesystemAdapter> filesystem, const char *filename)
+        : filesystem(filesystem), filename(filename), filenameTmp(filename) {
+    filenameTmp += ".tmp";
+}
+
+bool ChargingProfileStore::exists() {
+    return filesystem->stat(filename.c_str()) || filesystem->stat(filenameTmp.c_str());
+}
+
+size_t ChargingProfileStore::getRecordsBegin(size_t capacity) {
+    return PROFILESTORE_HEADER_SIZE + capacity * PROFILESTORE_ENTRY_SIZE;
+}
+
+void ChargingProfileStore::encodeEntry(const Entry& entry, std::vector<uint8_t>& out) {
+    size_t begin = out.size();
+    out.push_back((uint8_t) entry.connectorId);
+    out.push_back((uint8_t) entry.purpose);
+    out.push_back((uint8_t) entry.stackLevel);
+    out.push_back(entry.used ? PROFILESTORE_FLAG_USED : 0);
+    writeU32(out, (uint32_t) entry.offset);
+    writeU16(out, (uint16_t) entry.length);
+    writeU16(out, (uint16_t) entry.capacity);
+    writeU32(out, entry.crc);
+    writeU32(out, crc32(out.data() + begin, out.size() - begin));
+}
+
+int ChargingProfileStore::findEntry(int connectorId, ChargingProfilePurposeType purpose, int stackLevel) {
+    for (size_t i = 0; i < directory.size(); i++) {
+        if (directory[i].used &&
+                directory[i].connectorId == connectorId &&
+                directory[i].purpose == purpose &&
+                directory[i].stackLevel == stackLevel) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+int ChargingProfileStore::findFreeEntry() {
+    for (size_t i = 0; i < directory.size(); i++) {
+        if (!directory[i].used) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+bool ChargingProfileStore::load(std::function<void(int connectorId, JsonObject profile)> onProfile) {
+    directory.clear();
+    fileEnd = 0;
+    liveBytes = 0;
+
+    if (filesystem->stat(filenameTmp.c_str())) {
+        if (filesystem->stat(filename.c_str())) {
+            filesystem->remove(filenameTmp.c_str()); //compaction was interrupted. The store is still the old one
+        } else {
+            filesystem->rename(filenameTmp.c_str(), filename.c_str()); //interrupted after removing the old store
+        }
+    }
+
+    size_t file_size = 0;
+    if (!filesystem->stat(filename.c_str(), &file_size)) {
+        AO_DBG_DEBUG("Create profile store");
+        return compact(AO_PROFILE_STORE_DIR_CAPACITY);
+    }
+
+    auto file = filesystem->open(filename.c_str(), "r");
+    if (!file) {
+        AO_DBG_ERR("Unable to open profile store");
+        return false;
+    }
+
+    uint8_t header [PROFILESTORE_HEADER_SIZE];
+    std::vector<uint8_t> dir;
+    bool valid = file->read(header, PROFILESTORE_HEADER_SIZE) == PROFILESTORE_HEADER_SIZE &&
+            !memcmp(header, PROFILESTORE_MAGIC, 4) &&
+            header[4] == PROFILESTORE_VERSION;
+    if (valid) {
+        dir.resize(readU16(header + 6) * PROFILESTORE_ENTRY_SIZE);
+        valid = file->read(dir.data(), dir.size()) == dir.size();
+    }
+
+    if (!valid) {
+        AO_DBG_ERR("Invalid profile store. Discard");
+        file.reset();
+        filesystem->remove(filename.c_str());
+        compact(AO_PROFILE_STORE_DIR_CAPACITY);
+        return false;
+    }
+
+    size_t capacity = dir.size() / PROFILESTORE_ENTRY_SIZE;
+    directory.resize(capacity);
+    fileEnd = file_size;
+
+    bool success = true;
+
+    std::vector<size_t> order;
+    std::vector<size_t> staleEntries;
+    for (size_t i = 0; i < capacity; i++) {
+        const uint8_t *e = dir.data() + i * PROFILESTORE_ENTRY_SIZE;
+        if (readU32(e + 16) != crc32(e, 16)) {
+            AO_DBG_ERR("Discard torn directory entry %zu", i);
+            success = false;
+            continue;
+        }
+        if (!(e[3] & PROFILESTORE_FLAG_USED)) {
+            continue;
+        }
+
+        Entry entry;
+        entry.used = true;
+        entry.connectorId = e[0];
+        entry.purpose = (ChargingProfilePurposeType) e[1];
+        entry.stackLevel = e[2];
+        entry.offset = readU32(e + 4);
+        entry.length = readU16(e + 8);
+        entry.capacity = readU16(e + 10);
+        entry.crc = readU32(e + 12);
+
+        if (entry.offset < getRecordsBegin(capacity) || entry.offset + entry.length > file_size) {
+            AO_DBG_ERR("Discard directory entry %zu: record out of file", i);
+            success = false;
+            continue;
+        }
+
+        int dup = findEntry(entry.connectorId, entry.purpose, entry.stackLevel);
+        if (dup >= 0) {
+            //an update was interrupted before it cleared the entry of the replaced record
+            AO_DBG_WARN("Profile store has two entries for the same profile. Take the newer one");
+            if (entry.offset < directory[dup].offset) {
+                staleEntries.push_back(i);
+                continue;
+            }
+            directory[dup].used = false;
+            order.erase(std::find(order.begin(), order.end(), (size_t) dup));
+            staleEntries.push_back((size_t) dup);
+        }
+
+        directory[i] = entry;
+        order.push_back(i);
+    }
+
+    //read the records in file order
+    std::sort(order.begin(), order.end(), [this] (size_t a, size_t b) {
+        return directory[a].offset < directory[b].offset;
+    });
+
+    std::vector<uint8_t> record;
+    for (size_t i : order) {
+        Entry& entry = directory[i];
+
+        record.resize(entry.length);
+        if (!file->seek(entry.offset) ||
+                file->read(record.data(), entry.length) != entry.length ||
+                crc32(record.data(), entry.length) != entry.crc) {
+            AO_DBG_ERR("Discard corrupt profile record %zu", i);
+            entry.used = false;
+            success = false;
+            continue;
+        }
+
+        size_t docCapacity = std::max(entry.capacity, (size_t) JSON_OBJECT_SIZE(1));
+        while (true) {
+            DynamicJsonDocument doc (docCapacity);
+            auto err = deserializeMsgPack(doc, (const char*) record.data(), entry.length);
+            if (err == DeserializationError::NoMemory && docCapacity < PROFILESTORE_MAX_CAPACITY) {
+                docCapacity = std::min(docCapacity * 3 / 2, (size_t) PROFILESTORE_MAX_CAPACITY);
+                continue;
+            }
+            if (err) {
+                AO_DBG_ERR("Discard profile record %zu: %s", i, err.c_str());
+                entry.used = false;
+                success = false;
+                break;
+            }
+
+            liveBytes += entry.length;
+            onProfile(entry.connectorId, doc.as<JsonObject>());
+            break;
+        }
+    }
+
+    if (!staleEntries.empty()) {
+        file.reset();
+        file = filesystem->open(filename.c_str(), "r+");
+        for (size_t i : staleEntries) {
+            if (!file || !writeEntry(*file, i)) {
+                success = false;
+            }
+        }
+    }
+
+    AO_DBG_DEBUG("Loaded %zu profiles from profile store", order.size());
+    return success;
+}
+
+bool ChargingProfileStore::store(int connectorId, ChargingProfilePurposeType purpose, int stackLevel, JsonObject profile) {
+
+    //copy the profile into a document of its own to learn the capacity which it needs when it is loaded again
+    DynamicJsonDocument doc (PROFILESTORE_MAX_CAPACITY);
+    doc.set(profile);
+    if (doc.overflowed()) {
+        AO_DBG_ERR("Profile exceeds PROFILESTORE_MAX_CAPACITY. Not stored");
+        return false;
+    }
+
+    size_t length = measureMsgPack(doc);
+    if (length == 0 || length > 0xFFFF) {
+        AO_DBG_ERR("Cannot store profile of size %zu", length);
+        return false;
+    }
+
+    std::vector<uint8_t> record (length);
+    if (serializeMsgPack(doc, record.data(), length) != length) {
+        AO_DBG_ERR("Could not serialize profile");
+        return false;
+    }
+
+    //compaction moves the entries, so look them up afterwards
+    size_t deadBytes = fileEnd - getRecordsBegin(directory.size()) - liveBytes;
+    if (deadBytes >= PROFILESTORE_MIN_DEAD_BYTES && deadBytes > liveBytes) {
+        if (!compact(directory.size())) {
+            return false;
+        }
+    }
+
+    //the new record gets a free entry, so that the entry of the replaced record stays valid until the update is complete
+    int replaced = findEntry(connectorId, purpose, stackLevel);
+    int index = findFreeEntry();
+    if (index < 0) {
+        //directory full
+        if (!compact(std::max(directory.size() * 2, (size_t) AO_PROFILE_STORE_DIR_CAPACITY))) {
+            return false;
+        }
+        replaced = findEntry(connectorId, purpose, stackLevel);
+        index = findFreeEntry();
+        if (index < 0) {
+            return false;
+        }
+    }
+
+    auto file = filesystem->open(filename.c_str(), "r+");
+    if (!file) {
+        AO_DBG_ERR("Unable to open profile store");
+        return false;
+    }
+
+    if (!file->seek(fileEnd) || file->write(record.data(), length) != length) {
+        AO_DBG_ERR("Could not write profile record");
+        return false;
+    }
+    fileEnd += length;
+
+    Entry& entry = directory[index];
+    entry.used = true;
+    entry.connectorId = connectorId;
+    entry.purpose = purpose;
+    entry.stackLevel = stackLevel;
+    entry.offset = fileEnd - length;
+    entry.length = length;
+    entry.capacity = doc.memoryUsage();
+    entry.crc = crc32(record.data(), length);
+    liveBytes += length;
+
+    if (!writeEntry(*file, index)) {
+        return false;
+    }
+
+    if (replaced >= 0) {
+        directory[replaced].used = false;
+        liveBytes -= directory[replaced].length;
+        return writeEntry(*file, replaced);
+    }
+    return true;
+}
+
+bool ChargingProfileStore::remove(int connectorId, ChargingProfilePurposeType purpose, int stackLevel) {
+    int index = findEntry(connectorId, purpose, stackLevel);
+    if (index < 0) {
+        return true;
+    }
+
+    directory[index].used = false;
+    liveBytes -= directory[index].length;
+
+    auto file = filesystem->open(filename.c_str(), "r+");
+    if (!file) {
+        AO_DBG_ERR("Unable to open profile store");
+        return false;
+    }
+    return writeEntry(*file, index);
+}
+
+bool ChargingProfileStore::writeEntry(FileAdapter& file, size_t index) {
+    std::vector<uint8_t> buf;
+    encodeEntry(directory[index], buf);
+    if (!file.seek(PROFILESTORE_HEADER_SIZE + index * PROFILESTORE_ENTRY_SIZE) ||
+            file.write(buf.data(), buf.size()) != buf.size()) {
+        AO_DBG_ERR("Could not write directory entry");
+        return false;
+    }
+    return true;
+}
+
+bool ChargingProfileStore::compact(size_t capacity) {
+    std::vector<Entry> compacted;
+    for (auto& entry : directory) {
+        if (entry.used) {
+            compacted.push_back(entry);
+        }
+    }
+    if (capacity < compacted.size()) {
+        capacity = compacted.size();
+    }
+
+    size_t offset = getRecordsBegin(capacity);
+    std::vector<uint8_t> buf;
+    buf.insert(buf.end(), PROFILESTORE_MAGIC, PROFILESTORE_MAGIC + 4);
+    buf.push_back(PROFILESTORE_VERSION);
+    buf.push_back(0);
+    writeU16(buf, (uint16_t) capacity);
+    for (size_t i = 0; i < capacity; i++) {
+        Entry entry;
+        if (i < compacted.size()) {
+            entry = compacted[i];
+            entry.offset = offset;
+            offset += entry.length;
+        }
+        encodeEntry(entry, buf);
+    }
+
+    auto tmp = filesystem->open(filenameTmp.c_str(), "w");
+    if (!tmp || tmp->write(buf.data(), buf.size()) != buf.size()) {
+        AO_DBG_ERR("Could not write %s", filenameTmp.c_str());
+        return false;
+    }
+
+    if (!compacted.empty()) {
+        auto file = filesystem->open(filename.c_str(), "r");
+        std::vector<uint8_t> record;
+        for (auto& entry : compacted) {
+            record.assign(entry.length, 0);
+            if (!file || !file->seek(entry.offset) || file->read(record.data(), entry.length) != entry.length) {
+                AO_DBG_ERR("Could not read profile record"); //the record CRC will not match when it is loaded
+            }
+            if (tmp->write(record.data(), entry.length) != entry.length) {
+                AO_DBG_ERR("Could not write %s", filenameTmp.c_str());
+                return false;
+            }
+        }
+    }
+
+    tmp.reset();
+    if (filesystem->stat(filename.c_str())) {
+        filesystem->remove(filename.c_str());
+    }
+    if (!filesystem->rename(filenameTmp.c_str(), filename.c_str())) {
+        AO_DBG_ERR("Could not rename %s", filenameTmp.c_str());
+        return false;
+    }
+
+    offset = getRecordsBegin(capacity);
+    directory.assign(capacity, Entry());
+    for (size_t i = 0; i < compacted.size(); i++) {
+        directory[i] = compacted[i];
+        directory[i].offset = offset;
+        offset += compacted[i].length;
+    }
+    fileEnd = offset;
+    liveBytes = offset - getRecordsBegin(capacity);
+
+    AO_DBG_DEBUG("Compacted profile store: %zu profiles, %zu bytes", compacted.size(), fileEnd);
+    return true;
+}
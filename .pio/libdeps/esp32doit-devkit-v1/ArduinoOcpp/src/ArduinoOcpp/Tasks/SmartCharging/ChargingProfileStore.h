@@ -0,0 +1,89 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef CHARGINGPROFILESTORE_H
+#define CHARGINGPROFILESTORE_H
+
+#include <ArduinoJson.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ArduinoOcpp/Tasks/SmartCharging/SmartChargingModel.h>
+#include <ArduinoOcpp/Core/FilesystemAdapter.h>
+
+#ifndef AO_PROFILE_STORE_FN
+#define AO_PROFILE_STORE_FN "/ocpp-profiles.bin"
+#endif
+
+#ifndef AO_PROFILE_STORE_DIR_CAPACITY
+#define AO_PROFILE_STORE_DIR_CAPACITY 16 //initial number of directory entries. The directory grows when it is full
+#endif
+
+namespace ArduinoOcpp {
+
+/*
+ * Keeps all charging profiles in one file. Layout (all integers little-endian):
+ *
+ *     header:    magic "AOPS" | format version (1 byte) | reserved (1 byte) | directory capacity (2 bytes)
+ *     directory: per entry: connectorId (1 byte) | purpose (1 byte) | stack level (1 byte) | flags (1 byte)
+ *                | record offset (4 bytes) | record length (2 bytes) | JsonDocument capacity (2 bytes)
+ *                | CRC-32 of record (4 bytes) | CRC-32 of the preceding entry bytes (4 bytes)
+ *     records:   the profiles as MessagePack
+ *
+ * On boot, the header and the directory are read at once and the records follow in file order. The capacity of
+ * the JsonDocument is known from the directory, so each record is parsed in one go.
+ *
+ * A profile update appends the new record, writes its entry into a free slot of the directory and only then clears
+ * the entry of the replaced record, so a power loss leaves either the old or the new profile. If both entries are
+ * still there on boot, the record which was appended last wins. Clearing a profile only overwrites its entry. The space of replaced
+ * records is reclaimed by rewriting the store into <filename>.tmp when it exceeds the size of the live records, or
+ * when the directory is full.
+ */
+class ChargingProfileStore {
+private:
+    struct Entry {
+        bool used = false;
+        int connectorId = 0;
+        ChargingProfilePurposeType purpose = ChargingProfilePurposeType::TxProfile;
+        int stackLevel = 0;
+        size_t offset = 0;
+        size_t length = 0;
+        size_t capacity = 0;
+        uint32_t crc = 0;
+    };
+
+    std::shared_ptr<FilesystemAdapter> filesystem;
+    std::string filename;
+    std::string filenameTmp;
+    std::vector<Entry> directory;
+    size_t fileEnd = 0;
+    size_t liveBytes = 0;
+
+    static void encodeEntry(const Entry& entry, std::vector<uint8_t>& out);
+    size_t getRecordsBegin(size_t capacity);
+    int findEntry(int connectorId, ChargingProfilePurposeType purpose, int stackLevel);
+    int findFreeEntry();
+    bool writeEntry(FileAdapter& file, size_t index);
+    bool compact(size_t capacity);
+
+public:
+    ChargingProfileStore(std::shared_ptr<FilesystemAdapter> filesystem, const char *filename = AO_PROFILE_STORE_FN);
+
+    bool exists(); //false if the profiles are still in the former format with one JSON file per profile
+
+    /*
+     * Reads all profiles and passes them to onProfile. Creates an empty store if there is none
+     */
+    bool load(std::function<void(int connectorId, JsonObject profile)> onProfile);
+
+    bool store(int connectorId, ChargingProfilePurposeType purpose, int stackLevel, JsonObject profile);
+
+    bool remove(int connectorId, ChargingProfilePurposeType purpose, int stackLevel);
+};
+
+} //end namespace ArduinoOcpp
+
+#endif
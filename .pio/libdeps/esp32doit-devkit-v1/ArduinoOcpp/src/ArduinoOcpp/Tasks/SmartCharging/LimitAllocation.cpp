@@ -0,0 +1,94 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Tasks/SmartCharging/LimitAllocation.h>
+
+#include <algorithm>
+
+using namespace ArduinoOcpp;
+
+namespace ArduinoOcpp {
+namespace LimitAllocation {
+
+/*
+ * Water-filling: distributes stationLimit proportionally to the weights, but never more than requested. The
+ * connectors which are capped hand their rest over to the others
+ */
+static void fill(float stationLimit, std::vector<ConnectorAllocation*>& active, std::function<float(const ConnectorAllocation&)> weight) {
+    float remaining = stationLimit;
+    std::vector<ConnectorAllocation*> open = active;
+
+    while (!open.empty()) {
+        float weightSum = 0.f;
+        for (auto c : open) {
+            weightSum += weight(*c);
+        }
+
+        auto share = [&] (const ConnectorAllocation& c) {
+            return weightSum > 0.f ? remaining * weight(c) / weightSum : remaining / open.size();
+        };
+
+        //cap the connectors which request less than their share. The shares of the others can only grow by that
+        float capped = 0.f;
+        auto uncapped = std::stable_partition(open.begin(), open.end(), [&] (const ConnectorAllocation *c) {
+            return c->requested <= share(*c);
+        });
+        for (auto c = open.begin(); c != uncapped; c++) {
+            (*c)->allocated = (*c)->requested;
+            capped += (*c)->requested;
+        }
+
+        if (uncapped == open.begin()) {
+            for (auto c : open) {
+                c->allocated = share(*c);
+            }
+            break;
+        }
+
+        open.erase(open.begin(), uncapped);
+        remaining -= capped;
+    }
+}
+
+static std::vector<ConnectorAllocation*> getActive(std::vector<ConnectorAllocation>& connectors) {
+    std::vector<ConnectorAllocation*> active;
+    for (auto& c : connectors) {
+        if (c.active) {
+            active.push_back(&c);
+        }
+    }
+    return active;
+}
+
+LimitAllocationPolicy equalShare() {
+    return [] (float stationLimit, std::vector<ConnectorAllocation>& connectors) {
+        auto active = getActive(connectors);
+        fill(stationLimit, active, [] (const ConnectorAllocation&) {return 1.f;});
+    };
+}
+
+LimitAllocationPolicy firstCome() {
+    return [] (float stationLimit, std::vector<ConnectorAllocation>& connectors) {
+        auto active = getActive(connectors);
+        std::stable_sort(active.begin(), active.end(), [] (const ConnectorAllocation *a, const ConnectorAllocation *b) {
+            return a->sessionStart < b->sessionStart;
+        });
+
+        float remaining = stationLimit;
+        for (auto c : active) {
+            c->allocated = std::min(c->requested, remaining);
+            remaining -= c->allocated;
+        }
+    };
+}
+
+LimitAllocationPolicy demandWeighted() {
+    return [] (float stationLimit, std::vector<ConnectorAllocation>& connectors) {
+        auto active = getActive(connectors);
+        fill(stationLimit, active, [] (const ConnectorAllocation& c) {return std::max(c.demand, 0.f);});
+    };
+}
+
+} //end namespace LimitAllocation
+} //end namespace ArduinoOcpp
@@ -0,0 +1,54 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef LIMITALLOCATION_H
+#define LIMITALLOCATION_H
+
+#include <functional>
+#include <vector>
+
+#include <ArduinoOcpp/Core/OcppTime.h>
+
+namespace ArduinoOcpp {
+
+struct ConnectorAllocation {
+    int connectorId;
+    bool active; //if a transaction is running on the connector
+    OcppTimestamp sessionStart; //begin of the transaction or MAX_TIME
+    float requested; //limit of the connector's own profiles in W. INFINITY if it has no profile
+    float demand; //power which the connector would draw in W
+    float allocated; //output in W. Preset to min(requested, station limit)
+};
+
+/*
+ * Splits the limit of the ChargePointMaxProfile between the connectors. The policy only needs to update the
+ * allocated limit of the active connectors; the sum of them must not exceed the station limit. Afterwards, the idle
+ * connectors get the headroom which the active ones leave, so that a starting transaction can charge before the
+ * next allocation without exceeding the station limit
+ */
+using LimitAllocationPolicy = std::function<void(float stationLimit, std::vector<ConnectorAllocation>& connectors)>;
+
+namespace LimitAllocation {
+
+/*
+ * Each active connector gets the same share. If a connector requests less than its share, the rest is split
+ * between the others
+ */
+LimitAllocationPolicy equalShare();
+
+/*
+ * The connectors are served in the order their transactions have started. A later connector only gets what the
+ * earlier ones leave over
+ */
+LimitAllocationPolicy firstCome();
+
+/*
+ * Like equalShare, but the shares are proportional to the demand of the connectors
+ */
+LimitAllocationPolicy demandWeighted();
+
+} //end namespace LimitAllocation
+} //end namespace ArduinoOcpp
+
+#endif
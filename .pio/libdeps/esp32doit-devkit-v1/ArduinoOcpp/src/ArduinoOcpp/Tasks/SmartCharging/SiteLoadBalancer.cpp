@@ -0,0 +1,173 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <ArduinoOcpp/Tasks/SmartCharging/SiteLoadBalancer.h>
+#include <ArduinoOcpp/Tasks/SmartCharging/SmartChargingService.h>
+#include <ArduinoOcpp/Platform.h>
+#include <ArduinoOcpp/Debug.h>
+
+#include <algorithm>
+
+using namespace ArduinoOcpp;
+
+SiteLoadBalancer::SiteLoadBalancer(float siteLimit) : siteLimit(siteLimit) {
+    allocationPolicy = LimitAllocation::equalShare();
+}
+
+void SiteLoadBalancer::setSiteLimit(float limit) {
+    siteLimit = limit;
+}
+
+void SiteLoadBalancer::setAllocationPolicy(LimitAllocationPolicy policy) {
+    allocationPolicy = policy;
+}
+
+size_t SiteLoadBalancer::addMember(std::function<float()> power, std::function<float()> demand, std::function<void(float)> applyLimit) {
+    SiteMember member;
+    member.power = power;
+    member.demand = demand;
+    member.applyLimit = applyLimit;
+    members.push_back(member);
+    return members.size() - 1;
+}
+
+size_t SiteLoadBalancer::addMember(SmartChargingService& smartChargingService, std::function<float()> power, std::function<float()> demand) {
+    SmartChargingService *scs = &smartChargingService;
+    return addMember(power, demand, [scs] (float limit) {
+        scs->setLocalChargePointMaxLimit(limit);
+    });
+}
+
+size_t SiteLoadBalancer::addRemoteMember(std::function<void(float)> applyLimit) {
+    SiteMember member;
+    member.applyLimit = applyLimit;
+    member.remote = true;
+    member.lastReport = ao_tick_ms();
+    members.push_back(member);
+    return members.size() - 1;
+}
+
+void SiteLoadBalancer::reportMember(size_t member, float power, float demand) {
+    if (member >= members.size() || !members[member].remote) {
+        AO_DBG_ERR("Not a remote site member: %u", (unsigned int) member);
+        return;
+    }
+    members[member].reportedPower = power;
+    members[member].reportedDemand = demand;
+    members[member].lastReport = ao_tick_ms();
+}
+
+float SiteLoadBalancer::getLimit(size_t member) const {
+    if (member >= members.size()) {
+        return -1.f;
+    }
+    return members[member].limit;
+}
+
+void SiteLoadBalancer::loop() {
+    if (ao_tick_ms() - lastBalancing >= AO_SITE_BALANCING_INTERVAL_MS) {
+        lastBalancing = ao_tick_ms();
+        balance();
+    }
+}
+
+void SiteLoadBalancer::balance() {
+    std::vector<ConnectorAllocation> allocation;
+    size_t nIdle = 0;
+
+    for (size_t i = 0; i < members.size(); i++) {
+        auto& member = members[i];
+
+        float demand = 0.f;
+        bool hasPower = false;
+        float power = 0.f;
+        if (member.remote) {
+            if (ao_tick_ms() - member.lastReport >= AO_SITE_REPORT_TIMEOUT_MS) {
+                if (!member.stale) {
+                    AO_DBG_WARN("Site member %u: reports are stale. Keep its last limit reserved", (unsigned int) i);
+                    member.stale = true;
+                }
+                demand = std::max(member.limit, 0.f);
+            } else {
+                member.stale = false;
+                demand = std::max(member.reportedDemand, 0.f);
+                hasPower = true;
+                power = member.reportedPower;
+            }
+        } else {
+            demand = member.demand ? std::max(member.demand(), 0.f) : 0.f;
+            if (member.power) {
+                hasPower = true;
+                power = member.power();
+            }
+        }
+
+        bool active = demand > 0.f;
+        if (active && !member.active) {
+            member.activationSeq = activationCounter++;
+        }
+        member.active = active;
+        if (!active) {
+            nIdle++;
+        }
+
+        float requested = demand;
+        if (hasPower) {
+            requested = std::min(requested, std::max(power, 0.f) + AO_SITE_POWER_HEADROOM);
+        }
+
+        //the policies only compare the session starts, so the activation order is enough
+        allocation.push_back(ConnectorAllocation{(int) i, active, MIN_TIME + (int) member.activationSeq, requested, demand, 0.f});
+    }
+
+    //idle members keep a start allowance, so that a member which derives its demand from the measured power can start
+    float allowance = 0.f;
+    if (nIdle > 0) {
+        allowance = std::min(AO_SITE_POWER_HEADROOM, std::max(siteLimit, 0.f) / members.size());
+    }
+    float activeLimit = siteLimit - nIdle * allowance;
+
+    if (allocationPolicy) {
+        allocationPolicy(activeLimit, allocation);
+    }
+
+    //spread the capacity which is left over by members below their demand
+    float used = 0.f;
+    int nActive = 0;
+    for (auto& a : allocation) {
+        if (a.active) {
+            used += a.allocated;
+            nActive++;
+        }
+    }
+    if (nActive > 0 && used < activeLimit) {
+        float extra = (activeLimit - used) / nActive;
+        for (auto& a : allocation) {
+            if (a.active) {
+                a.allocated = std::min(a.allocated + extra, a.demand);
+            }
+        }
+    }
+
+    //decrease before increase, so that the sum of the limits doesn't exceed the site limit in between
+    for (int pass = 0; pass < 2; pass++) {
+        for (auto& a : allocation) {
+            auto& member = members[a.connectorId];
+            float limit = a.active ? a.allocated : allowance;
+            if (limit == member.limit) {
+                continue;
+            }
+            bool decrease = member.limit < 0.f || limit < member.limit;
+            if (decrease != (pass == 0)) {
+                continue;
+            }
+
+            AO_DBG_DEBUG("Site member %d: limit = %f", a.connectorId, limit);
+            member.limit = limit;
+            if (member.applyLimit) {
+                member.applyLimit(limit);
+            }
+        }
+    }
+}
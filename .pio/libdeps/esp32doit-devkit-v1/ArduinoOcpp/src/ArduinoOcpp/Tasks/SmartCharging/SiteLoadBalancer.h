@@ -0,0 +1,87 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef SITELOADBALANCER_H
+#define SITELOADBALANCER_H
+
+#include <functional>
+#include <vector>
+
+#include <ArduinoOcpp/Tasks/SmartCharging/LimitAllocation.h>
+
+#ifndef AO_SITE_BALANCING_INTERVAL_MS
+#define AO_SITE_BALANCING_INTERVAL_MS 500
+#endif
+
+#ifndef AO_SITE_POWER_HEADROOM
+#define AO_SITE_POWER_HEADROOM 1500.f //in W. How much more than its measured power a member is allowed to draw in the next interval
+#endif
+
+#ifndef AO_SITE_REPORT_TIMEOUT_MS
+#define AO_SITE_REPORT_TIMEOUT_MS 5000 //reports of remote members which are older than this are stale
+#endif
+
+namespace ArduinoOcpp {
+
+class SmartChargingService;
+
+struct SiteMember {
+    std::function<float()> power; //measured power in W. Optional
+    std::function<float()> demand; //power which the member could draw now in W. 0 if no EV is charging
+    std::function<void(float)> applyLimit; //receives the allocated limit in W
+
+    bool remote = false; //power and demand come from reportMember() instead of the callbacks
+    float reportedPower = 0.f;
+    float reportedDemand = 0.f;
+    unsigned long lastReport = 0;
+    bool stale = false;
+
+    bool active = false;
+    unsigned int activationSeq = 0;
+    float limit = -1.f; //last applied limit
+};
+
+/*
+ * Shares one grid connection between several EVSEs. Each EVSE is a member which reports its measured power and its
+ * demand, and receives its share of the site limit. Members which draw less than their demand are limited to their
+ * measured power plus AO_SITE_POWER_HEADROOM, so that the others can use the rest. Capacity which is still left
+ * over is spread over all active members, so that they can ramp up. Idle members keep a start allowance of
+ * AO_SITE_POWER_HEADROOM, so that an EV can start to draw before its EVSE reports a demand.
+ *
+ * For the EVSEs of one process, addMember(SmartChargingService&, ...) applies the share as a local
+ * ChargePointMaxLimit. For EVSEs on the LAN, the integration forwards the limits over its own transport and passes
+ * the reports to reportMember(). If a remote member doesn't report for AO_SITE_REPORT_TIMEOUT_MS, it may still draw
+ * up to its last limit, so the balancer keeps that limit reserved until the reports resume.
+ *
+ * The limits are applied in two passes: first the decreases, then the increases.
+ */
+class SiteLoadBalancer {
+private:
+    float siteLimit;
+    LimitAllocationPolicy allocationPolicy;
+    std::vector<SiteMember> members;
+    unsigned int activationCounter = 0;
+    unsigned long lastBalancing = 0;
+
+public:
+    SiteLoadBalancer(float siteLimit); //in W
+
+    void setSiteLimit(float siteLimit);
+    void setAllocationPolicy(LimitAllocationPolicy policy); //default: LimitAllocation::equalShare()
+
+    size_t addMember(std::function<float()> power, std::function<float()> demand, std::function<void(float)> applyLimit); //returns the member index
+    size_t addMember(SmartChargingService& smartChargingService, std::function<float()> power, std::function<float()> demand);
+    size_t addRemoteMember(std::function<void(float)> applyLimit);
+
+    void reportMember(size_t member, float power, float demand); //latest measured power and demand of a remote member in W
+
+    float getLimit(size_t member) const; //-1 before the first allocation
+
+    void balance(); //allocate the site limit now
+    void loop(); //allocate every AO_SITE_BALANCING_INTERVAL_MS
+};
+
+} //end namespace ArduinoOcpp
+
+#endif
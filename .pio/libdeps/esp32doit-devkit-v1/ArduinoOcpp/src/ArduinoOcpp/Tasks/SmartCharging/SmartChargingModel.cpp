@@ -15,10 +15,10 @@ ChargingSchedulePeriod::ChargingSchedulePeriod(JsonObject &json){
     numberPhases = json["numberPhases"] | -1;
 }
 
-ChargingSchedulePeriod::ChargingSchedulePeriod(int startPeriod, float limit){
+ChargingSchedulePeriod::ChargingSchedulePeriod(int startPeriod, float limit, int numberPhases){
     this->startPeriod = startPeriod;
     this->limit = limit;
-    numberPhases = -1; //support later
+    this->numberPhases = numberPhases;
 }
 
 int ChargingSchedulePeriod::getStartPeriod(){
@@ -108,18 +108,18 @@ ChargingSchedule::ChargingSchedule(ChargingSchedule &other) {
     minChargingRate = other.minChargingRate;
 }
 
-ChargingSchedule::ChargingSchedule(const OcppTimestamp &startT, int duration) {
+ChargingSchedule::ChargingSchedule(const OcppTimestamp &startT, int duration, ChargingRateUnitType chargingRateUnit) {
     //create empty but valid Charging Schedule
     this->duration = duration;
     startSchedule = startT;
-    chargingRateUnit = ChargingRateUnitType::Watt;
+    this->chargingRateUnit = chargingRateUnit;
     //float minChargingRate = 0.f;
 
     chargingProfileKind = ChargingProfileKindType::Absolute; //copied from ChargingProfile to increase cohesion of limit inferencing methods
     recurrencyKind = RecurrencyKindType::NOT_SET; //copied from ChargingProfile to increase cohesion of limit inferencing methods
 }
 
-bool ChargingSchedule::inferenceLimit(const OcppTimestamp &t, const OcppTimestamp &startOfCharging, float *limit, OcppTimestamp *nextChange) {
+bool ChargingSchedule::inferenceLimit(const OcppTimestamp &t, const OcppTimestamp &startOfCharging, float *limit, OcppTimestamp *nextChange, int *numberPhases) {
     OcppTimestamp basis = OcppTimestamp(); //point in time to which schedule-related times are relative
     *nextChange = MAX_TIME; //defaulted to Infinity
     switch (chargingProfileKind) {
@@ -192,6 +192,7 @@ bool ChargingSchedule::inferenceLimit(const OcppTimestamp &t, const OcppTimestam
     * will remain the time determined before.
     */
     float limit_res = -1.0f; //If limit_res is still -1 after the loop, the inference process failed
+    int numberPhases_res = -1;
     for (auto period = chargingSchedulePeriod.begin(); period != chargingSchedulePeriod.end(); period++) {
         if ((*period)->getStartPeriod() > t_toBasis) {
             // found the first period that comes after t_toBasis.
@@ -199,11 +200,14 @@ bool ChargingSchedule::inferenceLimit(const OcppTimestamp &t, const OcppTimestam
             break; //The currently valid limit was set the iteration before
         }
         limit_res = (*period)->getLimit();
-
+        numberPhases_res = (*period)->getNumberPhases();
     }
     
     if (limit_res >= 0.0f) {
         *limit = std::max(limit_res, minChargingRate);
+        if (numberPhases) {
+            *numberPhases = numberPhases_res > 0 ? numberPhases_res : AO_DEFAULT_NUMBER_PHASES;
+        }
         return true;
     } else {
         return false; //No limit was found. Either there is no ChargingProfilePeriod, or each period begins after t_toBasis
@@ -334,8 +338,8 @@ ChargingProfile::ChargingProfile(JsonObject &json){
     chargingSchedule = std::unique_ptr<ChargingSchedule>(new ChargingSchedule(schedule, chargingProfileKind, recurrencyKind));
 }
 
-bool ChargingProfile::inferenceLimit(const OcppTimestamp &t, const OcppTimestamp &startOfCharging, float *limit, OcppTimestamp *nextChange){
-    if (t > validTo && validTo > MIN_TIME) {
+bool ChargingProfile::inferenceLimit(const OcppTimestamp &t, const OcppTimestamp &startOfCharging, float *limit, OcppTimestamp *nextChange, int *numberPhases){
+    if (t >= validTo && validTo > MIN_TIME) {
         *nextChange = MAX_TIME;
         return false; //no limit defined
     }
@@ -344,7 +348,11 @@ bool ChargingProfile::inferenceLimit(const OcppTimestamp &t, const OcppTimestamp
         return false; //no limit defined
     }
 
-    return chargingSchedule->inferenceLimit(t, startOfCharging, limit, nextChange);
+    bool defined = chargingSchedule->inferenceLimit(t, startOfCharging, limit, nextChange, numberPhases);
+    if (validTo > MIN_TIME && *nextChange > validTo) {
+        *nextChange = validTo; //the profile expires there
+    }
+    return defined;
 }
 
 bool ChargingProfile::inferenceLimit(const OcppTimestamp &t, float *limit, OcppTimestamp *nextChange){
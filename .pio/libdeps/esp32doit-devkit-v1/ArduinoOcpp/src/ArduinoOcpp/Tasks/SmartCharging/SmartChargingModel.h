@@ -35,6 +35,19 @@ enum class ChargingRateUnitType {
     Amp
 };
 
+#define AO_DEFAULT_NUMBER_PHASES 3 //OCPP 1.6: assumed if a ChargingSchedulePeriod doesn't set numberPhases
+
+/*
+ * Charging limit with its physical quantities. In a composed limit, power and current are upper bounds which apply
+ * both (INFINITY: not limited) and numberPhases is the maximum number of phases (-1: not limited). In the limit
+ * which is passed to the EVSE, they are the resulting values: power = current * phase voltage * numberPhases
+ */
+struct ChargingLimit {
+    float power; //in W, total of all phases
+    float current; //in A per phase
+    int numberPhases;
+};
+
 class ChargingSchedulePeriod {
 private:
     int startPeriod;
@@ -42,7 +55,7 @@ private:
     int numberPhases = -1;
 public:
     ChargingSchedulePeriod(JsonObject &json);
-    ChargingSchedulePeriod(int startPeriod, float limit);
+    ChargingSchedulePeriod(int startPeriod, float limit, int numberPhases = -1);
     int getStartPeriod();
     float getLimit();
     void scale(float factor);
@@ -64,20 +77,23 @@ private:
 public:
     ChargingSchedule(JsonObject &json, ChargingProfileKindType chargingProfileKind, RecurrencyKindType recurrencyKind);
     ChargingSchedule(ChargingSchedule &other);
-    ChargingSchedule(const OcppTimestamp &startSchedule, int duration);
+    ChargingSchedule(const OcppTimestamp &startSchedule, int duration, ChargingRateUnitType chargingRateUnit = ChargingRateUnitType::Watt);
 
     /**
      * limit: output parameter
      * nextChange: output parameter
+     * numberPhases: optional output parameter
      * 
      * returns if charging profile defines a limit at time t
-     *       if true, limit and nextChange will be set according to this Schedule
+     *       if true, limit, nextChange and numberPhases will be set according to this Schedule
      *       if false, only nextChange will be set
      */
-    bool inferenceLimit(const OcppTimestamp &t, const OcppTimestamp &startOfCharging, float *limit, OcppTimestamp *nextChange);
+    bool inferenceLimit(const OcppTimestamp &t, const OcppTimestamp &startOfCharging, float *limit, OcppTimestamp *nextChange, int *numberPhases = nullptr);
 
     bool addChargingSchedulePeriod(std::unique_ptr<ChargingSchedulePeriod> period);
 
+    ChargingRateUnitType getChargingRateUnit() {return chargingRateUnit;}
+
     void scale(float factor);
     void translate(float offset);
 
@@ -106,12 +122,13 @@ public:
     /**
      * limit: output parameter
      * nextChange: output parameter
+     * numberPhases: optional output parameter
      * 
      * returns if charging profile defines a limit at time t
-     *       if true, limit and nextChange will be set according to this Schedule
+     *       if true, limit, nextChange and numberPhases will be set according to this Schedule
      *       if false, only nextChange will be set
      */
-    bool inferenceLimit(const OcppTimestamp &t, const OcppTimestamp &startOfCharging, float *limit, OcppTimestamp *nextChange);
+    bool inferenceLimit(const OcppTimestamp &t, const OcppTimestamp &startOfCharging, float *limit, OcppTimestamp *nextChange, int *numberPhases = nullptr);
 
     /*
     * Simpler function if startOfCharging is not available. Caution: This likely will differ from inference with startOfCharging
@@ -129,6 +146,8 @@ public:
 
     int getChargingProfileId();
 
+    ChargingRateUnitType getChargingRateUnit() {return chargingSchedule->getChargingRateUnit();}
+
     /*
     * print on console
     */
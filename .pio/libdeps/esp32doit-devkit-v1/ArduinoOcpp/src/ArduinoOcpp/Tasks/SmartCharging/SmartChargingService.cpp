@@ -9,40 +9,71 @@
 #include <ArduinoOcpp/Core/Configuration.h>
 #include <ArduinoOcpp/Debug.h>
 
-#if defined(ESP32) && !defined(AO_DEACTIVATE_FLASH)
-#include <LITTLEFS.h>
-#define USE_FS LITTLEFS
-#else
-#include <FS.h>
-#define USE_FS SPIFFS
-#endif
-
-#define SINGLE_CONNECTOR_ID 1
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 #define PROFILE_FN_PREFIX "/ocpp-"
 #define PROFILE_FN_SUFFIX ".cnf"
-#define PROFILE_FN_MAXSIZE 30
+#define PROFILE_FN_MAXSIZE 32
 #define PROFILE_CUSTOM_CAPACITY 500
 #define PROFILE_MAX_CAPACITY 4000
 
+#ifndef AO_COMPOSITE_SCHEDULE_MAX_PERIODS
+#define AO_COMPOSITE_SCHEDULE_MAX_PERIODS 96
+#endif
+
 using namespace::ArduinoOcpp;
 
-SmartChargingService::SmartChargingService(OcppEngine& context, float chargeLimit, float V_eff, int numConnectors, FilesystemOpt filesystemOpt)
-      : context(context), DEFAULT_CHARGE_LIMIT{chargeLimit}, V_eff{V_eff}, filesystemOpt{filesystemOpt} {
-  
-    if (numConnectors > 2) {
-        AO_DBG_ERR("Only one connector supported at the moment");
+namespace ArduinoOcpp {
+namespace ScheduleMerger {
+
+struct Boundary {
+    OcppTimestamp t;
+    size_t profile; //index in the list of merged profiles
+    bool defined; //if the profile defines a limit from t on
+    float limit; //in the unit of the profile
+    int numberPhases;
+};
+
+struct ProfileState {
+    ChargingProfile *profile;
+    ChargingProfilePurposeType purpose;
+    bool defined;
+    float limit; //in the unit of the profile
+    int numberPhases;
+};
+
+static void applyProfileLimit(ChargingLimit &limit, const ProfileState &profile) {
+    if (profile.profile->getChargingRateUnit() == ChargingRateUnitType::Amp) {
+        limit.current = std::min(limit.current, profile.limit);
+    } else {
+        limit.power = std::min(limit.power, profile.limit);
     }
+    if (limit.numberPhases < 0 || profile.numberPhases < limit.numberPhases) {
+        limit.numberPhases = profile.numberPhases;
+    }
+}
+
+} //end namespace ScheduleMerger
+} //end namespace ArduinoOcpp
+
+SmartChargingService::SmartChargingService(OcppEngine& context, float chargeLimit, float V_eff, int numConnectors, std::shared_ptr<FilesystemAdapter> filesystem)
+      : context(context), DEFAULT_CHARGE_LIMIT{chargeLimit}, V_eff{V_eff}, filesystem{filesystem} {
     
-    limitBeforeChange = -1.0f;
     nextChange = MIN_TIME;
-    chargingSessionStart = MAX_TIME;
-    chargingSessionTransactionID = -1;
+    localChargePointMaxLimit = INFINITY;
+    if (filesystem) {
+        profileStore = std::unique_ptr<ChargingProfileStore>(new ChargingProfileStore(filesystem));
+    }
     for (int i = 0; i < CHARGEPROFILEMAXSTACKLEVEL; i++) {
         ChargePointMaxProfile[i] = NULL;
-        TxDefaultProfile[i] = NULL;
-        TxProfile[i] = NULL;
     }
+    for (int i = 0; i < numConnectors; i++) {
+        connectors.push_back(std::unique_ptr<SmartChargingConnector>(new SmartChargingConnector()));
+    }
+    allocationPolicy = LimitAllocation::equalShare();
+
     declareConfiguration<int>("ChargeProfileMaxStackLevel", CHARGEPROFILEMAXSTACKLEVEL, CONFIGURATION_VOLATILE, false, true, false, false);
 
     const char *fpId = "SmartCharging";
@@ -65,184 +96,424 @@ void SmartChargingService::loop(){
     /**
      * check if to call onLimitChange
      */
-    if (context.getOcppModel().getOcppTime().getOcppTimestampNow() >= nextChange){
-        auto& tNow = context.getOcppModel().getOcppTime().getOcppTimestampNow();
-        float limit = -1.0f;
-        OcppTimestamp validTo = OcppTimestamp();
-        inferenceLimit(tNow, &limit, &validTo);
+    auto& tNow = context.getOcppModel().getOcppTime().getOcppTimestampNow();
+    if (tNow >= nextChange){
+        std::vector<ChargingLimit> limits;
+        OcppTimestamp validTo = MAX_TIME;
+        allocateLimits(tNow, limits, &validTo);
 
-#if (AO_DBG_LEVEL >= AO_DL_INFO)
+#if (AO_DBG_LEVEL >= AO_DL_DEBUG)
         char timestamp1[JSONDATE_LENGTH + 1] = {'\0'};
         nextChange.toJsonString(timestamp1, JSONDATE_LENGTH + 1);
         char timestamp2[JSONDATE_LENGTH + 1] = {'\0'};
         validTo.toJsonString(timestamp2, JSONDATE_LENGTH + 1);
-        AO_DBG_INFO("New limit for connector 1, scheduled at = %s, nextChange = %s, limit = %f",
-                            timestamp1, timestamp2, limit);
+        AO_DBG_DEBUG("Allocated limits, scheduled at = %s, nextChange = %s", timestamp1, timestamp2);
 #endif
 
         nextChange = validTo;
-        if (limit != limitBeforeChange){
-            if (onLimitChange != NULL) {
-                onLimitChange(limit);
+
+        for (size_t connectorId = 1; connectorId < connectors.size(); connectorId++) {
+            auto& connector = *connectors[connectorId];
+            const ChargingLimit& limit = limits[connectorId];
+            bool powerChanged = limit.power != connector.limitBeforeChange.power;
+            if (powerChanged || limit.numberPhases != connector.limitBeforeChange.numberPhases) {
+                AO_DBG_INFO("New limit for connector %zu: %f W, %f A, %d phases", connectorId, limit.power, limit.current, limit.numberPhases);
+                if (powerChanged && connector.onLimitChange != NULL) {
+                    connector.onLimitChange(limit.power);
+                }
+                if (connector.onChargingLimitChange != NULL) {
+                    connector.onChargingLimitChange(limit);
+                }
             }
+            connector.limitBeforeChange = limit;
         }
-        limitBeforeChange = limit;
     }
 }
 
-float SmartChargingService::inferenceLimitNow(){
-    float limit = 0.0f;
-    OcppTimestamp validTo = OcppTimestamp(); //not needed
+float SmartChargingService::inferenceLimitNow(int connectorId){
+    return inferenceChargingLimitNow(connectorId).power;
+}
+
+ChargingLimit SmartChargingService::inferenceChargingLimitNow(int connectorId){
+    if (connectorId <= 0 || (size_t) connectorId >= connectors.size()) {
+        AO_DBG_ERR("Invalid connectorId");
+        return ChargingLimit{DEFAULT_CHARGE_LIMIT, DEFAULT_CHARGE_LIMIT / V_eff, 1};
+    }
+    std::vector<ChargingLimit> limits;
+    OcppTimestamp validTo = MAX_TIME; //not needed
     auto& tNow = context.getOcppModel().getOcppTime().getOcppTimestampNow();
-    inferenceLimit(tNow, &limit, &validTo);
-    return limit;
+    allocateLimits(tNow, limits, &validTo);
+    return limits[connectorId];
 }
 
 void SmartChargingService::setOnLimitChange(OnLimitChange onLtChg){
-    onLimitChange = onLtChg;
+    setOnLimitChange(1, onLtChg);
+}
+
+void SmartChargingService::setOnLimitChange(int connectorId, OnLimitChange onLtChg){
+    if (connectorId <= 0 || (size_t) connectorId >= connectors.size()) {
+        AO_DBG_ERR("Invalid connectorId");
+        return;
+    }
+    connectors[connectorId]->onLimitChange = onLtChg;
+}
+
+void SmartChargingService::setOnChargingLimitChange(int connectorId, OnChargingLimitChange onLtChg){
+    if (connectorId <= 0 || (size_t) connectorId >= connectors.size()) {
+        AO_DBG_ERR("Invalid connectorId");
+        return;
+    }
+    connectors[connectorId]->onChargingLimitChange = onLtChg;
+}
+
+void SmartChargingService::setSupplyPhases(int connectorId, int numberPhases, bool phaseSwitching) {
+    if (connectorId < 0 || (size_t) connectorId >= connectors.size()) {
+        AO_DBG_ERR("Invalid connectorId");
+        return;
+    }
+    if (numberPhases < 1 || numberPhases > 3) {
+        AO_DBG_ERR("Invalid number of phases");
+        return;
+    }
+    connectors[connectorId]->supplyPhases = numberPhases;
+    connectors[connectorId]->phaseSwitching = phaseSwitching && numberPhases > 1;
+    nextChange = context.getOcppModel().getOcppTime().getOcppTimestampNow();
 }
 
-/**
- * validToOutParam: The begin of the next SmartCharging restriction after time t. It is not taken into
- * account if the next Profile will be a prevailing one. If the profile at time t ends before any
- * other profile engages, the end of this profile will be written into validToOutParam.
+void SmartChargingService::setAllocationPolicy(LimitAllocationPolicy policy) {
+    allocationPolicy = policy;
+    nextChange = context.getOcppModel().getOcppTime().getOcppTimestampNow();
+}
+
+void SmartChargingService::setDemandSampler(int connectorId, std::function<float()> demand) {
+    if (connectorId <= 0 || (size_t) connectorId >= connectors.size()) {
+        AO_DBG_ERR("Invalid connectorId");
+        return;
+    }
+    connectors[connectorId]->demandSampler = demand;
+    nextChange = context.getOcppModel().getOcppTime().getOcppTimestampNow();
+}
+
+void SmartChargingService::setLocalChargePointMaxLimit(float limit) {
+    if (limit != localChargePointMaxLimit) {
+        localChargePointMaxLimit = limit;
+        nextChange = context.getOcppModel().getOcppTime().getOcppTimestampNow();
+    }
+}
+
+/*
+ * limits: the final limit of each connector, index is connectorId. validTo: the next time when one of the
+ * timelines changes, or when the demand should be sampled again. The allocation is done in W
  */
-void SmartChargingService::inferenceLimit(const OcppTimestamp &t, float *limitOutParam, OcppTimestamp *validToOutParam){
-    OcppTimestamp validToMin = MAX_TIME;
-    /*
-    * TxProfile rules over TxDefaultProfile. ChargePointMaxProfile rules over both of them
-    * 
-    * if (TxProfile is present)
-    *       take limit from TxProfile with the highest stackLevel
-    * else
-    *       take limit from TxDefaultProfile with the highest stackLevel
-    * take maximum from ChargePointMaxProfile with the highest stackLevel
-    * return minimum(limit, maximum from ChargePointMaxProfile)
-    */
-
-    //evaluate limit from TxProfiles
-    float limit_tx = 0.0f;
-    bool limit_defined_tx = false;
-    for (int i = CHARGEPROFILEMAXSTACKLEVEL - 1; i >= 0; i--){
-        if (TxProfile[i] == NULL) continue;
-        if (!TxProfile[i]->checkTransactionId(chargingSessionTransactionID)) continue;
-        OcppTimestamp nextChange = MAX_TIME;
-        limit_defined_tx = TxProfile[i]->inferenceLimit(t, chargingSessionStart, &limit_tx, &nextChange);
-        if (nextChange < validToMin)
-            validToMin = nextChange; //nextChange is always >= t here
-        if (limit_defined_tx) {
-            //The valid profile with the highest stack level is found. It prevails over any other so end this loop.
-            break;
+void SmartChargingService::allocateLimits(const OcppTimestamp &t, std::vector<ChargingLimit> &limits, OcppTimestamp *validTo) {
+    std::vector<ChargingLimit> connectorLimits (connectors.size(), ChargingLimit{INFINITY, INFINITY, -1});
+
+    ChargingLimit stationMax = {INFINITY, INFINITY, -1};
+    inferenceTimeline(0, t, &stationMax, validTo);
+    float stationLimit = std::min(toPower(0, stationMax), localChargePointMaxLimit);
+
+    std::vector<ConnectorAllocation> allocation;
+    bool demandSampled = false;
+
+    for (size_t connectorId = 1; connectorId < connectors.size(); connectorId++) {
+        auto& connector = *connectors[connectorId];
+
+        OcppTimestamp connectorValidTo = MAX_TIME;
+        inferenceTimeline(connectorId, t, &connectorLimits[connectorId], &connectorValidTo);
+        if (connectorValidTo < *validTo) {
+            *validTo = connectorValidTo;
         }
+
+        float requested = toPower(connectorId, connectorLimits[connectorId]);
+
+        float demand = std::isinf(requested) ? DEFAULT_CHARGE_LIMIT : requested;
+        if (connector.demandSampler) {
+            demand = connector.demandSampler();
+            demandSampled = true;
+        }
+
+        allocation.push_back(ConnectorAllocation{(int) connectorId,
+                connector.chargingSessionTransactionID >= 0,
+                connector.chargingSessionStart,
+                requested,
+                demand,
+                std::min(requested, stationLimit)});
     }
 
-    //evaluate limit from TxDefaultProfiles
-    float limit_txdef = 0.0f;
-    bool limit_defined_txdef = false;
-    for (int i = CHARGEPROFILEMAXSTACKLEVEL - 1; i >= 0; i--){
-        if (TxDefaultProfile[i] == NULL) continue;
-        //if (!TxDefaultProfile[i]->checkTransactionId(chargingSessionTransactionID)) continue; //this doesn't do anything on TxDefaultProfiles and could be deleted
-        OcppTimestamp nextChange = MAX_TIME;
-        limit_defined_txdef = TxDefaultProfile[i]->inferenceLimit(t, chargingSessionStart, &limit_txdef, &nextChange);
-        if (nextChange < validToMin)
-            validToMin = nextChange; //nextChange is always >= t here
-        if (limit_defined_txdef) {
-            //The valid profile with the highest stack level is found. It prevails over any other so end this loop.
-            break;
+    if (!std::isinf(stationLimit) && allocationPolicy) {
+        allocationPolicy(stationLimit, allocation);
+
+        float used = 0.f;
+        for (auto& connector : allocation) {
+            if (connector.active) {
+                used += connector.allocated;
+            }
+        }
+        float headroom = std::max(stationLimit - used, 0.f);
+        for (auto& connector : allocation) {
+            if (!connector.active) {
+                connector.allocated = std::min(connector.requested, headroom);
+            }
         }
     }
 
-    //evaluate limit from ChargePointMaxProfile
-    float limit_cpmax = 0.0f;
-    bool limit_defined_cpmax = false;
-    for (int i = CHARGEPROFILEMAXSTACKLEVEL - 1; i >= 0; i--){
-        if (ChargePointMaxProfile[i] == NULL) continue;
-        //if (!ChargePointMaxProfile[i]->checkTransactionId(chargingSessionTransactionID)) continue; //this doesn't do anything on ChargePointMaxProfiles and could be deleted
-        OcppTimestamp nextChange = MAX_TIME;
-        limit_defined_cpmax = ChargePointMaxProfile[i]->inferenceLimit(t, chargingSessionStart, &limit_cpmax, &nextChange);
-        if (nextChange < validToMin)
-            validToMin = nextChange; //nextChange is always >= t here
-        if (limit_defined_cpmax) {
-            //The valid profile with the highest stack level is found. It prevails over any other so end this loop.
-            break;
+    limits.resize(connectors.size());
+    for (auto& connector : allocation) {
+        ChargingLimit& limit = connectorLimits[connector.connectorId];
+        limit.power = std::min(limit.power, connector.allocated);
+        limits[connector.connectorId] = resolveLimit(connector.connectorId, limit);
+    }
+
+    if (demandSampled && t + AO_LIMIT_REALLOCATION_INTERVAL < *validTo) {
+        *validTo = t + AO_LIMIT_REALLOCATION_INTERVAL;
+    }
+}
+
+ChargingLimitTimeline *SmartChargingService::getTimeline(int connectorId) {
+    if (connectorId == 0) {
+        return &stationTimeline;
+    }
+    return &connectors[connectorId]->timeline;
+}
+
+void SmartChargingService::clearTimelines() {
+    stationTimeline.clear();
+    for (auto& connector : connectors) {
+        connector->timeline.clear();
+    }
+}
+
+void SmartChargingService::inferenceTimeline(int connectorId, const OcppTimestamp &t, ChargingLimit *limitOutParam, OcppTimestamp *validToOutParam){
+    auto timeline = getTimeline(connectorId);
+
+    if (!timeline->covers(t)) {
+        mergeProfiles(connectorId, false, t, t + AO_LIMIT_TIMELINE_HORIZON, *timeline);
+        AO_DBG_DEBUG("Compiled limit timeline of connector %d with %zu periods", connectorId, timeline->size());
+    }
+
+    if (auto period = timeline->find(t)) {
+        *limitOutParam = period->limit;
+        *validToOutParam = period->end;
+    } else {
+        AO_DBG_ERR("Could not compile limit timeline");
+        *limitOutParam = ChargingLimit{INFINITY, INFINITY, -1};
+        *validToOutParam = t + 1;
+    }
+}
+
+int SmartChargingService::getUsablePhases(int connectorId, const ChargingLimit &limit) {
+    int supplyPhases = connectors[connectorId]->supplyPhases;
+    if (limit.numberPhases > 0 && limit.numberPhases < supplyPhases) {
+        return limit.numberPhases;
+    }
+    return supplyPhases;
+}
+
+float SmartChargingService::toPower(int connectorId, const ChargingLimit &limit) {
+    return std::min(limit.power, limit.current * V_eff * getUsablePhases(connectorId, limit));
+}
+
+ChargingLimit SmartChargingService::resolveLimit(int connectorId, ChargingLimit limit) {
+    if (std::isinf(limit.power) && std::isinf(limit.current)) {
+        limit.power = DEFAULT_CHARGE_LIMIT;
+    }
+
+    limit.numberPhases = getUsablePhases(connectorId, limit);
+    float power = toPower(connectorId, limit);
+
+    /*
+     * A limit in W gives a higher current per phase on less phases, while a limit in A applies to each phase and
+     * only gets lower. Switch to 1 phase if the current on all phases is too low to charge and 1 phase allows more
+     */
+    if (connectors[connectorId]->phaseSwitching && limit.numberPhases > 1 &&
+            power / (V_eff * limit.numberPhases) < AO_MIN_CHARGING_CURRENT) {
+        float power1 = std::min(limit.power, limit.current * V_eff);
+        if (power1 > power / limit.numberPhases) {
+            limit.numberPhases = 1;
+            power = power1;
+        }
+    }
+
+    return ChargingLimit{power, power / (V_eff * limit.numberPhases), limit.numberPhases};
+}
+
+void SmartChargingService::mergeProfiles(int connectorId, bool withStationMax, const OcppTimestamp &from, const OcppTimestamp &to, ChargingLimitTimeline &out) {
+    using namespace ScheduleMerger;
+
+    out.clear();
+
+    int transactionId = -1;
+    OcppTimestamp sessionStart = MAX_TIME;
+    if (connectorId > 0) {
+        transactionId = connectors[connectorId]->chargingSessionTransactionID;
+        sessionStart = connectors[connectorId]->chargingSessionStart;
+    }
+
+    /*
+     * Ordered by precedence: within each purpose, the highest stack level first. The TxDefaultProfiles of the
+     * connector come before the TxDefaultProfiles of connector 0 which apply to all connectors
+     */
+    std::vector<ChargingProfile**> profileStacks;
+    if (connectorId > 0) {
+        profileStacks.push_back(connectors[connectorId]->TxProfile);
+        profileStacks.push_back(connectors[connectorId]->TxDefaultProfile);
+        profileStacks.push_back(connectors[0]->TxDefaultProfile);
+    }
+    if (connectorId == 0 || withStationMax) {
+        profileStacks.push_back(ChargePointMaxProfile);
+    }
+
+    std::vector<ProfileState> profiles;
+    for (ChargingProfile **profileStack : profileStacks) {
+        for (int i = CHARGEPROFILEMAXSTACKLEVEL - 1; i >= 0; i--) {
+            if (profileStack[i] == NULL) continue;
+            if (!profileStack[i]->checkTransactionId(transactionId)) continue;
+            profiles.push_back(ProfileState{profileStack[i], profileStack[i]->getChargingProfilePurpose(), false, 0.f, -1});
         }
     }
 
-    *validToOutParam = validToMin; //validTo output parameter has successfully been determined here
-
-    //choose which limit to set according to specification
-    bool applicable_profile_found = false;
-    if (limit_defined_txdef){
-        *limitOutParam = limit_txdef;
-        applicable_profile_found = true;
-    }
-    if (limit_defined_tx){
-        *limitOutParam = limit_tx;
-        applicable_profile_found = true;
-    }
-    if (limit_defined_cpmax){
-        //Warning: This block MUST be rewritten when multiple connector support is introduced
-        if (applicable_profile_found) {
-            if (limit_cpmax < *limitOutParam){
-                //TxProfile or TxDefaultProfile exceeds the maximum for the whole CP 
-                *limitOutParam = limit_cpmax;
-            } //else: TxProfile or TxDefaultProfile are within their boundary. Do nothing
-        } else {
-            //No TxProfile or TxDefaultProfile found. The limit is set to the maximum of the CP
-            *limitOutParam = limit_cpmax;
+    //collect the boundaries of each profile within [from, to)
+    std::vector<Boundary> boundaries;
+    for (size_t i = 0; i < profiles.size(); i++) {
+        OcppTimestamp t = from;
+        while (t < to) {
+            float limit = 0.f;
+            int numberPhases = -1;
+            OcppTimestamp nextChange = MAX_TIME;
+            bool defined = profiles[i].profile->inferenceLimit(t, sessionStart, &limit, &nextChange, &numberPhases);
+            boundaries.push_back(Boundary{t, i, defined, limit, numberPhases});
+            if (nextChange <= t) {
+                AO_DBG_ERR("Limit inference did not advance. Abort");
+                break;
+            }
+            t = nextChange;
         }
-        applicable_profile_found = true;
     }
-    if (!applicable_profile_found) {
-        *limitOutParam = DEFAULT_CHARGE_LIMIT;
+
+    std::stable_sort(boundaries.begin(), boundaries.end(), [] (const Boundary &a, const Boundary &b) {
+        return a.t < b.t;
+    });
+
+    //sweep
+    auto boundary = boundaries.begin();
+    OcppTimestamp periodBegin = from;
+    while (periodBegin < to) {
+        while (boundary != boundaries.end() && boundary->t <= periodBegin) {
+            profiles[boundary->profile].defined = boundary->defined;
+            profiles[boundary->profile].limit = boundary->limit;
+            profiles[boundary->profile].numberPhases = boundary->numberPhases;
+            boundary++;
+        }
+        OcppTimestamp periodEnd = boundary != boundaries.end() ? boundary->t : to;
+
+        /*
+         * TxProfile rules over TxDefaultProfile. ChargePointMaxProfile rules over both of them. Within each
+         * purpose, the first profile which defines a limit prevails
+         */
+        const ProfileState *tx = nullptr, *txDef = nullptr, *cpMax = nullptr;
+        for (auto& profile : profiles) {
+            if (!profile.defined) continue;
+            switch (profile.purpose) {
+                case ChargingProfilePurposeType::TxProfile:
+                    if (!tx) {tx = &profile;}
+                    break;
+                case ChargingProfilePurposeType::TxDefaultProfile:
+                    if (!txDef) {txDef = &profile;}
+                    break;
+                case ChargingProfilePurposeType::ChargePointMaxProfile:
+                    if (!cpMax) {cpMax = &profile;}
+                    break;
+            }
+        }
+
+        ChargingLimit limit = {INFINITY, INFINITY, -1}; //no profile defines a limit
+        if (tx) {
+            applyProfileLimit(limit, *tx);
+        } else if (txDef) {
+            applyProfileLimit(limit, *txDef);
+        }
+        if (cpMax) {
+            applyProfileLimit(limit, *cpMax);
+        }
+
+        if (!out.append(periodBegin, periodEnd, limit)) {
+            break; //full
+        }
+        periodBegin = periodEnd;
     }
 }
 
-ChargingSchedule *SmartChargingService::getCompositeSchedule(int connectorId, otime_t duration){
+/*
+ * The allocation between the connectors is not predicted. The composite schedule of a connector is only limited by
+ * the full station limit. The local ChargePointMaxLimit is assumed to stay as it is
+ */
+ChargingSchedule *SmartChargingService::getCompositeSchedule(int connectorId, otime_t duration, ChargingRateUnitType unit){
     auto& startSchedule = context.getOcppModel().getOcppTime().getOcppTimestampNow();
-    ChargingSchedule *result = new ChargingSchedule(startSchedule, duration);
-    OcppTimestamp periodBegin = OcppTimestamp(startSchedule);
-    OcppTimestamp periodStop = OcppTimestamp(startSchedule);
-    while (periodBegin - startSchedule < duration) {
-        float limit = 0.f;
-        inferenceLimit(periodBegin, &limit, &periodStop);
-        auto p = std::unique_ptr<ChargingSchedulePeriod>(new ChargingSchedulePeriod(periodBegin - startSchedule, limit));
+    ChargingSchedule *result = new ChargingSchedule(startSchedule, duration, unit);
+
+    if (connectorId < 0 || (size_t) connectorId >= connectors.size()) {
+        AO_DBG_ERR("Invalid connectorId");
+        return result;
+    }
+
+    ChargingLimitTimeline composite {AO_COMPOSITE_SCHEDULE_MAX_PERIODS};
+    mergeProfiles(connectorId, true, startSchedule, startSchedule + duration, composite);
+
+    for (size_t i = 0; i < composite.size(); i++) {
+        ChargingLimit limit = composite[i].limit;
+        limit.power = std::min(limit.power, localChargePointMaxLimit);
+        limit = resolveLimit(connectorId, limit);
+        auto p = std::unique_ptr<ChargingSchedulePeriod>(new ChargingSchedulePeriod(composite[i].start - startSchedule,
+                unit == ChargingRateUnitType::Amp ? limit.current : limit.power,
+                limit.numberPhases));
         if (!result->addChargingSchedulePeriod(std::move(p))) {
             break;
         }
-        periodBegin = periodStop;
     }
     return result;
 }
 
 void SmartChargingService::refreshChargingSessionState() {
-    int currentTxId = -1;
-    if (context.getOcppModel().getConnectorStatus(SINGLE_CONNECTOR_ID)) {
-        auto connector = context.getOcppModel().getConnectorStatus(SINGLE_CONNECTOR_ID);
-        currentTxId = connector->getTransactionId();
-    }
-
-    if (currentTxId != chargingSessionTransactionID) {
-        //transition!
+    for (size_t connectorId = 1; connectorId < connectors.size(); connectorId++) {
+        auto& connector = *connectors[connectorId];
 
-        if (chargingSessionTransactionID != 0 && currentTxId >= 0) {
-            chargingSessionStart = context.getOcppModel().getOcppTime().getOcppTimestampNow();
-        } else if (chargingSessionTransactionID >= 0 && currentTxId < 0) {
-            chargingSessionStart = MAX_TIME;
+        int currentTxId = -1;
+        if (auto connectorStatus = context.getOcppModel().getConnectorStatus(connectorId)) {
+            currentTxId = connectorStatus->getTransactionId();
         }
 
-        nextChange = context.getOcppModel().getOcppTime().getOcppTimestampNow();
-        chargingSessionTransactionID = currentTxId;
+        if (currentTxId != connector.chargingSessionTransactionID) {
+            //transition!
+
+            if (connector.chargingSessionTransactionID != 0 && currentTxId >= 0) {
+                connector.chargingSessionStart = context.getOcppModel().getOcppTime().getOcppTimestampNow();
+            } else if (connector.chargingSessionTransactionID >= 0 && currentTxId < 0) {
+                connector.chargingSessionStart = MAX_TIME;
+            }
+
+            nextChange = context.getOcppModel().getOcppTime().getOcppTimestampNow();
+            connector.chargingSessionTransactionID = currentTxId;
+            connector.timeline.clear();
+        }
     }
 }
 
-void SmartChargingService::updateChargingProfile(JsonObject *json) {
-    ChargingProfile *pointer = updateProfileStack(json);
-    if (pointer)
-        writeProfileToFlash(json, pointer);
+bool SmartChargingService::updateChargingProfile(int connectorId, JsonObject *json) {
+    if (connectorId < 0 || (size_t) connectorId >= connectors.size()) {
+        AO_DBG_WARN("Invalid connectorId");
+        return false;
+    }
+
+    ChargingProfile *pointer = updateProfileStack(connectorId, json);
+    if (!pointer) {
+        return false;
+    }
+
+    writeProfileToFlash(connectorId, json, pointer);
+    return true;
 }
 
-ChargingProfile *SmartChargingService::updateProfileStack(JsonObject *json){
+ChargingProfile *SmartChargingService::updateProfileStack(int connectorId, JsonObject *json){
     ChargingProfile *chargingProfile = new ChargingProfile(*json);
 
     if (AO_DBG_LEVEL >= AO_DL_INFO) {
@@ -260,13 +531,23 @@ ChargingProfile *SmartChargingService::updateProfileStack(JsonObject *json){
 
     switch (chargingProfile->getChargingProfilePurpose()) {
         case (ChargingProfilePurposeType::TxDefaultProfile):
-            profilePurposeStack = TxDefaultProfile;
+            profilePurposeStack = connectors[connectorId]->TxDefaultProfile;
             break;
         case (ChargingProfilePurposeType::TxProfile):
-            profilePurposeStack = TxProfile;
+            if (connectorId == 0) {
+                AO_DBG_WARN("TxProfile must be set on a connector with connectorId > 0");
+                delete chargingProfile;
+                return nullptr;
+            }
+            profilePurposeStack = connectors[connectorId]->TxProfile;
             break;
         default:
             //case (ChargingProfilePurposeType::ChargePointMaxProfile):
+            if (connectorId != 0) {
+                AO_DBG_WARN("ChargePointMaxProfile must be set on connectorId 0");
+                delete chargingProfile;
+                return nullptr;
+            }
             profilePurposeStack = ChargePointMaxProfile;
             break;
     }
@@ -282,6 +563,7 @@ ChargingProfile *SmartChargingService::updateProfileStack(JsonObject *json){
      * and nextChange will be recalculated and onLimitChanged will be called.
      */
     nextChange = context.getOcppModel().getOcppTime().getOcppTimestampNow();
+    clearTimelines();
 
     return chargingProfile;
 }
@@ -289,46 +571,32 @@ ChargingProfile *SmartChargingService::updateProfileStack(JsonObject *json){
 bool SmartChargingService::clearChargingProfile(const std::function<bool(int, int, ChargingProfilePurposeType, int)>& filter) {
     int nMatches = 0;
 
-    ChargingProfile **profileStacks [] = {ChargePointMaxProfile, TxDefaultProfile, TxProfile};
-
-    for (ChargingProfile **profileStack : profileStacks) {
+    auto clearStack = [this, &filter, &nMatches] (int connectorId, ChargingProfile **profileStack) {
         for (int iLevel = 0; iLevel < CHARGEPROFILEMAXSTACKLEVEL; iLevel++) {
             ChargingProfile *chargingProfile = profileStack[iLevel];
             if (chargingProfile == NULL)
                 continue;
 
-            //                                                               -1: multiple connectors are not supported yet for Smart Charging
-            bool tbCleared = filter(chargingProfile->getChargingProfileId(), -1, chargingProfile->getChargingProfilePurpose(), iLevel);
+            bool tbCleared = filter(chargingProfile->getChargingProfileId(), connectorId, chargingProfile->getChargingProfilePurpose(), iLevel);
 
             if (tbCleared) {
                 nMatches++;
 
-#ifndef AO_DEACTIVATE_FLASH
-                if (filesystemOpt.accessAllowed()) {
-                    char fn [PROFILE_FN_MAXSIZE] = {'\0'};
-
-                    switch (chargingProfile->getChargingProfilePurpose()) {
-                        case (ChargingProfilePurposeType::ChargePointMaxProfile):
-                            snprintf(fn, PROFILE_FN_MAXSIZE, PROFILE_FN_PREFIX "CpMaxProfile-%d" PROFILE_FN_SUFFIX, chargingProfile->getStackLevel());
-                            break;
-                        case (ChargingProfilePurposeType::TxDefaultProfile):
-                            snprintf(fn, PROFILE_FN_MAXSIZE, PROFILE_FN_PREFIX "TxDefProfile-%d" PROFILE_FN_SUFFIX, chargingProfile->getStackLevel());
-                            break;
-                        case (ChargingProfilePurposeType::TxProfile):
-                            snprintf(fn, PROFILE_FN_MAXSIZE, PROFILE_FN_PREFIX "TxProfile-%d"    PROFILE_FN_SUFFIX, chargingProfile->getStackLevel());
-                            break;
-                    }
-
-                    if (USE_FS.exists(fn)) {
-                        USE_FS.remove(fn);
-                    }
+                if (profileStore) {
+                    profileStore->remove(connectorId, chargingProfile->getChargingProfilePurpose(), chargingProfile->getStackLevel());
                 } else {
                     AO_DBG_DEBUG("Prohibit access to FS");
                 }
-#endif
                 delete chargingProfile;
+                profileStack[iLevel] = NULL; //the timeline is compiled from the stacks
             }
         }
+    };
+
+    clearStack(0, ChargePointMaxProfile);
+    for (size_t connectorId = 0; connectorId < connectors.size(); connectorId++) {
+        clearStack(connectorId, connectors[connectorId]->TxDefaultProfile);
+        clearStack(connectorId, connectors[connectorId]->TxProfile);
     }
 
     /**
@@ -336,172 +604,190 @@ bool SmartChargingService::clearChargingProfile(const std::function<bool(int, in
      * and nextChange will be recalculated and onLimitChanged will be called.
      */
     nextChange = context.getOcppModel().getOcppTime().getOcppTimestampNow();
+    clearTimelines();
 
     return nMatches > 0;
 }
 
-bool SmartChargingService::writeProfileToFlash(JsonObject *json, ChargingProfile *chargingProfile) {
-#ifndef AO_DEACTIVATE_FLASH
-
-    if (!filesystemOpt.accessAllowed()) {
+bool SmartChargingService::writeProfileToFlash(int connectorId, JsonObject *json, ChargingProfile *chargingProfile) {
+    if (!profileStore) {
         AO_DBG_DEBUG("Prohibit access to FS");
         return true;
     }
 
-    char fn [PROFILE_FN_MAXSIZE] = {'\0'};
-
-    switch (chargingProfile->getChargingProfilePurpose()) {
-        case (ChargingProfilePurposeType::ChargePointMaxProfile):
-            snprintf(fn, PROFILE_FN_MAXSIZE, PROFILE_FN_PREFIX "CpMaxProfile-%d" PROFILE_FN_SUFFIX, chargingProfile->getStackLevel());
-            break;
-        case (ChargingProfilePurposeType::TxDefaultProfile):
-            snprintf(fn, PROFILE_FN_MAXSIZE, PROFILE_FN_PREFIX "TxDefProfile-%d" PROFILE_FN_SUFFIX, chargingProfile->getStackLevel());
-            break;
-        case (ChargingProfilePurposeType::TxProfile):
-            snprintf(fn, PROFILE_FN_MAXSIZE, PROFILE_FN_PREFIX "TxProfile-%d"    PROFILE_FN_SUFFIX, chargingProfile->getStackLevel());
-            break;
-    }
-
-    if (USE_FS.exists(fn)) {
-        USE_FS.remove(fn);
-    }
-
-    File file = USE_FS.open(fn, "w");
-
-    if (!file) {
-        AO_DBG_ERR("Unable to save: could not save profile: %s", fn);
-        return false;
-    }
-
-    // Serialize JSON to file
-    if (serializeJson(*json, file) == 0) {
-        AO_DBG_ERR("Unable to save: could not serialize JSON for profile: %s", fn);
-        file.close();
+    if (!profileStore->store(connectorId, chargingProfile->getChargingProfilePurpose(), chargingProfile->getStackLevel(), *json)) {
+        AO_DBG_ERR("Unable to save profile");
         return false;
     }
 
     //success
-    file.close();
-
     AO_DBG_DEBUG("Saving profile successful");
 
-#endif //ndef AO_DEACTIVATE_FLASH
     return true;
 }
 
 bool SmartChargingService::loadProfiles() {
 
-    bool success = true;
-
-#ifndef AO_DEACTIVATE_FLASH
-    if (!filesystemOpt.accessAllowed()) {
+    if (!profileStore) {
         AO_DBG_DEBUG("Prohibit access to FS");
         return true;
     }
 
-    ChargingProfilePurposeType purposes[] = {ChargingProfilePurposeType::ChargePointMaxProfile, ChargingProfilePurposeType::TxDefaultProfile, ChargingProfilePurposeType::TxProfile};
+    if (profileStore->exists()) {
+        return profileStore->load([this] (int connectorId, JsonObject profile) {
+            if (connectorId < 0 || (size_t) connectorId >= connectors.size()) {
+                AO_DBG_WARN("Discard stored profile of connector %d", connectorId);
+                return;
+            }
+            updateProfileStack(connectorId, &profile);
+        });
+    }
 
-    char fn [PROFILE_FN_MAXSIZE] = {'\0'};
+    //no profile store yet. Create it and move the profile files of the former format into it
+    bool success = profileStore->load([] (int, JsonObject) { });
 
-    for (const ChargingProfilePurposeType purpose : purposes) {
+    char fn [PROFILE_FN_MAXSIZE] = {'\0'};
 
-        for (int iLevel = 0; iLevel < CHARGEPROFILEMAXSTACKLEVEL; iLevel++) {
+    ChargingProfilePurposeType purposes[] = {ChargingProfilePurposeType::ChargePointMaxProfile, ChargingProfilePurposeType::TxDefaultProfile, ChargingProfilePurposeType::TxProfile};
 
-            switch (purpose) {
-                case (ChargingProfilePurposeType::ChargePointMaxProfile):
-                    snprintf(fn, PROFILE_FN_MAXSIZE, PROFILE_FN_PREFIX "CpMaxProfile-%d" PROFILE_FN_SUFFIX, iLevel);
-                    break;
-                case (ChargingProfilePurposeType::TxDefaultProfile):
-                    snprintf(fn, PROFILE_FN_MAXSIZE, PROFILE_FN_PREFIX "TxDefProfile-%d" PROFILE_FN_SUFFIX, iLevel);
-                    break;
-                case (ChargingProfilePurposeType::TxProfile):
-                    snprintf(fn, PROFILE_FN_MAXSIZE, PROFILE_FN_PREFIX "TxProfile-%d"    PROFILE_FN_SUFFIX, iLevel);
-                    break;
+    for (size_t connectorId = 0; connectorId < connectors.size(); connectorId++) {
+        for (const ChargingProfilePurposeType purpose : purposes) {
+            if (purpose == ChargingProfilePurposeType::ChargePointMaxProfile && connectorId != 0) {
+                continue; //ChargePointMaxProfiles only on connector 0
             }
-
-            if (!USE_FS.exists(fn)) {
-                continue; //There is not a profile on the stack iStack with stacklevel iLevel. Normal case, just continue.
+            if (purpose == ChargingProfilePurposeType::TxProfile && connectorId == 0) {
+                continue; //TxProfiles only on the other connectors
             }
-            
-            File file = USE_FS.open(fn, "r");
 
-            if (file) {
-                AO_DBG_DEBUG("Load profile from file: %s", fn);
-            } else {
-                AO_DBG_ERR("Unable to initialize: could not open file for profile: %s", fn);
-                success = false;
-                continue;
+            for (int iLevel = 0; iLevel < CHARGEPROFILEMAXSTACKLEVEL; iLevel++) {
+                if (!getProfileFilename(fn, PROFILE_FN_MAXSIZE, connectorId, purpose, iLevel)) {
+                    success = false;
+                    continue;
+                }
+                if (!migrateProfile(connectorId, fn)) {
+                    success = false;
+                }
             }
+        }
+    }
 
-            if (!file.available()) {
-                AO_DBG_ERR("Unable to initialize: empty file for profile: %s", fn);
-                file.close();
+    //TxProfiles were stored without connectorId when only connector 1 was supported
+    if (connectors.size() >= 2) {
+        for (int iLevel = 0; iLevel < CHARGEPROFILEMAXSTACKLEVEL; iLevel++) {
+            snprintf(fn, PROFILE_FN_MAXSIZE, PROFILE_FN_PREFIX "TxProfile-%d" PROFILE_FN_SUFFIX, iLevel);
+            if (!migrateProfile(1, fn)) {
                 success = false;
-                continue;
             }
+        }
+    }
+
+    return success;
+}
 
-            int file_size = file.size();
+bool SmartChargingService::getProfileFilename(char *fn, size_t size, int connectorId, ChargingProfilePurposeType purpose, int stackLevel) {
+    int ret = -1;
 
-            if (file_size < 2) {
-                AO_DBG_ERR("Unable to initialize: too short for json: %s", fn);
-                success = false;
-                continue;
+    switch (purpose) {
+        case (ChargingProfilePurposeType::ChargePointMaxProfile):
+            ret = snprintf(fn, size, PROFILE_FN_PREFIX "CpMaxProfile-%d" PROFILE_FN_SUFFIX, stackLevel);
+            break;
+        case (ChargingProfilePurposeType::TxDefaultProfile):
+            if (connectorId == 0) {
+                ret = snprintf(fn, size, PROFILE_FN_PREFIX "TxDefProfile-%d" PROFILE_FN_SUFFIX, stackLevel);
+            } else {
+                ret = snprintf(fn, size, PROFILE_FN_PREFIX "TxDefProfile-%d-%d" PROFILE_FN_SUFFIX, connectorId, stackLevel);
             }
-            
-            size_t capacity = 2*file_size;
-            if (capacity < PROFILE_CUSTOM_CAPACITY)
-                capacity = PROFILE_CUSTOM_CAPACITY;
-            if (capacity > PROFILE_MAX_CAPACITY)
-                capacity = PROFILE_MAX_CAPACITY;
-
-            while (capacity <= PROFILE_MAX_CAPACITY) {
-                bool increaseCapacity = false;
-                bool error = true;
-
-                DynamicJsonDocument profileDoc(capacity);
-
-                DeserializationError jsonError = deserializeJson(profileDoc, file);
-                switch (jsonError.code()) {
-                    case DeserializationError::Ok:
-                        error = false;
-                        break;
-                    case DeserializationError::InvalidInput:
-                        AO_DBG_ERR("Unable to initialize: invalid json in file: %s", fn);
-                        success = false;
-                        break;
-                    case DeserializationError::NoMemory:
-                        increaseCapacity = true;
-                        error = false;
-                        break;
-                    default:
-                        AO_DBG_ERR("Unable to initialize: error in file: %s", fn);
-                        success = false;
-                        break;
-                }
+            break;
+        case (ChargingProfilePurposeType::TxProfile):
+            ret = snprintf(fn, size, PROFILE_FN_PREFIX "TxProfile-%d-%d" PROFILE_FN_SUFFIX, connectorId, stackLevel);
+            break;
+    }
 
-                if (error) {
-                    break;
-                }
+    if (ret < 0 || (size_t) ret >= size) {
+        AO_DBG_ERR("Profile filename too long");
+        return false;
+    }
+    return true;
+}
 
-                if (increaseCapacity) {
-                    capacity *= 3;
-                    capacity /= 2;
-                    file.seek(0, SeekSet); //rewind file to beginning
-                    AO_DBG_DEBUG("Initialization: increase JsonCapacity to %zu for file: %s", capacity, fn);
-                    continue;
-                }
+bool SmartChargingService::migrateProfile(int connectorId, const char *fn) {
+    size_t file_size = 0;
+    if (!filesystem->stat(fn, &file_size)) {
+        return true; //There is not a profile on this stack level. Normal case
+    }
+    
+    auto file = filesystem->open(fn, "r");
 
-                JsonObject profileJson = profileDoc.as<JsonObject>();
-                updateProfileStack(&profileJson);
+    if (file) {
+        AO_DBG_DEBUG("Load profile from file: %s", fn);
+    } else {
+        AO_DBG_ERR("Unable to initialize: could not open file for profile: %s", fn);
+        return false;
+    }
 
-                profileDoc.clear();
+    if (file_size == 0) {
+        AO_DBG_ERR("Unable to initialize: empty file for profile: %s", fn);
+        return false;
+    }
+
+    if (file_size < 2) {
+        AO_DBG_ERR("Unable to initialize: too short for json: %s", fn);
+        return false;
+    }
+    
+    size_t capacity = 2*file_size;
+    if (capacity < PROFILE_CUSTOM_CAPACITY)
+        capacity = PROFILE_CUSTOM_CAPACITY;
+    if (capacity > PROFILE_MAX_CAPACITY)
+        capacity = PROFILE_MAX_CAPACITY;
+
+    while (capacity <= PROFILE_MAX_CAPACITY) {
+        bool increaseCapacity = false;
+        bool error = true;
+
+        DynamicJsonDocument profileDoc(capacity);
+
+        DeserializationError jsonError = deserializeJson(profileDoc, *file);
+        switch (jsonError.code()) {
+            case DeserializationError::Ok:
+                error = false;
                 break;
-            }
+            case DeserializationError::InvalidInput:
+                AO_DBG_ERR("Unable to initialize: invalid json in file: %s", fn);
+                break;
+            case DeserializationError::NoMemory:
+                increaseCapacity = true;
+                error = false;
+                break;
+            default:
+                AO_DBG_ERR("Unable to initialize: error in file: %s", fn);
+                break;
+        }
 
-            file.close();
+        if (error) {
+            return false;
         }
+
+        if (increaseCapacity) {
+            capacity *= 3;
+            capacity /= 2;
+            file->seek(0); //rewind file to beginning
+            AO_DBG_DEBUG("Initialization: increase JsonCapacity to %zu for file: %s", capacity, fn);
+            continue;
+        }
+
+        JsonObject profileJson = profileDoc.as<JsonObject>();
+        ChargingProfile *chargingProfile = updateProfileStack(connectorId, &profileJson);
+        if (!chargingProfile ||
+                !profileStore->store(connectorId, chargingProfile->getChargingProfilePurpose(), chargingProfile->getStackLevel(), profileJson)) {
+            return false;
+        }
+
+        file.reset();
+        filesystem->remove(fn);
+        AO_DBG_DEBUG("Moved profile %s into profile store", fn);
+        return true;
     }
 
-#endif //ndef AO_DEACTIVATE_FLASH
-    return success;
+    return false;
 }
@@ -7,48 +7,142 @@
 
 #define CHARGEPROFILEMAXSTACKLEVEL 20
 
+#ifndef AO_LIMIT_REALLOCATION_INTERVAL
+#define AO_LIMIT_REALLOCATION_INTERVAL 10 //in seconds. How often the limits are allocated again if demand samplers are set
+#endif
+
+#ifndef AO_MIN_CHARGING_CURRENT
+#define AO_MIN_CHARGING_CURRENT 6.f //in A per phase. Lowest current at which EVs charge (IEC 61851-1)
+#endif
+
 #include <ArduinoJson.h>
 #include <functional>
+#include <memory>
+#include <vector>
 
 #include <ArduinoOcpp/Tasks/SmartCharging/SmartChargingModel.h>
-#include <ArduinoOcpp/Core/ConfigurationOptions.h>
+#include <ArduinoOcpp/Tasks/SmartCharging/ChargingLimitTimeline.h>
+#include <ArduinoOcpp/Tasks/SmartCharging/LimitAllocation.h>
+#include <ArduinoOcpp/Tasks/SmartCharging/ChargingProfileStore.h>
+#include <ArduinoOcpp/Core/FilesystemAdapter.h>
 #include <ArduinoOcpp/Core/OcppTime.h>
 
 namespace ArduinoOcpp {
 
-using OnLimitChange = std::function<void(float)>;
+using OnLimitChange = std::function<void(float)>; //in W
+using OnChargingLimitChange = std::function<void(const ChargingLimit&)>;
 
 class OcppEngine;
 
+/*
+ * Profile stacks and limit state of one connector. On connector 0, only the TxDefaultProfile stack is used. It
+ * holds the TxDefaultProfiles which apply to all connectors
+ */
+struct SmartChargingConnector {
+    ChargingProfile *TxDefaultProfile [CHARGEPROFILEMAXSTACKLEVEL] = {NULL};
+    ChargingProfile *TxProfile [CHARGEPROFILEMAXSTACKLEVEL] = {NULL};
+    OcppTimestamp chargingSessionStart = MAX_TIME;
+    int chargingSessionTransactionID = -1;
+
+    /*
+     * Limit of the profiles of this connector, without the ChargePointMaxProfiles. INFINITY where no profile
+     * defines a limit
+     */
+    ChargingLimitTimeline timeline;
+
+    OnLimitChange onLimitChange;
+    OnChargingLimitChange onChargingLimitChange;
+    ChargingLimit limitBeforeChange = {-1.f, -1.f, -1};
+    std::function<float()> demandSampler; //in W
+
+    int supplyPhases = 1; //phases which the connector is wired with
+    bool phaseSwitching = false; //if the EVSE can switch from 3 phases to 1 phase during charging
+};
+
 class SmartChargingService {
 private:
     OcppEngine& context;
     
     const float DEFAULT_CHARGE_LIMIT;
-    const float V_eff; //use for approximation: chargingLimit in A * V_eff = chargingLimit in W
+    const float V_eff; //phase voltage (line to neutral): limit in W = limit in A per phase * V_eff * numberPhases
     ChargingProfile *ChargePointMaxProfile[CHARGEPROFILEMAXSTACKLEVEL];
-    ChargingProfile *TxDefaultProfile[CHARGEPROFILEMAXSTACKLEVEL];
-    ChargingProfile *TxProfile[CHARGEPROFILEMAXSTACKLEVEL];
-    OnLimitChange onLimitChange = NULL;
-    float limitBeforeChange;
+    std::vector<std::unique_ptr<SmartChargingConnector>> connectors; //index is connectorId
     OcppTimestamp nextChange;
-    OcppTimestamp chargingSessionStart;
-    int chargingSessionTransactionID;
     void refreshChargingSessionState();
 
-    ChargingProfile *updateProfileStack(JsonObject *json);
-    FilesystemOpt filesystemOpt;
-    bool writeProfileToFlash(JsonObject *json, ChargingProfile *chargingProfile);
+    /*
+     * The station limit is split between the connectors with a running transaction. The allocation is done again
+     * when one of the timelines changes, a transaction starts or stops, or periodically if demand samplers are set
+     */
+    LimitAllocationPolicy allocationPolicy;
+    float localChargePointMaxLimit;
+    void allocateLimits(const OcppTimestamp &t, std::vector<ChargingLimit> &limits, OcppTimestamp *validTo);
+
+    /*
+     * The profiles are composed with their own unit, i.e. a limit in W and a limit in A per phase apply both. The
+     * supply phases of the connector resolve them into the limit of the EVSE. Connector 0 stands for the grid
+     * connection of the station
+     */
+    int getUsablePhases(int connectorId, const ChargingLimit &limit);
+    float toPower(int connectorId, const ChargingLimit &limit);
+    ChargingLimit resolveLimit(int connectorId, ChargingLimit limit);
+
+    /*
+     * The profile stacks are compiled into the timelines when a limit is requested which the timeline doesn't
+     * cover. Adding or clearing a profile clears the timelines; a transaction break clears the timeline of its
+     * connector. The timeline of the ChargePointMaxProfiles is INFINITY where no profile defines a limit
+     */
+    ChargingLimitTimeline stationTimeline;
+    ChargingLimitTimeline *getTimeline(int connectorId);
+    void clearTimelines();
+    void inferenceTimeline(int connectorId, const OcppTimestamp &t, ChargingLimit *limit, OcppTimestamp *validTo);
+
+    /*
+     * Composes the limit in [from, to) in one sweep: the period boundaries of all profiles are collected and sorted,
+     * then the composite limit is updated at each boundary from the current limits of the profiles.
+     * connectorId = 0: only the ChargePointMaxProfiles. Otherwise the profiles of the connector and the
+     * TxDefaultProfiles of connector 0, and the ChargePointMaxProfiles if withStationMax is set
+     */
+    void mergeProfiles(int connectorId, bool withStationMax, const OcppTimestamp &from, const OcppTimestamp &to, ChargingLimitTimeline &out);
+
+    ChargingProfile *updateProfileStack(int connectorId, JsonObject *json);
+    std::shared_ptr<FilesystemAdapter> filesystem;
+    std::unique_ptr<ChargingProfileStore> profileStore;
+    bool writeProfileToFlash(int connectorId, JsonObject *json, ChargingProfile *chargingProfile);
     bool loadProfiles();
+
+    /*
+     * Former format with one JSON file per profile. The files are moved into the profile store on the first boot
+     * after the update
+     */
+    bool getProfileFilename(char *fn, size_t size, int connectorId, ChargingProfilePurposeType purpose, int stackLevel);
+    bool migrateProfile(int connectorId, const char *fn);
   
 public:
-    SmartChargingService(OcppEngine& context, float chargeLimit, float V_eff, int numConnectors, FilesystemOpt filesystemOpt = FilesystemOpt::Use_Mount_FormatOnFail);
-    void updateChargingProfile(JsonObject *json);
+    SmartChargingService(OcppEngine& context, float chargeLimit, float V_eff, int numConnectors, std::shared_ptr<FilesystemAdapter> filesystem = nullptr); //filesystem == nullptr: don't persist profiles
+    bool updateChargingProfile(int connectorId, JsonObject *json); //false if the profile isn't valid for connectorId
     bool clearChargingProfile(const std::function<bool(int, int, ChargingProfilePurposeType, int)>& filter);
-    void inferenceLimit(const OcppTimestamp &t, float *limit, OcppTimestamp *validTo);
-    float inferenceLimitNow();
-    void setOnLimitChange(OnLimitChange onLimitChange);
-    ChargingSchedule *getCompositeSchedule(int connectorId, otime_t duration);
+    float inferenceLimitNow(int connectorId = 1); //in W
+    ChargingLimit inferenceChargingLimitNow(int connectorId = 1);
+    void setOnLimitChange(OnLimitChange onLimitChange); //for connector 1
+    void setOnLimitChange(int connectorId, OnLimitChange onLimitChange);
+    void setOnChargingLimitChange(int connectorId, OnChargingLimitChange onChargingLimitChange);
+
+    /*
+     * Phases which connectorId is wired with (1 or 3; default: 1), connectorId = 0 for the grid connection of the
+     * station. With phaseSwitching, the limit falls back to 1 phase when the current on all phases would be below
+     * AO_MIN_CHARGING_CURRENT
+     */
+    void setSupplyPhases(int connectorId, int numberPhases, bool phaseSwitching = false);
+    void setAllocationPolicy(LimitAllocationPolicy policy); //default: LimitAllocation::equalShare()
+    void setDemandSampler(int connectorId, std::function<float()> demand); //in W. Used by LimitAllocation::demandWeighted()
+
+    /*
+     * Station limit in W which is set locally, e.g. by a SiteLoadBalancer. It applies like an additional
+     * ChargePointMaxProfile, but is not persisted and not reported to the OCPP server. INFINITY: no local limit
+     */
+    void setLocalChargePointMaxLimit(float limit);
+    ChargingSchedule *getCompositeSchedule(int connectorId, otime_t duration, ChargingRateUnitType unit = ChargingRateUnitType::Watt);
     void loop();
 };
 
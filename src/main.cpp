@@ -188,16 +188,13 @@ void setup()
   /*
    * Integrate OCPP functionality. You can leave out the following part if your EVSE doesn't need it.
    */
-  setEnergyActiveImportSampler([]()
-                               {
-    //read the energy input register of the EVSE here and return the value in Wh
+  setIntegratedEnergyActiveImportSampler([]()
+                                         {
+    //read the power of the EVSE here and return the value in W. The library integrates it to the energy register
     /** Approximated value. TODO: Replace with real reading**/
-    static ulong lastSampled = millis();
-    static float energyMeter = 0.f;
     if (getTransactionId() > 0 && digitalRead(EV_Charge_Pin) == EV_Charging)
-        energyMeter += ((float) millis() - lastSampled) * 0.003f; //increase by 0.003Wh per ms (~ 10.8kWh per h)
-    lastSampled = millis();
-    return energyMeter; });
+        return 10800.f; //~ 10.8kWh per h
+    return 0.f; });
 
   setEvRequestsEnergySampler([]()
                              {
@@ -0,0 +1,120 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+/*
+ * Minimal Arduino core for the native test environment. Only covers what the ArduinoOcpp sources use.
+ *
+ * millis() follows the host clock plus a simulated offset: delay() does not sleep but advances the offset, so that
+ * simulations of minutes or hours of charging run in a fraction of a second.
+ */
+
+#ifndef AO_NATIVE_ARDUINO_H
+#define AO_NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <algorithm>
+
+typedef unsigned long ulong;
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+
+#define PSTR(x) x
+#define F(x) x
+
+using std::min;
+using std::max;
+
+inline unsigned long &ao_native_millis_offset() {
+    static unsigned long offset = 0;
+    return offset;
+}
+
+inline unsigned long millis() {
+    static const auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    return (unsigned long) elapsed.count() + ao_native_millis_offset();
+}
+
+inline void delay(unsigned long ms) {
+    ao_native_millis_offset() += ms;
+}
+
+inline int digitalRead(uint8_t) {
+    return LOW;
+}
+
+class String {
+private:
+    std::string s;
+public:
+    String() = default;
+    String(const char *cstr) : s(cstr ? cstr : "") { }
+    bool equals(const char *other) const {return s == other;}
+    long toInt() const {return atol(s.c_str());}
+    const char *c_str() const {return s.c_str();}
+    size_t length() const {return s.size();}
+};
+
+class NativeSerial {
+public:
+    int printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int ret = vprintf(format, args);
+        va_end(args);
+        return ret;
+    }
+    int printf_P(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int ret = vprintf(format, args);
+        va_end(args);
+        return ret;
+    }
+    size_t print(const char *str) {return fputs(str, stdout) >= 0 ? strlen(str) : 0;}
+    size_t print(const String& str) {return print(str.c_str());}
+    size_t print(char c) {return write((uint8_t) c);}
+    size_t print(int val) {return ::printf("%d", val);}
+    size_t print(unsigned int val) {return ::printf("%u", val);}
+    size_t print(long val) {return ::printf("%ld", val);}
+    size_t print(unsigned long val) {return ::printf("%lu", val);}
+    size_t print(double val, int digits = 2) {return ::printf("%.*f", digits, val);}
+    template<class T>
+    size_t println(T val) {return print(val) + print("\n");}
+    size_t println() {return print("\n");}
+    size_t write(uint8_t c) {return fputc(c, stdout) == EOF ? 0 : 1;}
+};
+
+class NativeEsp {
+public:
+    uint32_t getFreeHeap() {return 100000;}
+    void restart() {abort();}
+};
+
+inline NativeSerial &ao_native_serial() {
+    static NativeSerial serial;
+    return serial;
+}
+
+inline NativeEsp &ao_native_esp() {
+    static NativeEsp esp;
+    return esp;
+}
+
+#define Serial ao_native_serial()
+#define ESP ao_native_esp()
+
+#endif
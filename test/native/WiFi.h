@@ -0,0 +1,13 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+//FileManage.h includes WiFi.h for the Arduino core and struct tm; the native environment only needs the latter
+
+#ifndef AO_NATIVE_WIFI_H
+#define AO_NATIVE_WIFI_H
+
+#include <Arduino.h>
+#include <time.h>
+
+#endif
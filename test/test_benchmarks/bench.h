@@ -0,0 +1,41 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#ifndef AO_BENCH_H
+#define AO_BENCH_H
+
+#include <chrono>
+#include <stdio.h>
+
+/*
+ * The benchmarks print their results and only fail on wrong results. Timings on the host are no absolute figures
+ * for the MCU, but show the ratio between the compared variants
+ */
+
+template <class Fn>
+double benchNsPerOp(size_t iterations, Fn fn) {
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        fn(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count() / (double) iterations;
+}
+
+#define BENCH_REPORT(...) do {printf("[bench] " __VA_ARGS__); printf("\n");} while (0)
+
+void bench_configuration_boot();
+
+void bench_timestamp_arithmetic();
+void bench_timestamp_per_loop();
+void bench_timestamp_parser();
+
+void bench_energy_integration();
+void bench_batch_meter();
+
+void bench_profile_stacks();
+void bench_site_balancer();
+void bench_profile_store_boot();
+
+#endif
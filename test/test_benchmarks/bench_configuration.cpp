@@ -0,0 +1,103 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <unity.h>
+#include "bench.h"
+
+#include <ArduinoOcpp/Core/ConfigurationContainerFlash.h>
+#include <ArduinoOcpp/Core/ConfigurationKeyValue.h>
+
+#include <string>
+
+using namespace ArduinoOcpp;
+
+namespace {
+
+const char *CONFIG_FN = "/bench-config.cnf";
+
+//the former text header + JSON format which ConfigurationContainerFlash migrates on the first boot
+void writeLegacyFile(FilesystemAdapter& fs, size_t numKeys) {
+    std::string out = "content-type:arduino-ocpp_configuration_file\nversion:1.0\nconfigurations_len:";
+    out += std::to_string(numKeys);
+    out += "\n{\"configurations\":[";
+    char buf [128];
+    for (size_t i = 0; i < numKeys; i++) {
+        switch (i % 3) {
+            case 0:
+                snprintf(buf, sizeof(buf), "{\"type\":\"%s\",\"key\":\"BenchKeyInt%04zu\",\"value\":%zu}", SerializedType<int>::get(), i, i * 7);
+                break;
+            case 1:
+                snprintf(buf, sizeof(buf), "{\"type\":\"%s\",\"key\":\"BenchKeyFloat%04zu\",\"value\":%zu.5}", SerializedType<float>::get(), i, i);
+                break;
+            default:
+                snprintf(buf, sizeof(buf), "{\"type\":\"%s\",\"key\":\"BenchKeyString%04zu\",\"value\":\"value-%zu\"}", SerializedType<const char*>::get(), i, i);
+                break;
+        }
+        if (i > 0) {
+            out += ',';
+        }
+        out += buf;
+    }
+    out += "]}";
+
+    auto file = fs.open(CONFIG_FN, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL(out.size(), file->write((const uint8_t*) out.data(), out.size()));
+}
+
+void checkContent(ConfigurationContainerFlash& container, size_t numKeys) {
+    size_t count = 0;
+    for (auto it = container.configurationsIteratorBegin(); it != container.configurationsIteratorEnd(); ++it) {
+        count++;
+    }
+    TEST_ASSERT_EQUAL(numKeys, count);
+
+    char key [32];
+    snprintf(key, sizeof(key), "BenchKeyInt%04zu", (numKeys - 1) / 3 * 3);
+    auto config = container.getConfiguration(key);
+    TEST_ASSERT_NOT_NULL(config.get());
+    TEST_ASSERT_EQUAL((int) ((numKeys - 1) / 3 * 3 * 7), (int) *std::static_pointer_cast<Configuration<int>>(config));
+}
+
+} //end anonymous namespace
+
+/*
+ * Boot time of the configuration file: legacy JSON (including the migration to the binary snapshot) vs. binary
+ */
+void bench_configuration_boot() {
+    const size_t sizes [] = {50, 200, 1000};
+    const int runs = 20;
+
+    for (size_t numKeys : sizes) {
+        double legacyNs = 0., binaryNs = 0.;
+        size_t legacyBytesRead = 0, binaryBytesRead = 0, binaryFileSize = 0;
+
+        for (int run = 0; run < runs; run++) {
+            auto fs = std::make_shared<RamFilesystemAdapter>();
+            writeLegacyFile(*fs, numKeys);
+
+            fs->resetStats();
+            legacyNs += benchNsPerOp(1, [&fs, numKeys] (size_t) {
+                ConfigurationContainerFlash container (fs, CONFIG_FN);
+                TEST_ASSERT_TRUE(container.load());
+                checkContent(container, numKeys);
+            });
+            legacyBytesRead = fs->getStats().bytesRead;
+
+            fs->resetStats();
+            binaryNs += benchNsPerOp(1, [&fs, numKeys] (size_t) {
+                ConfigurationContainerFlash container (fs, CONFIG_FN);
+                TEST_ASSERT_TRUE(container.load());
+                checkContent(container, numKeys);
+            });
+            binaryBytesRead = fs->getStats().bytesRead;
+
+            std::string slotB = std::string(CONFIG_FN) + ".b";
+            fs->stat(slotB.c_str(), &binaryFileSize);
+        }
+
+        BENCH_REPORT("configuration boot, %4zu keys: JSON + migration %8.1f us (%6zu B read), binary %8.1f us (%6zu B read, snapshot %zu B)",
+                numKeys, legacyNs / runs / 1000., legacyBytesRead, binaryNs / runs / 1000., binaryBytesRead, binaryFileSize);
+    }
+}
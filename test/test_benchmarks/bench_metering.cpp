@@ -0,0 +1,139 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <unity.h>
+#include "bench.h"
+
+#include <ArduinoOcpp/Tasks/Metering/EnergyIntegrator.h>
+#include <ArduinoOcpp/Tasks/Metering/MeterSnapshot.h>
+
+#include <math.h>
+
+using namespace ArduinoOcpp;
+
+namespace {
+
+//power of an EV which ramps its current in a 5 s cycle: 7 kW +- 3 kW
+const double POWER_MEAN = 7000.;
+const double POWER_AMPLITUDE = 3000.;
+const double POWER_PERIOD_MS = 5000.;
+
+double powerAt(double ms) {
+    return POWER_MEAN + POWER_AMPLITUDE * sin(2. * M_PI * ms / POWER_PERIOD_MS);
+}
+
+double energyWhBetween(double fromMs, double toMs) {
+    auto antiderivative = [] (double ms) {
+        return POWER_MEAN * ms - POWER_AMPLITUDE * POWER_PERIOD_MS / (2. * M_PI) * cos(2. * M_PI * ms / POWER_PERIOD_MS);
+    };
+    return (antiderivative(toMs) - antiderivative(fromMs)) / (3600. * 1000.);
+}
+
+struct IntegrationResult {
+    double relError;
+    double nsPerLoop;
+};
+
+//one simulated hour with a jittering loop period between 10 and 160 ms
+IntegrationResult integrateOneHour(IntegrationRule rule, ulong samplePeriodMs) {
+    ulong firstSample = 0, lastSample = 0;
+    bool sampled = false;
+    EnergyIntegrator integrator ([&firstSample, &lastSample, &sampled] () {
+        lastSample = millis();
+        if (!sampled) {
+            firstSample = lastSample;
+            sampled = true;
+        }
+        return (float) powerAt((double) lastSample);
+    }, samplePeriodMs, rule);
+
+    unsigned int rnd = 11;
+    ulong begin = millis();
+    size_t loops = 0;
+    double ns = 0.;
+    while (millis() - begin < 3600UL * 1000UL) {
+        ns += benchNsPerOp(1, [&integrator] (size_t) {
+            integrator.loop();
+        });
+        loops++;
+        rnd = rnd * 1103515245 + 12345;
+        delay(10 + (rnd >> 8) % 150);
+    }
+
+    double expected = energyWhBetween((double) firstSample, (double) lastSample);
+    return {fabs((double) integrator.getEnergyWh() - expected) / expected, ns / (double) loops};
+}
+
+} //end anonymous namespace
+
+/*
+ * Accuracy and CPU time per loop of the energy register which is derived from a power sampler
+ */
+void bench_energy_integration() {
+    const ulong periods [] = {100, 250, 1000};
+    for (ulong samplePeriodMs : periods) {
+        auto trapezoidal = integrateOneHour(IntegrationRule::Trapezoidal, samplePeriodMs);
+        auto simpson = integrateOneHour(IntegrationRule::Simpson, samplePeriodMs);
+
+        BENCH_REPORT("energy integration, sample period %4lu ms: trapezoidal error %.2e (%.0f ns/loop), Simpson error %.2e (%.0f ns/loop)",
+                samplePeriodMs, trapezoidal.relError, trapezoidal.nsPerLoop, simpson.relError, simpson.nsPerLoop);
+
+        TEST_ASSERT_TRUE(trapezoidal.relError < 1e-2);
+        TEST_ASSERT_TRUE(simpson.relError < 1e-2);
+        if (samplePeriodMs >= 1000) {
+            //with shorter periods, both errors are at the resolution of the float register and the sampled power
+            TEST_ASSERT_TRUE(simpson.relError <= trapezoidal.relError);
+        }
+    }
+}
+
+/*
+ * A meter with a 10 ms read (e.g. Modbus RTU) and 2 connectors with 4 measurands each: one batch read per loop vs.
+ * one read per measurand. The time is taken from the simulated clock
+ */
+void bench_batch_meter() {
+    const size_t numChannels = 8;
+    const int loops = 1000;
+
+    size_t batchReads = 0;
+    MeterSnapshot snapshot (numChannels, [&batchReads, numChannels] (MeterSnapshot& s) {
+        delay(10);
+        batchReads++;
+        for (size_t i = 0; i < numChannels; i++) {
+            s.set(i, (float) (batchReads * 100 + i));
+        }
+        return true;
+    });
+
+    ulong begin = millis();
+    for (int l = 0; l < loops; l++) {
+        snapshot.invalidate();
+        for (size_t i = 0; i < numChannels; i++) {
+            float value = snapshot.get(i);
+            TEST_ASSERT_EQUAL_FLOAT((float) (batchReads * 100 + i), value);
+        }
+    }
+    ulong batchMs = millis() - begin;
+    TEST_ASSERT_EQUAL(loops, batchReads);
+
+    size_t singleReads = 0;
+    auto readSingle = [&singleReads] (size_t channel) {
+        delay(10);
+        singleReads++;
+        return (float) channel;
+    };
+
+    begin = millis();
+    for (int l = 0; l < loops; l++) {
+        for (size_t i = 0; i < numChannels; i++) {
+            readSingle(i);
+        }
+    }
+    ulong singleMs = millis() - begin;
+
+    BENCH_REPORT("meter with 10 ms reads, %zu channels: batch %.1f ms/loop (%zu reads), per measurand %.1f ms/loop (%zu reads)",
+            numChannels, (double) batchMs / loops, batchReads, (double) singleMs / loops, singleReads);
+
+    TEST_ASSERT_TRUE(batchMs * 4 < singleMs);
+}
@@ -0,0 +1,273 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <unity.h>
+#include "bench.h"
+
+#include <ArduinoOcpp/Tasks/SmartCharging/SmartChargingService.h>
+#include <ArduinoOcpp/Tasks/SmartCharging/SiteLoadBalancer.h>
+#include <ArduinoOcpp/Core/OcppEngine.h>
+#include <ArduinoOcpp/Core/OcppModel.h>
+#include <ArduinoOcpp/Core/OcppSocket.h>
+#include <ArduinoOcpp/Core/Configuration.h>
+
+#include <math.h>
+#include <string>
+#include <vector>
+
+using namespace ArduinoOcpp;
+
+namespace {
+
+const float DEFAULT_LIMIT = 11000.f;
+
+class LoopbackSocket : public OcppSocket {
+public:
+    void loop() { }
+    bool sendTXT(std::string&) {return true;}
+    void setReceiveTXTcallback(ReceiveTXTcallback&) { }
+};
+
+void initConfiguration() {
+    static bool initialized = false;
+    if (!initialized) {
+        configuration_init(std::shared_ptr<FilesystemAdapter>(nullptr));
+        initialized = true;
+    }
+}
+
+/*
+ * Daily recurring profile with 24 hourly periods. The periods are shifted by the stack level, so that the stack
+ * levels take turns in defining the limit
+ */
+std::string makeRecurringProfile(int id, int stackLevel, const char *purpose) {
+    char buf [2000];
+    int n = snprintf(buf, sizeof(buf),
+            "{\"chargingProfileId\":%d,\"stackLevel\":%d,\"chargingProfilePurpose\":\"%s\","
+            "\"chargingProfileKind\":\"Recurring\",\"recurrencyKind\":\"Daily\",\"validFrom\":\"2022-01-0%dT00:00:00Z\","
+            "\"chargingSchedule\":{\"startSchedule\":\"2022-01-01T00:00:00Z\",\"chargingRateUnit\":\"W\",\"chargingSchedulePeriod\":[",
+            id, stackLevel, purpose, 1 + stackLevel % 9);
+    for (int k = 0; k < 24; k++) {
+        n += snprintf(buf + n, sizeof(buf) - n, "%s{\"startPeriod\":%d,\"limit\":%d}",
+                k ? "," : "", k * 3600 + stackLevel * 60, 1000 * ((k + stackLevel) % 11 + 1));
+    }
+    snprintf(buf + n, sizeof(buf) - n, "]}}");
+    return buf;
+}
+
+struct ProfileSpec {
+    int connectorId;
+    std::string json;
+};
+
+//ChargePointMaxProfiles and TxDefaultProfiles of connector 0 and 1 on all stack levels
+std::vector<ProfileSpec> makeFullStacks() {
+    std::vector<ProfileSpec> specs;
+    int id = 1;
+    for (int level = 0; level < CHARGEPROFILEMAXSTACKLEVEL; level++) {
+        specs.push_back({0, makeRecurringProfile(id++, level, "ChargePointMaxProfile")});
+        specs.push_back({0, makeRecurringProfile(id++, level, "TxDefaultProfile")});
+        specs.push_back({1, makeRecurringProfile(id++, level, "TxDefaultProfile")});
+    }
+    return specs;
+}
+
+void install(SmartChargingService& scs, const std::vector<ProfileSpec>& specs) {
+    for (auto& spec : specs) {
+        DynamicJsonDocument doc (4000);
+        TEST_ASSERT_FALSE(deserializeJson(doc, spec.json));
+        JsonObject json = doc.as<JsonObject>();
+        TEST_ASSERT_TRUE(scs.updateChargingProfile(spec.connectorId, &json));
+    }
+}
+
+/*
+ * Evaluates all profiles on each request, like before the limit timelines. Serves as reference for the timelines
+ */
+class ReferenceStacks {
+private:
+    std::vector<std::unique_ptr<ChargingProfile>> cpMax, txDefConnector, txDefStation; //highest stack level first
+
+    static bool firstDefined(std::vector<std::unique_ptr<ChargingProfile>>& stack, const OcppTimestamp& t, float *limit) {
+        for (auto& profile : stack) {
+            OcppTimestamp nextChange = MAX_TIME;
+            if (profile->inferenceLimit(t, MAX_TIME, limit, &nextChange)) {
+                return true;
+            }
+        }
+        return false;
+    }
+public:
+    ReferenceStacks(const std::vector<ProfileSpec>& specs) {
+        for (auto it = specs.rbegin(); it != specs.rend(); ++it) {
+            DynamicJsonDocument doc (4000);
+            deserializeJson(doc, it->json);
+            JsonObject json = doc.as<JsonObject>();
+            auto profile = std::unique_ptr<ChargingProfile>(new ChargingProfile(json));
+            if (profile->getChargingProfilePurpose() == ChargingProfilePurposeType::ChargePointMaxProfile) {
+                cpMax.push_back(std::move(profile));
+            } else if (it->connectorId == 0) {
+                txDefStation.push_back(std::move(profile));
+            } else {
+                txDefConnector.push_back(std::move(profile));
+            }
+        }
+    }
+
+    float limitAt(const OcppTimestamp& t) {
+        float limit = INFINITY, txDef = INFINITY, max = INFINITY;
+        if (firstDefined(txDefConnector, t, &txDef) || firstDefined(txDefStation, t, &txDef)) {
+            limit = txDef;
+        }
+        if (firstDefined(cpMax, t, &max)) {
+            limit = std::min(limit, max);
+        }
+        return std::isinf(limit) ? DEFAULT_LIMIT : limit;
+    }
+};
+
+} //end anonymous namespace
+
+/*
+ * Limit lookup with full stacks of daily recurring profiles: inferenceLimitNow() with the limit timeline vs. evaluating
+ * the stacks on every request, and the merge of a 24 h composite schedule. The reference stops at the first profile
+ * which defines a limit, which is the highest stack level here
+ */
+void bench_profile_stacks() {
+    initConfiguration();
+    LoopbackSocket socket;
+    OcppEngine engine (socket, [] () {return (otime_t) 0;});
+    auto& ocppTime = engine.getOcppModel().getOcppTime();
+    TEST_ASSERT_TRUE(ocppTime.setOcppTime("2022-01-05T00:00:00.000Z"));
+
+    SmartChargingService scs (engine, DEFAULT_LIMIT, 230.f, 2);
+    auto specs = makeFullStacks();
+    install(scs, specs);
+    ReferenceStacks reference (specs);
+
+    //one simulated day in 37 s steps
+    for (int i = 0; i < 86400 / 37; i++) {
+        delay(37000);
+        float limit = scs.inferenceLimitNow(1);
+        float expected = reference.limitAt(ocppTime.getOcppTimestampNow());
+        TEST_ASSERT_EQUAL_FLOAT(expected, limit);
+    }
+
+    const size_t lookups = 86400;
+    volatile float sink = 0.f;
+    double timelineNs = benchNsPerOp(lookups, [&scs, &sink] (size_t) {
+        delay(1000);
+        sink = scs.inferenceLimitNow(1);
+    });
+    double referenceNs = benchNsPerOp(lookups, [&reference, &ocppTime, &sink] (size_t) {
+        delay(1000);
+        sink = reference.limitAt(ocppTime.getOcppTimestampNow());
+    });
+    //the fixed cost of inferenceLimitNow() without any profile: time snapshot and the allocation among the connectors
+    SmartChargingService noProfiles (engine, DEFAULT_LIMIT, 230.f, 2);
+    double noProfilesNs = benchNsPerOp(lookups, [&noProfiles, &sink] (size_t) {
+        delay(1000);
+        sink = noProfiles.inferenceLimitNow(1);
+    });
+    double compositeNs = benchNsPerOp(100, [&scs] (size_t) {
+        delete scs.getCompositeSchedule(1, 86400);
+    });
+
+    BENCH_REPORT("limit lookup, %zu recurring profiles: timeline %.0f ns (without profiles %.0f ns), all profiles %.0f ns; 24 h composite schedule %.1f us",
+            specs.size(), timelineNs, noProfilesNs, referenceNs, compositeNs / 1000.);
+}
+
+/*
+ * CPU time of one balancing step for growing sites, and the invariant that the limits fit into the site limit
+ */
+void bench_site_balancer() {
+    const size_t sizes [] = {4, 16, 64};
+    for (size_t numMembers : sizes) {
+        const float siteLimit = 2000.f * numMembers;
+        SiteLoadBalancer balancer (siteLimit);
+
+        std::vector<float> power (numMembers, 0.f), demand (numMembers, 0.f), limits (numMembers, 0.f);
+        for (size_t i = 0; i < numMembers; i++) {
+            demand[i] = (i % 3 == 0) ? 0.f : 3700.f + 3650.f * (i % 4);
+            balancer.addMember([&power, i] () {return power[i];},
+                               [&demand, i] () {return demand[i];},
+                               [&limits, i] (float limit) {limits[i] = limit;});
+        }
+
+        unsigned int rnd = 3;
+        double ns = benchNsPerOp(10000, [&] (size_t) {
+            balancer.balance();
+            float sum = 0.f;
+            for (size_t i = 0; i < numMembers; i++) {
+                power[i] = std::min(limits[i], demand[i]);
+                sum += limits[i];
+            }
+            TEST_ASSERT_TRUE(sum <= siteLimit * 1.001f);
+            rnd = rnd * 1103515245 + 12345;
+            size_t changing = (rnd >> 8) % numMembers;
+            demand[changing] = demand[changing] > 0.f ? 0.f : 11000.f;
+        });
+
+        BENCH_REPORT("site balancer, %2zu members: %.0f ns per balancing step", numMembers, ns);
+    }
+}
+
+/*
+ * Boot of the SmartChargingService with full profile stacks: former format with one JSON file per profile (migrated
+ * into the profile store during the boot) vs. the profile store
+ */
+void bench_profile_store_boot() {
+    initConfiguration();
+    LoopbackSocket socket;
+    OcppEngine engine (socket, [] () {return (otime_t) 0;});
+    TEST_ASSERT_TRUE(engine.getOcppModel().getOcppTime().setOcppTime("2022-01-05T12:00:00.000Z"));
+
+    auto specs = makeFullStacks();
+    const int runs = 10;
+
+    double legacyNs = 0., storeNs = 0.;
+    size_t legacyBytesRead = 0, storeBytesRead = 0;
+    for (int run = 0; run < runs; run++) {
+        auto fs = std::make_shared<RamFilesystemAdapter>();
+        float expected = 0.f;
+        {
+            //write the profiles in the former format
+            SmartChargingService scs (engine, DEFAULT_LIMIT, 230.f, 2);
+            install(scs, specs);
+            expected = scs.inferenceLimitNow(1);
+            for (auto& spec : specs) {
+                DynamicJsonDocument doc (4000);
+                deserializeJson(doc, spec.json);
+                char fn [32];
+                if (!strcmp(doc["chargingProfilePurpose"] | "", "ChargePointMaxProfile")) {
+                    snprintf(fn, sizeof(fn), "/ocpp-CpMaxProfile-%d.cnf", doc["stackLevel"].as<int>());
+                } else if (spec.connectorId == 0) {
+                    snprintf(fn, sizeof(fn), "/ocpp-TxDefProfile-%d.cnf", doc["stackLevel"].as<int>());
+                } else {
+                    snprintf(fn, sizeof(fn), "/ocpp-TxDefProfile-%d-%d.cnf", spec.connectorId, doc["stackLevel"].as<int>());
+                }
+                auto file = fs->open(fn, "w");
+                TEST_ASSERT_NOT_NULL(file);
+                file->write((const uint8_t*) spec.json.data(), spec.json.size());
+            }
+        }
+
+        fs->resetStats();
+        legacyNs += benchNsPerOp(1, [&] (size_t) {
+            SmartChargingService scs (engine, DEFAULT_LIMIT, 230.f, 2, fs);
+            TEST_ASSERT_EQUAL_FLOAT(expected, scs.inferenceLimitNow(1));
+        });
+        legacyBytesRead = fs->getStats().bytesRead;
+
+        fs->resetStats();
+        storeNs += benchNsPerOp(1, [&] (size_t) {
+            SmartChargingService scs (engine, DEFAULT_LIMIT, 230.f, 2, fs);
+            TEST_ASSERT_EQUAL_FLOAT(expected, scs.inferenceLimitNow(1));
+        });
+        storeBytesRead = fs->getStats().bytesRead;
+    }
+
+    BENCH_REPORT("profile boot, %zu profiles: JSON files + migration %.0f us (%zu B read), profile store %.0f us (%zu B read)",
+            specs.size(), legacyNs / runs / 1000., legacyBytesRead, storeNs / runs / 1000., storeBytesRead);
+}
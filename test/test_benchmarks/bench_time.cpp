@@ -0,0 +1,320 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <unity.h>
+#include "bench.h"
+
+#include <ArduinoOcpp/Core/OcppTime.h>
+#include <ArduinoOcpp/Platform.h>
+
+#include <string.h>
+#include <time.h>
+
+using namespace ArduinoOcpp;
+
+/*
+ * OcppTimestamp arithmetic on the epoch milliseconds: add, difference and comparison, and the start of the current
+ * recurrence of a daily or weekly profile, as ChargingSchedule::inferenceLimit computes it
+ */
+void bench_timestamp_arithmetic() {
+    OcppTimestamp base (2022, 0, 0, 0, 0, 0);
+
+    unsigned int rnd = 7;
+    for (int i = 0; i < 100000; i++) {
+        rnd = rnd * 1103515245 + 12345;
+        int secs = (int) ((rnd >> 4) % (400 * 24 * 3600)) - 200 * 24 * 3600;
+        OcppTimestamp t = base + secs;
+        TEST_ASSERT_EQUAL(secs, t - base);
+        TEST_ASSERT_TRUE(secs >= 0 ? t >= base : t < base);
+    }
+
+    volatile otime_t sink = 0;
+    double addNs = benchNsPerOp(10000000, [&base, &sink] (size_t i) {
+        OcppTimestamp t = base + (int) (i % 100000);
+        sink = (otime_t) t.getEpochMs();
+    });
+    OcppTimestamp other = base + 123456;
+    double diffNs = benchNsPerOp(10000000, [&base, &other, &sink] (size_t i) {
+        sink = other - base + (otime_t) i;
+    });
+    double cmpNs = benchNsPerOp(10000000, [&base, &other, &sink] (size_t i) {
+        sink = (other < base + (int) (i & 0x3FFFF)) ? 1 : 0;
+    });
+
+    OcppTimestamp startSchedule (2021, 0, 0, 0, 0, 0);
+    const otime_t periods [] = {24 * 3600, 7 * 24 * 3600};
+    for (otime_t period : periods) {
+        for (int i = 0; i < 100000; i++) {
+            rnd = rnd * 1103515245 + 12345;
+            OcppTimestamp t = base + (int) ((rnd >> 4) % (200 * 24 * 3600));
+            OcppTimestamp basis = t - ((t - startSchedule) % period);
+            TEST_ASSERT_TRUE(basis <= t);
+            TEST_ASSERT_TRUE(t - basis < period);
+            TEST_ASSERT_EQUAL(0, (basis - startSchedule) % period);
+        }
+    }
+
+    double dailyNs = benchNsPerOp(10000000, [&base, &startSchedule, &sink] (size_t i) {
+        OcppTimestamp t = base + (int) (i % 10000000);
+        OcppTimestamp basis = t - ((t - startSchedule) % (24 * 3600));
+        sink = (otime_t) basis.getEpochMs();
+    });
+    double weeklyNs = benchNsPerOp(10000000, [&base, &startSchedule, &sink] (size_t i) {
+        OcppTimestamp t = base + (int) (i % 10000000);
+        OcppTimestamp basis = t - ((t - startSchedule) % (7 * 24 * 3600));
+        sink = (otime_t) basis.getEpochMs();
+    });
+
+    BENCH_REPORT("timestamp arithmetic: add %.1f ns, difference %.1f ns, add + compare %.1f ns", addNs, diffNs, cmpNs);
+    BENCH_REPORT("recurrence start (t - (t - start) %% period): daily %.1f ns, weekly %.1f ns", dailyNs, weeklyNs);
+}
+
+namespace {
+
+/*
+ * The time path before the per-loop snapshot and the formatting cache, kept as reference: every request reads the
+ * tick counter and applies the clock discipline, and every timestamp is formatted from the calendar fields
+ */
+class PerCallClock {
+private:
+    uint64_t tickMs = 0;
+    unsigned long lastTickReading = 0;
+    uint64_t baseTickMs = 0;
+    int64_t baseOcppMs = 0;
+    int64_t driftPpm = 0;
+    int64_t slewMs = 0;
+    OcppTimestamp currentTime;
+
+    uint64_t readTickMs() {
+        unsigned long tick = ao_tick_ms();
+        tickMs += (unsigned long) (tick - lastTickReading);
+        lastTickReading = tick;
+        return tickMs;
+    }
+
+    int64_t toOcppMs(uint64_t tick) {
+        int64_t dt = (int64_t) (tick - baseTickMs);
+        int64_t t = baseOcppMs + dt + dt * driftPpm / 1000000;
+
+        int64_t maxSlew = dt / 200;
+        if (slewMs > maxSlew) {
+            t += maxSlew;
+        } else if (slewMs < -maxSlew) {
+            t -= maxSlew;
+        } else {
+            t += slewMs;
+        }
+        return t;
+    }
+public:
+    PerCallClock(const OcppTimestamp& t) {
+        baseTickMs = readTickMs();
+        baseOcppMs = t.getEpochMs();
+    }
+
+    const OcppTimestamp& getOcppTimestampNow() {
+        currentTime.setEpochMs(toOcppMs(readTickMs()));
+        return currentTime;
+    }
+};
+
+void civilFromDays(int32_t z, int32_t& y, int32_t& m, int32_t& d) {
+    z += 719468;
+    const int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const int32_t doe = z - era * 146097;
+    const int32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int32_t mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = yoe + era * 400 + (m <= 2);
+}
+
+void formatPerCall(const OcppTimestamp& t, char *out) {
+    int64_t epochMs = t.getEpochMs();
+    int64_t msPerDay = 24 * 3600 * 1000;
+    int32_t days = (int32_t) (epochMs / msPerDay);
+    int32_t msOfDay = (int32_t) (epochMs % msPerDay);
+    if (msOfDay < 0) {
+        days--;
+        msOfDay += msPerDay;
+    }
+    int32_t secondOfDay = msOfDay / 1000;
+    int32_t ms = msOfDay % 1000;
+
+    int32_t year, month, day;
+    civilFromDays(days, year, month, day);
+    int32_t hour = secondOfDay / 3600;
+    int32_t minute = (secondOfDay / 60) % 60;
+    int32_t second = secondOfDay % 60;
+
+    out[0] = ((char) ((year / 1000) % 10)) + '0';
+    out[1] = ((char) ((year / 100) % 10)) + '0';
+    out[2] = ((char) ((year / 10) % 10)) + '0';
+    out[3] = ((char) ((year / 1) % 10)) + '0';
+    out[4] = '-';
+    out[5] = ((char) ((month / 10) % 10)) + '0';
+    out[6] = ((char) ((month / 1) % 10)) + '0';
+    out[7] = '-';
+    out[8] = ((char) ((day / 10) % 10)) + '0';
+    out[9] = ((char) ((day / 1) % 10)) + '0';
+    out[10] = 'T';
+    out[11] = ((char) ((hour / 10) % 10)) + '0';
+    out[12] = ((char) ((hour / 1) % 10)) + '0';
+    out[13] = ':';
+    out[14] = ((char) ((minute / 10) % 10)) + '0';
+    out[15] = ((char) ((minute / 1) % 10)) + '0';
+    out[16] = ':';
+    out[17] = ((char) ((second / 10) % 10)) + '0';
+    out[18] = ((char) ((second / 1) % 10)) + '0';
+    out[19] = '.';
+    out[20] = ((char) ((ms / 100) % 10)) + '0';
+    out[21] = ((char) ((ms / 10) % 10)) + '0';
+    out[22] = ((char) ((ms / 1) % 10)) + '0';
+    out[23] = 'Z';
+    out[24] = '\0';
+}
+
+} //end anonymous namespace
+
+/*
+ * Timestamp work of one OcppEngine loop in which the services request the current time 20 times and format it 5
+ * times: the per-loop snapshot with the formatting cache vs. the former path with a clock reading for every request
+ * and formatting from the calendar fields
+ */
+void bench_timestamp_per_loop() {
+    OcppTime ocppTime ([] () {return (otime_t) 0;});
+    TEST_ASSERT_TRUE(ocppTime.setOcppTime("2022-06-01T12:00:00.000Z"));
+    PerCallClock perCallClock (ocppTime.getOcppTimestampNow());
+
+    char buf [JSONDATE_LENGTH + 1] = {'\0'};
+    volatile int sink = 0;
+
+    double snapshotNs = benchNsPerOp(200000, [&ocppTime, &buf, &sink] (size_t) {
+        delay(3);
+        ocppTime.updateSnapshot();
+        for (int i = 0; i < 20; i++) {
+            sink = (int) ocppTime.getOcppTimestampNow().getEpochMs();
+        }
+        for (int i = 0; i < 5; i++) {
+            ocppTime.getOcppTimestampNow().toJsonString(buf, sizeof(buf));
+        }
+    });
+
+    double perCallNs = benchNsPerOp(200000, [&perCallClock, &buf, &sink] (size_t) {
+        delay(3);
+        for (int i = 0; i < 20; i++) {
+            sink = (int) perCallClock.getOcppTimestampNow().getEpochMs();
+        }
+        for (int i = 0; i < 5; i++) {
+            formatPerCall(perCallClock.getOcppTimestampNow(), buf);
+        }
+    });
+
+    //the formatting cache must give the same strings as the former formatter
+    OcppTimestamp t (2022, 2, 3, 4, 5, 6);
+    char ref [JSONDATE_LENGTH + 1] = {'\0'};
+    for (int i = 0; i < 100000; i++) {
+        OcppTimestamp u = t;
+        u.addMilliseconds((int64_t) i * 137);
+        TEST_ASSERT_TRUE(u.toJsonString(buf, sizeof(buf)));
+        formatPerCall(u, ref);
+        TEST_ASSERT_EQUAL_STRING(ref, buf);
+        TEST_ASSERT_TRUE(u.toJsonString(buf, sizeof(buf)));
+        TEST_ASSERT_EQUAL_STRING(ref, buf);
+    }
+
+    double sameSecondNs = benchNsPerOp(5000000, [&t, &buf] (size_t i) {
+        OcppTimestamp u = t;
+        u.addMilliseconds((int64_t) (i % 1000));
+        u.toJsonString(buf, sizeof(buf));
+    });
+    double newSecondNs = benchNsPerOp(5000000, [&t, &buf] (size_t i) {
+        OcppTimestamp u = t;
+        u.addMilliseconds((int64_t) i * 1000);
+        u.toJsonString(buf, sizeof(buf));
+    });
+    double formerNs = benchNsPerOp(5000000, [&t, &buf] (size_t i) {
+        OcppTimestamp u = t;
+        u.addMilliseconds((int64_t) (i % 1000));
+        formatPerCall(u, buf);
+    });
+
+    BENCH_REPORT("timestamps per loop (20 reads, 5 formats): snapshot + cache %.0f ns, former per-call path %.0f ns", snapshotNs, perCallNs);
+    BENCH_REPORT("toJsonString: same second %.1f ns, new second %.1f ns, former formatter %.1f ns", sameSecondNs, newSecondNs, formerNs);
+}
+
+/*
+ * ISO 8601 parser: corpus of accepted and rejected strings, round trip against the C library and parse speed
+ */
+void bench_timestamp_parser() {
+    struct {
+        const char *in;
+        bool accepted;
+        const char *out;
+    } corpus [] = {
+        {"2020-10-01T20:53:32.486Z",         true,  "2020-10-01T20:53:32.486Z"},
+        {"2020-10-01T20:53:32Z",             true,  "2020-10-01T20:53:32.000Z"},
+        {"2020-10-01T20:53:32",              true,  "2020-10-01T20:53:32.000Z"},
+        {"2020-10-01T20:53:32.4Z",           true,  "2020-10-01T20:53:32.400Z"},
+        {"2020-10-01T20:53:32.123456789Z",   true,  "2020-10-01T20:53:32.123Z"},
+        {"2020-10-01T22:53:32.486+02:00",    true,  "2020-10-01T20:53:32.486Z"},
+        {"2020-10-01T00:23:32-0530",         true,  "2020-10-01T05:53:32.000Z"},
+        {"2020-01-01T00:30:00+01",           true,  "2019-12-31T23:30:00.000Z"},
+        {"2020-02-29T12:00:00Z",             true,  "2020-02-29T12:00:00.000Z"},
+        {"2021-02-29T12:00:00Z",             false, nullptr},
+        {"2020-10-01T20:53:3",               false, nullptr},
+        {"2020-10-01 20:53:32Z",             false, nullptr},
+        {"2020-10-01T20:53:32.Z",            false, nullptr},
+        {"2020-10-01T20:53:32Zx",            false, nullptr},
+        {"2020-10-01T20:53:32+2:00",         false, nullptr},
+        {"2020-10-01T24:00:00Z",             false, nullptr},
+        {"2020-13-01T00:00:00Z",             false, nullptr},
+        {"2020-10-01T20:53:32+24:00",        false, nullptr},
+        {"",                                 false, nullptr},
+    };
+
+    char buf [JSONDATE_LENGTH + 1] = {'\0'};
+    for (auto& entry : corpus) {
+        OcppTimestamp t;
+        bool accepted = t.setTime(entry.in);
+        TEST_ASSERT_EQUAL_MESSAGE(entry.accepted, accepted, entry.in);
+        if (accepted) {
+            TEST_ASSERT_TRUE(t.toJsonString(buf, sizeof(buf)));
+            TEST_ASSERT_EQUAL_STRING_MESSAGE(entry.out, buf, entry.in);
+        }
+    }
+
+    unsigned int rnd = 5;
+    for (int i = 0; i < 300000; i++) {
+        rnd = rnd * 1103515245 + 12345;
+        int64_t secs = (int64_t) ((rnd >> 1) % 2000000000);
+        rnd = rnd * 1103515245 + 12345;
+        OcppTimestamp t;
+        t.setEpochMs(secs * 1000 + (rnd >> 8) % 1000);
+        TEST_ASSERT_TRUE(t.toJsonString(buf, sizeof(buf)));
+
+        time_t epoch = (time_t) secs;
+        struct tm tm;
+        gmtime_r(&epoch, &tm);
+        char expected [JSONDATE_LENGTH + 1];
+        strftime(expected, sizeof(expected), "%Y-%m-%dT%H:%M:%S", &tm);
+        TEST_ASSERT_EQUAL_INT(0, strncmp(expected, buf, 19));
+
+        OcppTimestamp parsed;
+        TEST_ASSERT_TRUE(parsed.setTime(buf));
+        TEST_ASSERT_TRUE(parsed == t);
+    }
+
+    OcppTimestamp t;
+    volatile bool sink = false;
+    double utcNs = benchNsPerOp(5000000, [&t, &sink] (size_t) {
+        sink = t.setTime("2022-06-01T12:34:56.789Z");
+    });
+    double offsetNs = benchNsPerOp(5000000, [&t, &sink] (size_t) {
+        sink = t.setTime("2022-06-01T12:34:56.789+02:00");
+    });
+
+    BENCH_REPORT("setTime: UTC %.1f ns, with zone offset %.1f ns", utcNs, offsetNs);
+}
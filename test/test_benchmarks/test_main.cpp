@@ -0,0 +1,29 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <unity.h>
+#include "bench.h"
+
+void setUp() { }
+
+void tearDown() { }
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(bench_configuration_boot);
+
+    RUN_TEST(bench_timestamp_arithmetic);
+    RUN_TEST(bench_timestamp_per_loop);
+    RUN_TEST(bench_timestamp_parser);
+
+    RUN_TEST(bench_energy_integration);
+    RUN_TEST(bench_batch_meter);
+
+    RUN_TEST(bench_profile_stacks);
+    RUN_TEST(bench_site_balancer);
+    RUN_TEST(bench_profile_store_boot);
+
+    return UNITY_END();
+}
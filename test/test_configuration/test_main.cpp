@@ -0,0 +1,187 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <unity.h>
+
+#include <ArduinoOcpp/Core/ConfigurationContainerFlash.h>
+#include <ArduinoOcpp/Core/ConfigurationKeyValue.h>
+#include <ArduinoOcpp/Core/FilesystemAdapter.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+using namespace ArduinoOcpp;
+
+/*
+ * Power loss during a save of the A/B configuration snapshots: the filesystem stops writing after a random number of
+ * bytes, and all later operations of the save fail. After each cut, a fresh container must load either the previous
+ * or the new snapshot
+ */
+
+namespace {
+
+const char *CONFIG_FN = "/test-config.cnf";
+
+class PowerCutFilesystem : public FilesystemAdapter {
+private:
+    RamFilesystemAdapter storage;
+    long writeBudget = -1; //bytes until the power is cut. -1: no cut
+
+    class File : public FileAdapter {
+    private:
+        PowerCutFilesystem& fs;
+        std::unique_ptr<FileAdapter> file;
+    public:
+        File(PowerCutFilesystem& fs, std::unique_ptr<FileAdapter> file) : fs(fs), file(std::move(file)) { }
+        size_t read(uint8_t *buf, size_t len) {return file->read(buf, len);}
+        int read() {return file->read();}
+        bool seek(size_t offset) {return file->seek(offset);}
+        size_t write(const uint8_t *buf, size_t len) {
+            if (fs.writeBudget >= 0 && (long) len > fs.writeBudget) {
+                len = (size_t) fs.writeBudget;
+            }
+            size_t written = file->write(buf, len);
+            if (fs.writeBudget >= 0) {
+                fs.writeBudget -= (long) written;
+            }
+            return written;
+        }
+    };
+
+    bool isPowerLost() {return writeBudget == 0;}
+public:
+    void cutPowerAfter(long bytes) {writeBudget = bytes;}
+    void restorePower() {writeBudget = -1;}
+
+    bool stat(const char *path, size_t *size = nullptr) {return storage.stat(path, size);}
+    bool remove(const char *path) {return !isPowerLost() && storage.remove(path);}
+    bool rename(const char *from, const char *to) {return !isPowerLost() && storage.rename(from, to);}
+    std::unique_ptr<FileAdapter> open(const char *path, const char *mode) {
+        if (isPowerLost() && mode[0] != 'r') {
+            return nullptr;
+        }
+        auto file = storage.open(path, mode);
+        if (!file) {
+            return nullptr;
+        }
+        return std::unique_ptr<FileAdapter>(new File(*this, std::move(file)));
+    }
+    void forEachFile(std::function<void(const char *path)> fn) {storage.forEachFile(fn);}
+};
+
+std::shared_ptr<PowerCutFilesystem> filesystem;
+
+int loadValue(bool *loaded) {
+    ConfigurationContainerFlash container (filesystem, CONFIG_FN);
+    *loaded = container.load();
+    auto config = container.getConfiguration("Value");
+    return config ? (int) *std::static_pointer_cast<Configuration<int>>(config) : -1;
+}
+
+} //end anonymous namespace
+
+void setUp() {
+    filesystem = std::make_shared<PowerCutFilesystem>();
+
+    ConfigurationContainerFlash container (filesystem, CONFIG_FN);
+    TEST_ASSERT_TRUE(container.load());
+    auto value = std::make_shared<Configuration<int>>();
+    value->setKey("Value");
+    *value = 0;
+    container.addConfiguration(value);
+    auto padding = std::make_shared<Configuration<const char*>>();
+    padding->setKey("Padding");
+    *padding = "some longer string value which makes the snapshot span several writes";
+    container.addConfiguration(padding);
+    TEST_ASSERT_TRUE(container.save());
+}
+
+void tearDown() {
+    filesystem.reset();
+}
+
+void test_save_and_reload() {
+    for (int i = 1; i <= 10; i++) {
+        ConfigurationContainerFlash container (filesystem, CONFIG_FN);
+        TEST_ASSERT_TRUE(container.load());
+        *std::static_pointer_cast<Configuration<int>>(container.getConfiguration("Value")) = i;
+        TEST_ASSERT_TRUE(container.save());
+
+        bool loaded = false;
+        TEST_ASSERT_EQUAL(i, loadValue(&loaded));
+        TEST_ASSERT_TRUE(loaded);
+    }
+}
+
+void test_power_cut_during_save() {
+    size_t snapshotSize = 0;
+    TEST_ASSERT_TRUE(filesystem->stat(CONFIG_FN, &snapshotSize) || filesystem->stat((std::string(CONFIG_FN) + ".b").c_str(), &snapshotSize));
+
+    srand(1);
+    int committed = 0, keptOld = 0, tookNew = 0;
+    for (int i = 1; i <= 500; i++) {
+        {
+            ConfigurationContainerFlash container (filesystem, CONFIG_FN);
+            TEST_ASSERT_TRUE(container.load());
+            *std::static_pointer_cast<Configuration<int>>(container.getConfiguration("Value")) = i;
+
+            filesystem->cutPowerAfter(rand() % (snapshotSize + 10)); //sometimes the save completes
+            container.save();
+            filesystem->restorePower();
+        }
+
+        bool loaded = false;
+        int value = loadValue(&loaded);
+        TEST_ASSERT_TRUE(loaded);
+        if (value == i) {
+            committed = i;
+            tookNew++;
+        } else {
+            TEST_ASSERT_EQUAL(committed, value);
+            keptOld++;
+        }
+    }
+
+    printf("[fault injection] 500 cut saves: %d kept the previous snapshot, %d completed\n", keptOld, tookNew);
+    TEST_ASSERT_TRUE(keptOld > 0);
+    TEST_ASSERT_TRUE(tookNew > 0);
+}
+
+/*
+ * Observers which remove themselves or other observers during the notification: every observer which is still
+ * registered when its turn comes is notified exactly once
+ */
+void test_observer_removal_during_notification() {
+    Configuration<int> config;
+    config.setKey("Observed");
+    config = 0;
+
+    int calls [4] = {0, 0, 0, 0};
+    int ids [4];
+    ids[0] = config.addObserver([&] () {calls[0]++; config.removeObserver(ids[0]);}); //removes itself
+    ids[1] = config.addObserver([&] () {calls[1]++;});
+    ids[2] = config.addObserver([&] () {calls[2]++; config.removeObserver(ids[3]);}); //removes the next one
+    ids[3] = config.addObserver([&] () {calls[3]++;});
+
+    config = 1;
+    TEST_ASSERT_EQUAL(1, calls[0]);
+    TEST_ASSERT_EQUAL(1, calls[1]);
+    TEST_ASSERT_EQUAL(1, calls[2]);
+    TEST_ASSERT_EQUAL(0, calls[3]);
+
+    config = 2;
+    TEST_ASSERT_EQUAL(1, calls[0]);
+    TEST_ASSERT_EQUAL(2, calls[1]);
+    TEST_ASSERT_EQUAL(2, calls[2]);
+    TEST_ASSERT_EQUAL(0, calls[3]);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_save_and_reload);
+    RUN_TEST(test_power_cut_during_save);
+    RUN_TEST(test_observer_removal_during_notification);
+    return UNITY_END();
+}
@@ -0,0 +1,204 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <unity.h>
+
+#include <ArduinoOcpp/Tasks/SmartCharging/ChargingProfileStore.h>
+#include <ArduinoOcpp/Core/FilesystemAdapter.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ArduinoOcpp;
+
+/*
+ * Profile updates until the store is compacted. The compaction moves the directory entries, so the updated profile
+ * must still have exactly one entry afterwards
+ */
+
+namespace {
+
+const ChargingProfilePurposeType PURPOSE = ChargingProfilePurposeType::TxDefaultProfile;
+
+/*
+ * Power loss during a write: the filesystem stops writing after a given number of bytes, and all later operations
+ * fail until the power is restored
+ */
+class PowerCutFilesystem : public FilesystemAdapter {
+private:
+    RamFilesystemAdapter storage;
+    long writeBudget = -1; //bytes until the power is cut. -1: no cut
+
+    class File : public FileAdapter {
+    private:
+        PowerCutFilesystem& fs;
+        std::unique_ptr<FileAdapter> file;
+    public:
+        File(PowerCutFilesystem& fs, std::unique_ptr<FileAdapter> file) : fs(fs), file(std::move(file)) { }
+        size_t read(uint8_t *buf, size_t len) {return file->read(buf, len);}
+        int read() {return file->read();}
+        bool seek(size_t offset) {return file->seek(offset);}
+        size_t write(const uint8_t *buf, size_t len) {
+            if (fs.writeBudget >= 0 && (long) len > fs.writeBudget) {
+                len = (size_t) fs.writeBudget;
+            }
+            size_t written = file->write(buf, len);
+            if (fs.writeBudget >= 0) {
+                fs.writeBudget -= (long) written;
+            }
+            return written;
+        }
+    };
+
+    bool isPowerLost() {return writeBudget == 0;}
+public:
+    void cutPowerAfter(long bytes) {writeBudget = bytes;}
+    void restorePower() {writeBudget = -1;}
+
+    bool stat(const char *path, size_t *size = nullptr) {return storage.stat(path, size);}
+    bool remove(const char *path) {return !isPowerLost() && storage.remove(path);}
+    bool rename(const char *from, const char *to) {return !isPowerLost() && storage.rename(from, to);}
+    std::unique_ptr<FileAdapter> open(const char *path, const char *mode) {
+        if (isPowerLost() && mode[0] != 'r') {
+            return nullptr;
+        }
+        auto file = storage.open(path, mode);
+        if (!file) {
+            return nullptr;
+        }
+        return std::unique_ptr<FileAdapter>(new File(*this, std::move(file)));
+    }
+    void forEachFile(std::function<void(const char *path)> fn) {storage.forEachFile(fn);}
+};
+
+std::shared_ptr<PowerCutFilesystem> filesystem;
+
+bool storeProfile(ChargingProfileStore& store, int stackLevel, int limit) {
+    char json [300];
+    snprintf(json, sizeof(json),
+            "{\"chargingProfileId\":%d,\"stackLevel\":%d,\"chargingProfilePurpose\":\"TxDefaultProfile\","
+            "\"chargingProfileKind\":\"Absolute\",\"chargingSchedule\":{\"chargingRateUnit\":\"W\","
+            "\"chargingSchedulePeriod\":[{\"startPeriod\":0,\"limit\":%d}]}}",
+            stackLevel + 1, stackLevel, limit);
+    DynamicJsonDocument doc (1000);
+    if (deserializeJson(doc, json)) {
+        return false;
+    }
+    return store.store(1, PURPOSE, stackLevel, doc.as<JsonObject>());
+}
+
+size_t getStoreSize() {
+    size_t size = 0;
+    filesystem->stat(AO_PROFILE_STORE_FN, &size);
+    return size;
+}
+
+} //end anonymous namespace
+
+void setUp() {
+    filesystem = std::make_shared<PowerCutFilesystem>();
+}
+
+void tearDown() {
+    filesystem.reset();
+}
+
+void test_update_until_compaction() {
+    ChargingProfileStore store (filesystem);
+    TEST_ASSERT_TRUE(store.load([] (int, JsonObject) { }));
+
+    //the updated profile sits behind a free directory entry, so the compaction moves it to another entry
+    TEST_ASSERT_TRUE(storeProfile(store, 0, 1000));
+    TEST_ASSERT_TRUE(storeProfile(store, 1, 1000));
+    TEST_ASSERT_TRUE(store.remove(1, PURPOSE, 0));
+
+    bool compacted = false;
+    int limit = 1000;
+    for (int i = 0; i < 200 && !compacted; i++) {
+        size_t sizeBefore = getStoreSize();
+        limit += 100;
+        TEST_ASSERT_TRUE(storeProfile(store, 1, limit));
+        compacted = getStoreSize() < sizeBefore;
+    }
+    TEST_ASSERT_TRUE(compacted);
+
+    int numProfiles = 0, lastLimit = -1;
+    ChargingProfileStore reloaded (filesystem);
+    TEST_ASSERT_TRUE(reloaded.load([&numProfiles, &lastLimit] (int connectorId, JsonObject profile) {
+        TEST_ASSERT_EQUAL(1, connectorId);
+        numProfiles++;
+        lastLimit = profile["chargingSchedule"]["chargingSchedulePeriod"][0]["limit"] | -1;
+    }));
+    TEST_ASSERT_EQUAL(1, numProfiles);
+    TEST_ASSERT_EQUAL(limit, lastLimit);
+
+    //clearing the profile must leave no entry behind
+    TEST_ASSERT_TRUE(store.remove(1, PURPOSE, 1));
+
+    numProfiles = 0;
+    ChargingProfileStore cleared (filesystem);
+    TEST_ASSERT_TRUE(cleared.load([&numProfiles] (int, JsonObject) {
+        numProfiles++;
+    }));
+    TEST_ASSERT_EQUAL(0, numProfiles);
+}
+
+/*
+ * Power loss during profile updates: after each cut, a fresh store must load the updated profile exactly once, with
+ * either the previous or the new limit, and the other profiles unchanged
+ */
+void test_power_cut_during_update() {
+    {
+        ChargingProfileStore store (filesystem);
+        TEST_ASSERT_TRUE(store.load([] (int, JsonObject) { }));
+        TEST_ASSERT_TRUE(storeProfile(store, 0, 500));
+        TEST_ASSERT_TRUE(storeProfile(store, 1, 0));
+    }
+
+    srand(1);
+    int committed = 0, keptOld = 0, tookNew = 0;
+    for (int i = 1; i <= 500; i++) {
+        {
+            ChargingProfileStore store (filesystem);
+            store.load([] (int, JsonObject) { });
+            filesystem->cutPowerAfter(rand() % 1200); //sometimes the update completes. Compactions need more bytes
+            storeProfile(store, 1, i);
+            storeProfile(store, 1, i);
+            filesystem->restorePower();
+        }
+
+        int numUpdated = 0, numOther = 0, limit = -1;
+        ChargingProfileStore reloaded (filesystem);
+        reloaded.load([&] (int connectorId, JsonObject profile) {
+            int l = profile["chargingSchedule"]["chargingSchedulePeriod"][0]["limit"] | -1;
+            if ((profile["stackLevel"] | -1) == 1) {
+                numUpdated++;
+                limit = l;
+            } else {
+                numOther++;
+                TEST_ASSERT_EQUAL(500, l);
+            }
+        });
+        TEST_ASSERT_EQUAL(1, numUpdated);
+        TEST_ASSERT_EQUAL(1, numOther);
+        if (limit == i) {
+            committed = i;
+            tookNew++;
+        } else {
+            TEST_ASSERT_EQUAL(committed, limit);
+            keptOld++;
+        }
+    }
+
+    printf("[fault injection] 500 cut updates: %d kept the previous profile, %d completed\n", keptOld, tookNew);
+    TEST_ASSERT_TRUE(keptOld > 0);
+    TEST_ASSERT_TRUE(tookNew > 0);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_update_until_compaction);
+    RUN_TEST(test_power_cut_during_update);
+    return UNITY_END();
+}
@@ -0,0 +1,246 @@
+// matth-x/ArduinoOcpp
+// Copyright Matthias Akstaller 2019 - 2022
+// MIT License
+
+#include <unity.h>
+
+#include <ArduinoOcpp/Tasks/SmartCharging/SiteLoadBalancer.h>
+#include <ArduinoOcpp/Tasks/SmartCharging/SmartChargingService.h>
+#include <ArduinoOcpp/Core/OcppEngine.h>
+#include <ArduinoOcpp/Core/OcppSocket.h>
+#include <ArduinoOcpp/Core/Configuration.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace ArduinoOcpp;
+
+/*
+ * Simulation of four EVSEs behind a 32 kW fuse. The EVs arrive and leave at different times, and follow a raised
+ * limit with 3 kW per balancing interval, but a lowered limit at once. One step is one balancing interval
+ */
+
+namespace {
+
+const float FUSE = 32000.f;
+
+struct Ev {
+    float maxPower;
+    int arrival;
+    int departure;
+    float power;
+    float limit;
+};
+
+class Site {
+public:
+    std::vector<Ev> evs;
+    int step = 0;
+    SiteLoadBalancer balancer {FUSE};
+
+    Site(std::vector<Ev> evs) : evs(evs) {
+        for (auto& ev : this->evs) {
+            Ev *e = &ev;
+            balancer.addMember([e] () {return e->power;},
+                               [e, this] () {return isPlugged(*e) ? e->maxPower : 0.f;},
+                               [e] (float limit) {e->limit = limit;});
+        }
+    }
+
+    bool isPlugged(const Ev& ev) const {
+        return step >= ev.arrival && step < ev.departure;
+    }
+
+    //what the EVs could draw without the fuse
+    float getWantedPower() const {
+        float wanted = 0.f;
+        for (auto& ev : evs) {
+            if (isPlugged(ev)) {
+                wanted += ev.maxPower;
+            }
+        }
+        return wanted;
+    }
+
+    float getPower() const {
+        float sum = 0.f;
+        for (auto& ev : evs) {
+            sum += ev.power;
+        }
+        return sum;
+    }
+
+    float getSumOfLimits() const {
+        float sum = 0.f;
+        for (auto& ev : evs) {
+            sum += std::max(ev.limit, 0.f);
+        }
+        return sum;
+    }
+
+    void runStep() {
+        balancer.balance();
+        for (auto& ev : evs) {
+            float target = isPlugged(ev) ? std::min(ev.limit, ev.maxPower) : 0.f;
+            ev.power = target < ev.power ? target : std::min(target, ev.power + 3000.f);
+        }
+        step++;
+    }
+};
+
+std::vector<Ev> makeEvs() {
+    return {
+        {11000.f,   0, 400, 0.f, 0.f},
+        {22000.f,  20, 400, 0.f, 0.f},
+        { 7400.f,  60, 400, 0.f, 0.f},
+        {11000.f, 120, 200, 0.f, 0.f},
+    };
+}
+
+class LoopbackSocket : public OcppSocket {
+public:
+    void loop() { }
+    bool sendTXT(std::string&) {return true;}
+    void setReceiveTXTcallback(ReceiveTXTcallback&) { }
+};
+
+} //end anonymous namespace
+
+void setUp() { }
+
+void tearDown() { }
+
+void test_fuse_never_exceeded() {
+    Site site (makeEvs());
+    float peak = 0.f;
+    while (site.step < 400) {
+        site.runStep();
+        TEST_ASSERT_TRUE(site.getSumOfLimits() <= FUSE * 1.001f);
+        TEST_ASSERT_TRUE(site.getPower() <= FUSE * 1.001f);
+        peak = std::max(peak, site.getPower());
+    }
+    printf("[sim] peak %.0f W (fuse %.0f W)\n", peak, FUSE);
+}
+
+void test_converges_after_arrival_and_departure() {
+    Site site (makeEvs());
+    const int settlingSteps = 20;
+
+    double energy = 0., possible = 0.;
+    while (site.step < 400) {
+        float wanted = site.getWantedPower();
+        site.runStep();
+        energy += site.getPower();
+        possible += std::min(wanted, FUSE);
+
+        //the last arrival is at step 120 and a departure at step 200. Check the steady state before the next event
+        if (site.step == 120 - 1 || site.step == 200 - 1 || site.step == 400 - 1) {
+            TEST_ASSERT_TRUE(site.getPower() >= 0.95f * std::min(site.getWantedPower(), FUSE));
+        }
+        if (site.step == 120 + settlingSteps || site.step == 200 + settlingSteps) {
+            TEST_ASSERT_TRUE(site.getPower() >= 0.95f * std::min(site.getWantedPower(), FUSE));
+        }
+    }
+
+    double utilisation = energy / possible;
+    printf("[sim] utilisation of the available power %.1f %%\n", 100. * utilisation);
+    TEST_ASSERT_TRUE(utilisation >= 0.9);
+}
+
+void test_departed_ev_keeps_only_start_allowance() {
+    Site site (makeEvs());
+    while (site.step < 200 + 1) {
+        site.runStep();
+    }
+    TEST_ASSERT_EQUAL_FLOAT(AO_SITE_POWER_HEADROOM, site.evs[3].limit);
+    TEST_ASSERT_EQUAL_FLOAT(0.f, site.evs[3].power);
+}
+
+/*
+ * An integration which only sees a demand once the EV draws power. With a limit of 0 W, the EV could never start
+ */
+void test_idle_member_can_start() {
+    Ev evs [2] = {{22000.f, 0, 100, 0.f, 0.f}, {11000.f, 0, 100, 0.f, 0.f}};
+    SiteLoadBalancer balancer (FUSE);
+    for (auto& ev : evs) {
+        Ev *e = &ev;
+        balancer.addMember([e] () {return e->power;},
+                           [e] () {return e->power > 0.f ? e->maxPower : 0.f;},
+                           [e] (float limit) {e->limit = limit;});
+    }
+
+    for (int step = 0; step < 20; step++) {
+        balancer.balance();
+        TEST_ASSERT_TRUE(evs[0].limit + evs[1].limit <= FUSE * 1.001f);
+        for (auto& ev : evs) {
+            float target = std::min(ev.limit, ev.maxPower);
+            ev.power = target < ev.power ? target : std::min(target, ev.power + 3000.f);
+        }
+    }
+    printf("[sim] started from idle: %.0f W and %.0f W\n", evs[0].power, evs[1].power);
+    TEST_ASSERT_TRUE(evs[0].power > AO_SITE_POWER_HEADROOM);
+    TEST_ASSERT_TRUE(evs[1].power > AO_SITE_POWER_HEADROOM);
+    TEST_ASSERT_TRUE(evs[0].power + evs[1].power >= 0.95f * FUSE);
+}
+
+/*
+ * An EVSE on the LAN which stops reporting may still draw its last limit. The others must not get that share
+ */
+void test_stale_remote_member_keeps_its_limit() {
+    float limits [2] = {-1.f, -1.f};
+    SiteLoadBalancer balancer (FUSE);
+    balancer.addRemoteMember([&limits] (float limit) {limits[0] = limit;});
+    balancer.addRemoteMember([&limits] (float limit) {limits[1] = limit;});
+
+    for (int step = 0; step < 20; step++) {
+        balancer.reportMember(0, std::max(limits[0], 0.f), 22000.f);
+        balancer.reportMember(1, std::max(limits[1], 0.f), 22000.f);
+        balancer.balance();
+    }
+    TEST_ASSERT_EQUAL_FLOAT(16000.f, limits[0]);
+    TEST_ASSERT_EQUAL_FLOAT(16000.f, limits[1]);
+
+    //member 1 goes silent
+    delay(AO_SITE_REPORT_TIMEOUT_MS);
+    for (int step = 0; step < 20; step++) {
+        balancer.reportMember(0, std::max(limits[0], 0.f), 22000.f);
+        balancer.balance();
+        TEST_ASSERT_TRUE(limits[0] + limits[1] <= FUSE * 1.001f);
+    }
+    printf("[sim] stale member: reserved %.0f W, the other gets %.0f W\n", limits[1], limits[0]);
+    TEST_ASSERT_EQUAL_FLOAT(16000.f, limits[1]);
+
+    //member 1 is back with a lower demand
+    for (int step = 0; step < 20; step++) {
+        balancer.reportMember(0, std::max(limits[0], 0.f), 22000.f);
+        balancer.reportMember(1, 4000.f, 4000.f);
+        balancer.balance();
+    }
+    TEST_ASSERT_EQUAL_FLOAT(4000.f, limits[1]);
+    TEST_ASSERT_EQUAL_FLOAT(22000.f, limits[0]);
+}
+
+void test_share_as_local_charge_point_max_limit() {
+    configuration_init(std::shared_ptr<FilesystemAdapter>(nullptr));
+    LoopbackSocket socket;
+    OcppEngine engine (socket, [] () {return (otime_t) 0;});
+    SmartChargingService scs (engine, 11000.f, 230.f, 2);
+
+    SiteLoadBalancer balancer (8000.f);
+    balancer.addMember(scs, nullptr, [] () {return 11000.f;});
+    balancer.balance();
+
+    TEST_ASSERT_EQUAL_FLOAT(8000.f, balancer.getLimit(0));
+    TEST_ASSERT_EQUAL_FLOAT(8000.f, scs.inferenceLimitNow(1));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fuse_never_exceeded);
+    RUN_TEST(test_converges_after_arrival_and_departure);
+    RUN_TEST(test_departed_ev_keeps_only_start_allowance);
+    RUN_TEST(test_idle_member_can_start);
+    RUN_TEST(test_stale_remote_member_keeps_its_limit);
+    RUN_TEST(test_share_as_local_charge_point_max_limit);
+    return UNITY_END();
+}